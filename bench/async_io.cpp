@@ -0,0 +1,79 @@
+#include "bench.h"
+#include <nx/async_io.h>
+#include <nx/file_system.h>
+
+namespace nx::bench {
+
+static const size_t files = 256;
+
+static Vector<size_t> file_sizes() { return { 4_kb, 64_kb }; }
+
+// writes the small files once per size
+static const Vector<String>& corpus(const uint8_t* data, size_t len)
+{
+    static Map<size_t, Vector<String>> corpora;
+    auto& paths = corpora[len];
+    if (!paths.empty())
+        return paths;
+
+    String dir = temp_path("nx_bench_" + std::to_string(len));
+    nx::file_system::make_dirs(dir);
+    for (size_t i = 0; i < files; i++) {
+        paths.push_back(
+            nx::file_system::join_path(dir, std::to_string(i) + ".bin"));
+        nx::file_system::File file(paths.back());
+        if (!file.open_write() || !file.write_all(data + i * len, len)) {
+            NX_PANIC("failed to write %s", paths.back().c_str());
+        }
+    }
+    return paths;
+}
+
+static Registrar read_file_bench({
+    "read_files",
+    "read_file",
+    file_sizes(),
+    [](const uint8_t* data, size_t len) {
+        // keeps every file like read_files() does
+        Vector<ReadAllResult> results;
+        for (auto& path : corpus(data, len)) {
+            results.push_back(nx::file_system::read_file(path));
+        }
+        do_not_optimize(results);
+    },
+    files,
+});
+
+static Registrar threads_bench({
+    "read_files",
+    "threads",
+    file_sizes(),
+    [](const uint8_t* data, size_t len) {
+        nx::file_system::AsyncReader reader(
+            nx::file_system::AsyncBackend::THREADS);
+        for (auto& path : corpus(data, len)) {
+            reader.submit({ path,
+                            -1,
+                            0,
+                            nx::file_system::WHOLE_FILE,
+                            [](ReadAllResult&& result) {
+                                do_not_optimize(result);
+                            } });
+        }
+        reader.wait();
+    },
+    files,
+});
+
+static Registrar io_uring_bench({
+    "read_files",
+    "io_uring",
+    file_sizes(),
+    [](const uint8_t* data, size_t len) {
+        auto results = nx::file_system::read_files(corpus(data, len));
+        do_not_optimize(results);
+    },
+    files,
+});
+
+} // namespace nx::bench
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <nx/type.h>
+
+#include <cstdlib>
+
+/**
+ * @brief benchmark namespace
+ */
+namespace nx::bench {
+
+/**
+ * @brief      benchmark body, called repeatedly on a buffer of len bytes
+ */
+using BenchFunc = Function<void(const uint8_t* data, size_t len)>;
+
+struct Benchmark {
+    String group;
+    String name;
+    Vector<size_t> sizes;
+    BenchFunc func;
+    /**
+     * @brief  items handled per call, each of the given size. The data
+     *         buffer then holds items * size bytes and times are reported
+     *         per item.
+     */
+    size_t items = 1;
+};
+
+void add_benchmark(Benchmark&& benchmark);
+
+/**
+ * @brief      registers a benchmark from a static initializer
+ */
+struct Registrar {
+    explicit Registrar(Benchmark&& benchmark)
+    {
+        add_benchmark(std::move(benchmark));
+    }
+};
+
+/**
+ * @brief      keep the compiler from optimizing away a result
+ */
+template <class T>
+inline void do_not_optimize(const T& value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static const void* volatile sink;
+    sink = &value;
+#endif
+}
+
+/**
+ * @brief      buffer sizes from 16 B to 64 MB
+ */
+inline Vector<size_t> throughput_sizes()
+{
+    return { 16, 64, 256, 1_kb, 4_kb, 64_kb, 1024_kb, 16384_kb, 65536_kb };
+}
+
+/**
+ * @brief      a path for benchmark files, under TMPDIR or /tmp
+ */
+inline String temp_path(const String& name)
+{
+    const char* dir = getenv("TMPDIR");
+    return String(dir ? dir : "/tmp") + "/" + name;
+}
+
+} // namespace nx::bench
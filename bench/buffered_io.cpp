@@ -0,0 +1,56 @@
+#include "bench.h"
+#include <nx/buffered_io.h>
+
+namespace nx::bench {
+
+static Vector<size_t> text_sizes() { return { 64_kb, 1024_kb }; }
+
+// the bench data with a line break every 64 bytes or so
+static const uint8_t* text(const uint8_t* data, size_t len)
+{
+    static ByteBuffer buffer;
+    if (buffer.size() != len) {
+        buffer.assign(data, data + len);
+        for (size_t i = 0; i < len; i++) {
+            if (buffer[i] == '\n' || buffer[i] % 64 == 0) {
+                buffer[i] = '\n';
+            }
+        }
+    }
+    return buffer.data();
+}
+
+static Registrar read_byte_bench({
+    "read_line",
+    "byte_loop",
+    text_sizes(),
+    [](const uint8_t* data, size_t len) {
+        MemoryFile file(text(data, len), len);
+        String line;
+        char c;
+        while (file.read(&c, 1).ok()) {
+            if (c == '\n') {
+                do_not_optimize(line);
+                line.clear();
+            } else {
+                line.push_back(c);
+            }
+        }
+    },
+});
+
+static Registrar read_line_bench({
+    "read_line",
+    "nx",
+    text_sizes(),
+    [](const uint8_t* data, size_t len) {
+        MemoryFile file(text(data, len), len);
+        BufferedReader reader(file);
+        String line;
+        while (reader.read_line(line).ok()) {
+            do_not_optimize(line);
+        }
+    },
+});
+
+} // namespace nx::bench
@@ -0,0 +1,75 @@
+#include "bench.h"
+#include <nx/codec.h>
+#include <nx/compress.h>
+
+namespace nx::bench {
+
+static Vector<size_t> compress_sizes() { return { 1024_kb, 16384_kb }; }
+
+// the bench data cut down to 16 letters, random data does not compress
+static const uint8_t* letters(const uint8_t* data, size_t len)
+{
+    static ByteBuffer buffer;
+    if (buffer.size() != len) {
+        buffer.resize(len);
+        for (size_t i = 0; i < len; i++) {
+            buffer[i] = (uint8_t)('a' + data[i] % 16);
+        }
+    }
+    return buffer.data();
+}
+
+// a frame encoded and decoded again
+static Benchmark codec_bench(const char* name)
+{
+    return {
+        "codec",
+        name,
+        compress_sizes(),
+        [name](const uint8_t* data, size_t len) {
+            const auto& codec = *compress::find_codec(name);
+            auto frame = compress::encode(codec, letters(data, len), len);
+            auto output = compress::decode(frame.data(), frame.size());
+            do_not_optimize(output);
+        },
+    };
+}
+
+static Registrar store_codec_bench(codec_bench("store"));
+
+#if defined(USE_LZ4)
+static Registrar lz4_codec_bench(codec_bench("lz4"));
+#endif
+
+#if defined(USE_ZSTD)
+static Registrar zstd_codec_bench(codec_bench("zstd"));
+#endif
+
+// without zlib these would panic
+#if defined(USE_ZLIB)
+
+static Registrar zlib_codec_bench(codec_bench("zlib"));
+
+static Registrar zlib_bench({
+    "deflate",
+    "zlib",
+    compress_sizes(),
+    [](const uint8_t* data, size_t len) {
+        auto output = zlib_compress(letters(data, len), len);
+        do_not_optimize(output);
+    },
+});
+
+static Registrar parallel_bench({
+    "deflate",
+    "parallel",
+    compress_sizes(),
+    [](const uint8_t* data, size_t len) {
+        auto output = parallel_compress(letters(data, len), len);
+        do_not_optimize(output);
+    },
+});
+
+#endif
+
+} // namespace nx::bench
@@ -0,0 +1,451 @@
+#include <nx/codec.h>
+#include <nx/compress.h>
+#include <nx/file_system.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <tuple>
+
+#if defined(__GLIBC__)
+    #include <malloc.h>
+#endif
+
+// Compresses every file of a corpus with every codec and level, to choose
+// settings per kind of data. Results are summed per file extension.
+namespace nx::bench {
+
+struct Method {
+    String codec;
+    int level;
+    Function<ByteBuffer(const uint8_t* data, size_t len)> compress;
+    // nothing if the data does not come back
+    Function<Optional<ByteBuffer>(const ByteBuffer& packed)> decompress;
+};
+
+struct Options {
+    String directory;
+    String pattern = "**";
+    Vector<String> codecs;
+    // empty for each codec's min, default and max
+    Vector<int> levels;
+    double min_time = 0.05;
+    String json_path;
+};
+
+// what one method did to one file
+struct Sample {
+    String file;
+    String type;
+    String codec;
+    int level;
+    size_t raw;
+    size_t packed;
+    double compress_seconds;
+    double decompress_seconds;
+    size_t peak_memory;
+};
+
+static const char* usage = R"(usage: %s [options] DIRECTORY [PATTERN]
+  compresses the files under DIRECTORY matching the fs::glob PATTERN,
+  default "**", with every codec and level, and reports per file type the
+  ratio, compress and decompress MB/s and peak memory.
+
+  --codec LIST      comma separated codecs, default all built in
+  --level LIST      comma separated levels, -1 for each codec's default.
+                    By default its min, default and max
+  --min-time SEC    minimum time per measurement, default 0.05
+  --json FILE       write every file's results to FILE as json
+)";
+
+static Vector<String> split(const char* list)
+{
+    Vector<String> items;
+    String item;
+    for (const char* p = list;; p++) {
+        if (*p == ',' || *p == 0) {
+            if (!item.empty()) {
+                items.push_back(std::move(item));
+            }
+            item.clear();
+            if (*p == 0)
+                break;
+        } else {
+            item.push_back(*p);
+        }
+    }
+    return items;
+}
+
+static bool parse_options(int argc, const char* const argv[], Options* opts)
+{
+    Vector<String> positional;
+    for (int i = 1; i < argc; i++) {
+        String arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg == "--codec" && has_value) {
+            opts->codecs = split(argv[++i]);
+        } else if (arg == "--level" && has_value) {
+            for (auto& level : split(argv[++i])) {
+                opts->levels.push_back(atoi(level.c_str()));
+            }
+        } else if (arg == "--min-time" && has_value) {
+            opts->min_time = atof(argv[++i]);
+        } else if (arg == "--json" && has_value) {
+            opts->json_path = argv[++i];
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            return false;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+
+    if (positional.empty() || positional.size() > 2)
+        return false;
+    opts->directory = positional[0];
+    if (positional.size() == 2) {
+        opts->pattern = positional[1];
+    }
+    return opts->min_time > 0;
+}
+
+// the levels asked for that a codec has, -1 standing for its default
+static Vector<int> resolve_levels(const Vector<int>& levels,
+                                  int default_level,
+                                  int min_level,
+                                  int max_level)
+{
+    Vector<int> result;
+    for (int level : levels) {
+        if (level == -1) {
+            result.push_back(default_level);
+        } else if (level >= min_level && level <= max_level) {
+            result.push_back(level);
+        }
+    }
+    return result;
+}
+
+static Vector<int> unique(Vector<int> levels)
+{
+    std::sort(levels.begin(), levels.end());
+    levels.erase(std::unique(levels.begin(), levels.end()), levels.end());
+    return levels;
+}
+
+static Vector<Method> methods(const Options& opts)
+{
+    Vector<Method> result;
+    auto wanted = [&opts](const String& name) {
+        return opts.codecs.empty()
+               || std::find(opts.codecs.begin(), opts.codecs.end(), name)
+                      != opts.codecs.end();
+    };
+
+    for (const auto* codec : compress::codecs()) {
+        if (!wanted(codec->name()))
+            continue;
+
+        Vector<int> levels = { codec->min_level(),
+                               codec->default_level(),
+                               codec->max_level() };
+        if (!opts.levels.empty()) {
+            levels = resolve_levels(opts.levels,
+                                    codec->default_level(),
+                                    codec->min_level(),
+                                    codec->max_level());
+        }
+
+        for (int level : unique(levels)) {
+            result.push_back({
+                codec->name(),
+                level,
+                [codec, level](const uint8_t* data, size_t len) {
+                    return compress::encode(*codec, data, len, level);
+                },
+                [](const ByteBuffer& packed) -> Optional<ByteBuffer> {
+                    auto result = compress::decode(packed.data(),
+                                                   packed.size());
+                    if (auto* data = std::get_if<ByteBuffer>(&result))
+                        return std::move(*data);
+                    return std::nullopt;
+                },
+            });
+        }
+    }
+
+#if defined(USE_ZLIB)
+    // a zlib stream like the zlib codec's, written on every core
+    if (wanted("zlib-parallel")) {
+        Vector<int> levels = { 1, 6, 9 };
+        if (!opts.levels.empty()) {
+            levels = resolve_levels(opts.levels, 6, 0, 9);
+        }
+
+        for (int level : unique(levels)) {
+            result.push_back({
+                "zlib-parallel",
+                level,
+                [level](const uint8_t* data, size_t len) {
+                    ParallelCompressOptions options;
+                    options.level = level;
+                    options.format = DeflateFormat::ZLIB;
+                    return parallel_compress(data, len, options);
+                },
+                [](const ByteBuffer& packed) -> Optional<ByteBuffer> {
+                    return zlib_uncompress(packed.data(), packed.size());
+                },
+            });
+        }
+    }
+#endif
+    return result;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    using seconds = std::chrono::duration<double>;
+    return seconds(std::chrono::steady_clock::now() - start).count();
+}
+
+// run func until the runs take at least min_time, return seconds per run
+template <class Func>
+static double measure(Func&& func, double min_time)
+{
+    size_t runs = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed;
+    do {
+        func();
+        runs++;
+        elapsed = seconds_since(start);
+    } while (elapsed < min_time);
+    return elapsed / runs;
+}
+
+// a field of /proc/self/status in bytes, 0 where there is none
+static size_t status_bytes(const char* field)
+{
+    FILE* fp = fopen("/proc/self/status", "r");
+    if (!fp)
+        return 0;
+
+    char line[256];
+    size_t len = strlen(field);
+    size_t kb = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, field, len) == 0 && line[len] == ':') {
+            kb = strtoull(line + len + 1, nullptr, 10);
+            break;
+        }
+    }
+    fclose(fp);
+    return kb * 1024;
+}
+
+// Linux resets VmHWM, the peak resident size, to the current one when "5"
+// is written to clear_refs. The growth of the peak from there is what the
+// code in between used at most.
+static size_t reset_peak_memory()
+{
+#if defined(__GLIBC__)
+    // give back what earlier runs freed, or it would hide new allocations
+    malloc_trim(0);
+#endif
+    FILE* fp = fopen("/proc/self/clear_refs", "w");
+    if (fp) {
+        fputs("5", fp);
+        fclose(fp);
+    }
+    return status_bytes("VmRSS");
+}
+
+static size_t peak_memory_since(size_t base)
+{
+    size_t peak = status_bytes("VmHWM");
+    return peak > base ? peak - base : 0;
+}
+
+static String file_type(const String& path)
+{
+    auto slash = path.find_last_of('/');
+    auto dot = path.find_last_of('.');
+    if (dot == String::npos || (slash != String::npos && dot < slash))
+        return "(none)";
+    return path.substr(dot + 1);
+}
+
+static bool write_json(const String& path, const Vector<Sample>& samples)
+{
+    FILE* fp = fopen(path.c_str(), "w");
+    if (!fp)
+        return false;
+
+    fprintf(fp, "{\n  \"results\": [\n");
+    for (size_t i = 0; i < samples.size(); i++) {
+        const Sample& s = samples[i];
+        // paths are written as they are, quotes and backslashes escaped
+        String file;
+        for (char c : s.file) {
+            if (c == '"' || c == '\\') {
+                file.push_back('\\');
+            }
+            file.push_back(c);
+        }
+        fprintf(fp,
+                "    {\"file\": \"%s\", \"codec\": \"%s\", \"level\": %d, "
+                "\"raw\": %zu, \"packed\": %zu, \"compress_s\": %.9f, "
+                "\"decompress_s\": %.9f, \"peak_memory\": %zu}%s\n",
+                file.c_str(),
+                s.codec.c_str(),
+                s.level,
+                s.raw,
+                s.packed,
+                s.compress_seconds,
+                s.decompress_seconds,
+                s.peak_memory,
+                i + 1 < samples.size() ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    return fclose(fp) == 0;
+}
+
+// totals of one codec and level over the files of one type
+struct Summary {
+    size_t files = 0;
+    size_t raw = 0;
+    size_t packed = 0;
+    double compress_seconds = 0;
+    double decompress_seconds = 0;
+    size_t peak_memory = 0;
+};
+
+static void print_table(const Vector<Sample>& samples)
+{
+    using Key = std::tuple<String, String, int>;
+    Map<Key, Summary> summaries;
+    for (auto& s : samples) {
+        Summary& summary = summaries[Key(s.type, s.codec, s.level)];
+        summary.files++;
+        summary.raw += s.raw;
+        summary.packed += s.packed;
+        summary.compress_seconds += s.compress_seconds;
+        summary.decompress_seconds += s.decompress_seconds;
+        summary.peak_memory = std::max(summary.peak_memory, s.peak_memory);
+    }
+
+    printf("%-10s %-14s %5s %6s %12s %8s %12s %12s %10s\n",
+           "type",
+           "codec",
+           "level",
+           "files",
+           "raw MB",
+           "ratio",
+           "comp MB/s",
+           "decomp MB/s",
+           "peak MB");
+    for (auto& [key, summary] : summaries) {
+        double mb = summary.raw / 1e6;
+        printf("%-10s %-14s %5d %6zu %12.2f %8.3f %12.1f %12.1f %10.2f\n",
+               std::get<0>(key).c_str(),
+               std::get<1>(key).c_str(),
+               std::get<2>(key),
+               summary.files,
+               mb,
+               summary.packed ? (double)summary.raw / summary.packed : 0,
+               mb / summary.compress_seconds,
+               mb / summary.decompress_seconds,
+               summary.peak_memory / 1e6);
+    }
+}
+
+static int run(int argc, const char* const argv[])
+{
+    Options opts;
+    if (!parse_options(argc, argv, &opts)) {
+        printf(usage, argv[0]);
+        return 2;
+    }
+
+    Vector<String> files;
+    file_system::glob(opts.directory, opts.pattern, [&files](auto& path) {
+        if (!file_system::is_directory(path)) {
+            files.push_back(path);
+        }
+    });
+    std::sort(files.begin(), files.end());
+    if (files.empty()) {
+        fprintf(stderr, "no files in %s\n", opts.directory.c_str());
+        return 2;
+    }
+
+    auto all = methods(opts);
+    if (all.empty()) {
+        fprintf(stderr, "no such codec or level\n");
+        return 2;
+    }
+
+    Vector<Sample> samples;
+    size_t failures = 0;
+    for (auto& path : files) {
+        auto content = file_system::read_file(path);
+        auto* data = std::get_if<ByteBuffer>(&content);
+        if (!data) {
+            fprintf(stderr, "can not read %s\n", path.c_str());
+            continue;
+        }
+
+        for (auto& method : all) {
+            size_t base = reset_peak_memory();
+            ByteBuffer packed = method.compress(data->data(), data->size());
+            auto unpacked = method.decompress(packed);
+            size_t peak = peak_memory_since(base);
+
+            if (!unpacked || *unpacked != *data) {
+                fprintf(stderr,
+                        "%s %d does not round trip %s\n",
+                        method.codec.c_str(),
+                        method.level,
+                        path.c_str());
+                failures++;
+                continue;
+            }
+
+            double compress_seconds = measure(
+                [&] { method.compress(data->data(), data->size()); },
+                opts.min_time);
+            double decompress_seconds = measure(
+                [&] { method.decompress(packed); }, opts.min_time);
+
+            samples.push_back({ path,
+                                file_type(path),
+                                method.codec,
+                                method.level,
+                                data->size(),
+                                packed.size(),
+                                compress_seconds,
+                                decompress_seconds,
+                                peak });
+        }
+        fprintf(stderr, "%s\n", path.c_str());
+    }
+
+    print_table(samples);
+
+    if (!opts.json_path.empty() && !write_json(opts.json_path, samples)) {
+        fprintf(stderr, "can not write %s\n", opts.json_path.c_str());
+        return 2;
+    }
+    return failures ? 1 : 0;
+}
+
+} // namespace nx::bench
+
+int main(int argc, const char* const argv[])
+{
+    return nx::bench::run(argc, argv);
+}
@@ -0,0 +1,102 @@
+#include "bench.h"
+#include <nx/digest.h>
+
+namespace nx::bench {
+
+static void generate_table(uint32_t table[256])
+{
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (size_t j = 0; j < 8; j++) {
+            c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        }
+        table[i] = c;
+    }
+}
+
+static uint32_t
+crc32_bytewise(const uint32_t table[256], const uint8_t* buf, size_t len)
+{
+    uint32_t c = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; ++i) {
+        c = table[(c ^ buf[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFF;
+}
+
+// the byte at a time implementation nx used before the slicing engine
+static uint32_t crc32_bytewise(const uint8_t* buf, size_t len)
+{
+    static const auto table = []() {
+        Vector<uint32_t> t(256);
+        generate_table(t.data());
+        return t;
+    }();
+    return crc32_bytewise(table.data(), buf, len);
+}
+
+// the old crc32() also built a 1 KB table for every call
+static uint32_t crc32_table_per_call(const uint8_t* buf, size_t len)
+{
+    uint32_t table[256];
+    generate_table(table);
+    return crc32_bytewise(table, buf, len);
+}
+
+static Vector<size_t> small_sizes() { return { 8, 16, 24, 32, 48, 64 }; }
+
+static Registrar crc32_bytewise_bench({
+    "crc32",
+    "bytewise",
+    throughput_sizes(),
+    [](const uint8_t* data, size_t len) {
+        do_not_optimize(crc32_bytewise(data, len));
+    },
+});
+
+static Registrar crc32_table_per_call_bench({
+    "crc32_small",
+    "table_per_call",
+    small_sizes(),
+    [](const uint8_t* data, size_t len) {
+        do_not_optimize(crc32_table_per_call(data, len));
+    },
+});
+
+static Registrar crc32_small_bench({
+    "crc32_small",
+    "nx",
+    small_sizes(),
+    [](const uint8_t* data, size_t len) {
+        do_not_optimize(nx::digest::crc32(data, len));
+    },
+});
+
+static Registrar crc32_bench({
+    "crc32",
+    "nx",
+    throughput_sizes(),
+    [](const uint8_t* data, size_t len) {
+        do_not_optimize(nx::digest::crc32(data, len));
+    },
+});
+
+static Registrar crc32c_bench({
+    "crc32c",
+    "nx",
+    throughput_sizes(),
+    [](const uint8_t* data, size_t len) {
+        do_not_optimize(nx::digest::crc32c(data, len));
+    },
+});
+
+static Registrar parallel_crc32_bench({
+    "crc32",
+    "parallel",
+    { 1024_kb, 16384_kb, 65536_kb },
+    [](const uint8_t* data, size_t len) {
+        do_not_optimize(nx::digest::parallel_crc32(data, len));
+    },
+});
+
+} // namespace nx::bench
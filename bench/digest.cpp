@@ -0,0 +1,70 @@
+#include "bench.h"
+#include <nx/digest.h>
+
+namespace nx::bench {
+
+static Registrar md5_bench({
+    "md5",
+    "nx",
+    throughput_sizes(),
+    [](const uint8_t* data, size_t len) {
+        do_not_optimize(nx::digest::md5_digest(data, len));
+    },
+});
+
+static Registrar sha256_bench({
+    "sha256",
+    "nx",
+    throughput_sizes(),
+    [](const uint8_t* data, size_t len) {
+        do_not_optimize(nx::digest::sha256_digest(data, len));
+    },
+});
+
+static Registrar blake3_bench({
+    "blake3",
+    "nx",
+    throughput_sizes(),
+    [](const uint8_t* data, size_t len) {
+        do_not_optimize(nx::digest::blake3_digest(data, len));
+    },
+});
+
+static Registrar blake3_parallel_bench({
+    "blake3",
+    "parallel",
+    { 1024_kb, 16384_kb, 65536_kb },
+    [](const uint8_t* data, size_t len) {
+        do_not_optimize(nx::digest::parallel_blake3(data, len));
+    },
+});
+
+static Registrar xxh3_64_bench({
+    "xxh3_64",
+    "nx",
+    throughput_sizes(),
+    [](const uint8_t* data, size_t len) {
+        do_not_optimize(nx::digest::xxh3_64(data, len));
+    },
+});
+
+static Registrar xxh3_128_bench({
+    "xxh3_128",
+    "nx",
+    throughput_sizes(),
+    [](const uint8_t* data, size_t len) {
+        do_not_optimize(nx::digest::xxh3_128(data, len));
+    },
+});
+
+static Registrar sha256_stream_bench({
+    "sha256",
+    "stream",
+    { 1024_kb, 16384_kb, 65536_kb },
+    [](const uint8_t* data, size_t len) {
+        MemoryFile file(data, len);
+        do_not_optimize(nx::digest::sha256_digest(file));
+    },
+});
+
+} // namespace nx::bench
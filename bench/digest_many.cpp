@@ -0,0 +1,77 @@
+#include "bench.h"
+#include <nx/digest.h>
+
+namespace nx::bench {
+
+static const size_t messages = 1024;
+
+static Vector<size_t> message_sizes() { return { 64, 256, 1_kb, 4_kb }; }
+
+static Vector<ByteSpan> split(const uint8_t* data, size_t len)
+{
+    Vector<ByteSpan> inputs(messages);
+    for (size_t i = 0; i < messages; i++) {
+        inputs[i] = { data + i * len, len };
+    }
+    return inputs;
+}
+
+static Registrar md5_loop_bench({
+    "md5_many",
+    "loop",
+    message_sizes(),
+    [](const uint8_t* data, size_t len) {
+        uint8_t digest[16];
+        for (size_t i = 0; i < messages; i++) {
+            nx::digest::MD5 md5;
+            md5.update(data + i * len, len);
+            md5.finish(digest);
+            do_not_optimize(digest);
+        }
+    },
+    messages,
+});
+
+static Registrar md5_many_bench({
+    "md5_many",
+    "nx",
+    message_sizes(),
+    [](const uint8_t* data, size_t len) {
+        static ByteBuffer digests(16 * messages);
+        auto inputs = split(data, len);
+        nx::digest::md5_many(inputs.data(), messages, digests.data());
+        do_not_optimize(digests.data());
+    },
+    messages,
+});
+
+static Registrar sha256_loop_bench({
+    "sha256_many",
+    "loop",
+    message_sizes(),
+    [](const uint8_t* data, size_t len) {
+        uint8_t digest[32];
+        for (size_t i = 0; i < messages; i++) {
+            nx::digest::SHA256 sha256;
+            sha256.update(data + i * len, len);
+            sha256.finish(digest);
+            do_not_optimize(digest);
+        }
+    },
+    messages,
+});
+
+static Registrar sha256_many_bench({
+    "sha256_many",
+    "nx",
+    message_sizes(),
+    [](const uint8_t* data, size_t len) {
+        static ByteBuffer digests(32 * messages);
+        auto inputs = split(data, len);
+        nx::digest::sha256_many(inputs.data(), messages, digests.data());
+        do_not_optimize(digests.data());
+    },
+    messages,
+});
+
+} // namespace nx::bench
@@ -0,0 +1,83 @@
+#include "bench.h"
+#include <nx/hex.h>
+
+namespace nx::bench {
+
+static Vector<size_t> hex_sizes()
+{
+    return { 16, 32, 64, 256, 4_kb, 64_kb, 1024_kb };
+}
+
+// the per nibble loop nx used before the simd kernels
+static void hex_encode_nibble(const uint8_t* data, size_t len, char* output)
+{
+    static const char trans[16] = { '0', '1', '2', '3', '4', '5', '6', '7',
+                                    '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+    for (size_t x = 0; x < len; x++) {
+        output[x * 2] = trans[data[x] >> 4];
+        output[x * 2 + 1] = trans[data[x] & 0x0F];
+    }
+}
+
+static char* output_chars(size_t len)
+{
+    static Vector<char> output;
+    output.resize(std::max(output.size(), 2 * len));
+    return output.data();
+}
+
+// hex text of the benchmark data, rebuilt when the size changes. The first
+// call of each size is not timed.
+static const char* input_hex(const uint8_t* data, size_t len)
+{
+    static String hex;
+    if (hex.size() != 2 * len) {
+        hex = hex_encode(data, len);
+    }
+    return hex.data();
+}
+
+static Registrar hex_encode_nibble_bench({
+    "hex_encode",
+    "nibble",
+    hex_sizes(),
+    [](const uint8_t* data, size_t len) {
+        char* output = output_chars(len);
+        hex_encode_nibble(data, len, output);
+        do_not_optimize(output[0]);
+    },
+});
+
+static Registrar hex_encode_bench({
+    "hex_encode",
+    "nx",
+    hex_sizes(),
+    [](const uint8_t* data, size_t len) {
+        char* output = output_chars(len);
+        hex_encode(data, len, output);
+        do_not_optimize(output[0]);
+    },
+});
+
+static Registrar hex_encode_string_bench({
+    "hex_encode",
+    "nx_string",
+    hex_sizes(),
+    [](const uint8_t* data, size_t len) {
+        do_not_optimize(hex_encode(data, len));
+    },
+});
+
+static Registrar hex_decode_bench({
+    "hex_decode",
+    "nx",
+    hex_sizes(),
+    [](const uint8_t* data, size_t len) {
+        static ByteBuffer output;
+        output.resize(len);
+        do_not_optimize(
+            hex_decode(input_hex(data, len), 2 * len, output.data()));
+    },
+});
+
+} // namespace nx::bench
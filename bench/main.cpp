@@ -0,0 +1,286 @@
+#include "bench.h"
+#include <nx/file_system.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace nx::bench {
+
+static Vector<Benchmark>& registry()
+{
+    static Vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+void add_benchmark(Benchmark&& benchmark)
+{
+    registry().push_back(std::move(benchmark));
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    using seconds = std::chrono::duration<double>;
+    return seconds(std::chrono::steady_clock::now() - start).count();
+}
+
+// run func until a batch takes at least min_time, return ns per call
+static double measure(const Benchmark& benchmark,
+                      const uint8_t* data,
+                      size_t len,
+                      double min_time)
+{
+    benchmark.func(data, len);
+
+    size_t iterations = 1;
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            benchmark.func(data, len);
+        }
+        double elapsed = seconds_since(start);
+        if (elapsed >= min_time) {
+            return elapsed * 1e9 / iterations / benchmark.items;
+        }
+        iterations *= 2;
+    }
+}
+
+static String format_size(size_t len)
+{
+    char buf[32];
+    if (len >= 1024_kb && len % 1024_kb == 0) {
+        snprintf(buf, sizeof(buf), "%zu MB", len / 1024_kb);
+    } else if (len >= 1_kb && len % 1_kb == 0) {
+        snprintf(buf, sizeof(buf), "%zu KB", len / 1_kb);
+    } else {
+        snprintf(buf, sizeof(buf), "%zu B", len);
+    }
+    return buf;
+}
+
+static bool match_filters(const String& full_name,
+                          const Vector<String>& filters)
+{
+    if (filters.empty())
+        return true;
+    for (auto& filter : filters) {
+        if (full_name.find(filter) != String::npos)
+            return true;
+    }
+    return false;
+}
+
+struct Options {
+    Vector<String> filters;
+    // byte offsets from a 64 byte aligned buffer
+    Vector<size_t> aligns = { 0 };
+    double min_time = 0.1;
+    String json_path;
+    String baseline_path;
+    // slowdown in percent reported as a regression
+    double threshold = 10;
+};
+
+struct Result {
+    String name;
+    size_t size;
+    size_t align;
+    double ns;
+};
+
+static String result_key(const String& name, size_t size, size_t align)
+{
+    return name + "@" + std::to_string(size) + "+" + std::to_string(align);
+}
+
+static const char* usage = R"(usage: %s [options] [filter...]
+  runs benchmarks whose group/name contains a filter.
+
+  --align LIST      comma separated data offsets from a 64 byte aligned
+                    buffer, default 0
+  --min-time SEC    minimum time per measurement, default 0.1
+  --json FILE       write the results to FILE as json
+  --baseline FILE   compare against results written by --json, exit with
+                    1 if anything got slower than the threshold
+  --threshold PCT   slowdown that counts as a regression, default 10
+
+  set NX_CPU_DISABLE=all to measure portable paths.
+)";
+
+static bool parse_options(int argc, const char* const argv[], Options* opts)
+{
+    for (int i = 1; i < argc; i++) {
+        String arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg == "--align" && has_value) {
+            opts->aligns.clear();
+            for (const char* p = argv[++i]; *p;) {
+                char* end;
+                opts->aligns.push_back(strtoul(p, &end, 10));
+                if (end == p || opts->aligns.back() >= 64)
+                    return false;
+                p = *end == ',' ? end + 1 : end;
+            }
+        } else if (arg == "--min-time" && has_value) {
+            opts->min_time = atof(argv[++i]);
+        } else if (arg == "--json" && has_value) {
+            opts->json_path = argv[++i];
+        } else if (arg == "--baseline" && has_value) {
+            opts->baseline_path = argv[++i];
+        } else if (arg == "--threshold" && has_value) {
+            opts->threshold = atof(argv[++i]);
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            return false;
+        } else {
+            opts->filters.push_back(arg);
+        }
+    }
+    return !opts->aligns.empty() && opts->min_time > 0;
+}
+
+// One result per line, which is all load_baseline needs to read it back.
+static bool write_json(const String& path, const Vector<Result>& results)
+{
+    FILE* fp = fopen(path.c_str(), "w");
+    if (!fp)
+        return false;
+
+    const char* disabled = getenv("NX_CPU_DISABLE");
+    fprintf(fp, "{\n  \"cpu_disable\": \"%s\",\n", disabled ? disabled : "");
+    fprintf(fp, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        fprintf(fp,
+                "    {\"name\": \"%s\", \"size\": %zu, \"align\": %zu, "
+                "\"ns\": %.3f, \"gbps\": %.4f}%s\n",
+                r.name.c_str(),
+                r.size,
+                r.align,
+                r.ns,
+                r.size / r.ns,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    return fclose(fp) == 0;
+}
+
+static bool load_baseline(const String& path, Map<String, double>* baseline)
+{
+    auto content = nx::file_system::read_file(path);
+    auto* bytes = std::get_if<ByteBuffer>(&content);
+    if (!bytes)
+        return false;
+
+    String text(bytes->begin(), bytes->end());
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        if (eol == String::npos) {
+            eol = text.size();
+        }
+        String line = text.substr(pos, eol - pos);
+        pos = eol + 1;
+
+        char name[128];
+        size_t size, align;
+        double ns;
+        if (sscanf(line.c_str(),
+                   " {\"name\": \"%127[^\"]\", \"size\": %zu, "
+                   "\"align\": %zu, \"ns\": %lf",
+                   name,
+                   &size,
+                   &align,
+                   &ns)
+            == 4) {
+            (*baseline)[result_key(name, size, align)] = ns;
+        }
+    }
+    return true;
+}
+
+static int run(int argc, const char* const argv[])
+{
+    Options opts;
+    if (!parse_options(argc, argv, &opts)) {
+        printf(usage, argv[0]);
+        return 2;
+    }
+
+    Map<String, double> baseline;
+    if (!opts.baseline_path.empty()
+        && !load_baseline(opts.baseline_path, &baseline)) {
+        fprintf(stderr, "can not read %s\n", opts.baseline_path.c_str());
+        return 2;
+    }
+
+    size_t max_size = 0;
+    for (auto& benchmark : registry()) {
+        for (auto size : benchmark.sizes) {
+            max_size = std::max(max_size, size * benchmark.items);
+        }
+    }
+
+    // room to move the data to every offset from a 64 byte boundary
+    ByteBuffer buffer(max_size + 128);
+    uint32_t seed = 0x12345678;
+    for (auto& byte : buffer) {
+        seed = seed * 1103515245 + 12345;
+        byte = (uint8_t)(seed >> 16);
+    }
+    uint8_t* aligned = buffer.data() + (-(uintptr_t)buffer.data() & 63);
+
+    Vector<Result> results;
+    size_t regressions = 0;
+    for (auto& benchmark : registry()) {
+        String full_name = benchmark.group + "/" + benchmark.name;
+        if (!match_filters(full_name, opts.filters))
+            continue;
+
+        for (auto size : benchmark.sizes) {
+            for (auto align : opts.aligns) {
+                double ns = measure(
+                    benchmark, aligned + align, size, opts.min_time);
+                results.push_back({ full_name, size, align, ns });
+
+                printf("%-32s %10s +%-2zu %14.1f ns/item %10.3f GB/s",
+                       full_name.c_str(),
+                       format_size(size).c_str(),
+                       align,
+                       ns,
+                       size / ns);
+
+                auto it = baseline.find(result_key(full_name, size, align));
+                if (it != baseline.end()) {
+                    double change = (ns / it->second - 1) * 100;
+                    bool regressed = change > opts.threshold;
+                    regressions += regressed;
+                    printf(" %+8.1f%%%s", change, regressed ? " slower" : "");
+                }
+                printf("\n");
+                fflush(stdout);
+            }
+        }
+    }
+
+    if (!opts.json_path.empty() && !write_json(opts.json_path, results)) {
+        fprintf(stderr, "can not write %s\n", opts.json_path.c_str());
+        return 2;
+    }
+
+    if (regressions) {
+        printf("%zu results more than %.1f%% slower than the baseline\n",
+               regressions,
+               opts.threshold);
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace nx::bench
+
+int main(int argc, const char* const argv[])
+{
+    return nx::bench::run(argc, argv);
+}
@@ -0,0 +1,77 @@
+#include "bench.h"
+#include <nx/file_system.h>
+
+namespace nx::bench {
+
+static Vector<size_t> copy_sizes() { return { 64_kb, 1024_kb, 65536_kb }; }
+
+// writes the source file once per size
+static const String& source(const uint8_t* data, size_t len)
+{
+    static Map<size_t, String> paths;
+    auto& path = paths[len];
+    if (!path.empty())
+        return path;
+
+    path = temp_path("nx_bench_copy_" + std::to_string(len));
+    nx::file_system::File file(path);
+    if (!file.open_write() || !file.write_all(data, len)) {
+        NX_PANIC("failed to write %s", path.c_str());
+    }
+    return path;
+}
+
+// hides the file behind it from pipe(), which then has to use its buffer
+class BufferedOnly : public Read {
+public:
+    explicit BufferedOnly(Read& source) : source_(source) { }
+
+    ReadResult read(void* buffer, size_t bytes) override
+    {
+        return source_.read(buffer, bytes);
+    }
+
+private:
+    Read& source_;
+};
+
+static void copy_through_buffer(const String& from, size_t buffer_size)
+{
+    nx::file_system::File in(from);
+    nx::file_system::File out(temp_path("nx_bench_copy_to"));
+    if (!in.open_read() || !out.open_write()) {
+        NX_PANIC("failed to open %s", from.c_str());
+    }
+    BufferedOnly reader(in);
+    nx::pipe(reader, out, buffer_size);
+}
+
+static Registrar buffer_8k_bench({
+    "copy_file",
+    "buffer_8k",
+    copy_sizes(),
+    [](const uint8_t* data, size_t len) {
+        copy_through_buffer(source(data, len), 8_kb);
+    },
+});
+
+static Registrar buffer_bench({
+    "copy_file",
+    "buffer",
+    copy_sizes(),
+    [](const uint8_t* data, size_t len) {
+        copy_through_buffer(source(data, len), PIPE_BUFFER_SIZE);
+    },
+});
+
+static Registrar kernel_bench({
+    "copy_file",
+    "nx",
+    copy_sizes(),
+    [](const uint8_t* data, size_t len) {
+        nx::file_system::copy_file(source(data, len),
+                                   temp_path("nx_bench_copy_to"));
+    },
+});
+
+} // namespace nx::bench
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <nx/async_io.h>
+#include <nx/buffered_io.h>
+#include <nx/codec.h>
+#include <nx/compress.h>
 #include <nx/file_system.h>
 #include <nx/digest.h>
 
@@ -16,10 +20,30 @@ namespace fs = nx::file_system;
 namespace nx {
 
 using CRC32 = nx::digest::CRC32;
+using CRC32C = nx::digest::CRC32C;
 using MD5 = nx::digest::MD5;
 using SHA256 = nx::digest::SHA256;
+using BLAKE3 = nx::digest::BLAKE3;
+using XXH3 = nx::digest::XXH3;
+using Hash128 = nx::digest::Hash128;
+using Md5Digest = nx::digest::Md5Digest;
+using Sha256Digest = nx::digest::Sha256Digest;
+using Blake3Digest = nx::digest::Blake3Digest;
+using nx::digest::blake3;
+using nx::digest::blake3_digest;
 using nx::digest::crc32;
+using nx::digest::crc32_combine;
+using nx::digest::crc32c;
+using nx::digest::hash_stream;
+using nx::digest::parallel_blake3;
+using nx::digest::parallel_crc32;
 using nx::digest::md5;
+using nx::digest::md5_digest;
+using nx::digest::md5_many;
 using nx::digest::sha256;
+using nx::digest::sha256_digest;
+using nx::digest::sha256_many;
+using nx::digest::xxh3_128;
+using nx::digest::xxh3_64;
 
 } // namespace nx
\ No newline at end of file
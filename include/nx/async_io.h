@@ -0,0 +1,117 @@
+#pragma once
+
+#include <nx/type.h>
+
+namespace nx::file_system {
+
+/**
+ * @brief      how an AsyncReader talks to the kernel
+ */
+enum class AsyncBackend {
+    /**
+     * @brief  io_uring when the kernel supports it, THREADS otherwise
+     */
+    AUTO,
+    /**
+     * @brief  batched submissions through an io_uring (Linux 5.6+)
+     */
+    IO_URING,
+    /**
+     * @brief  blocking reads on a pool of threads
+     */
+    THREADS,
+};
+
+/**
+ * @brief      length of a ReadRequest that reads to the end of the file
+ */
+constexpr size_t WHOLE_FILE = SIZE_MAX;
+
+struct ReadRequest {
+    /**
+     * @brief  the file to read, opened for the request when fd is -1
+     */
+    String path;
+    /**
+     * @brief  an open descriptor to read instead of path, left open
+     */
+    int fd = -1;
+    uint64_t offset = 0;
+    /**
+     * @brief  the bytes to read, fewer are returned at the end of the
+     *         file
+     */
+    size_t length = WHOLE_FILE;
+    /**
+     * @brief  receives the data or the error, on the thread calling wait()
+     */
+    Function<void(ReadAllResult&& result)> callback;
+};
+
+/**
+ * @brief      reads many files or ranges at once. Requests are queued by
+ *             submit() and all run by wait(): with io_uring every open,
+ *             read and close of the batch goes through one ring and a
+ *             handful of system calls, otherwise a pool of threads does
+ *             blocking reads. Not thread safe, one thread submits and
+ *             waits.
+ *             ### Example
+ *
+ *                 AsyncReader reader;
+ *
+ *                 for (auto& path : paths) {
+ *                     reader.submit({ path, -1, 0, WHOLE_FILE,
+ *                                     [](ReadAllResult&& result) { } });
+ *                 }
+ *                 reader.wait();
+ *
+ */
+class NX_API AsyncReader : private Uncopyable {
+public:
+    /**
+     * @brief      Constructs a new instance.
+     *
+     * @param[in]  backend  The backend, IO_URING falls back to THREADS if
+     *                      the kernel does not support it
+     * @param[in]  threads  The threads of the THREADS backend, 0 means one
+     *                      per core
+     */
+    explicit AsyncReader(AsyncBackend backend = AsyncBackend::AUTO,
+                         size_t threads = 0);
+    ~AsyncReader();
+
+    /**
+     * @brief      the backend in use, IO_URING or THREADS
+     */
+    AsyncBackend backend() const;
+
+    /**
+     * @brief      queue a request until the next wait()
+     */
+    void submit(ReadRequest&& request);
+
+    /**
+     * @brief      run all queued requests and call their callbacks
+     */
+    void wait();
+
+private:
+    struct Ring;
+
+    void wait_threads();
+
+    UniquePtr<Ring> ring_;
+    Vector<ReadRequest> pending_;
+    size_t threads_;
+};
+
+/**
+ * @brief      read whole files with an AsyncReader
+ *
+ * @param[in]  paths  The paths
+ *
+ * @return     The data or error of paths[i] at index i.
+ */
+NX_API Vector<ReadAllResult> read_files(const Vector<String>& paths);
+
+} // namespace nx::file_system
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <nx/type.h>
+
+namespace nx {
+
+/**
+ * @brief      the default capacity of BufferedReader and BufferedWriter
+ */
+constexpr size_t BUFFER_CAPACITY = 64_kb;
+
+/**
+ * @brief Result of a peek, a view of the buffered bytes
+ */
+using PeekResult = Variant<IO_Error, ByteSpan>;
+
+/**
+ * @brief      reads a Read in large blocks, so that small reads, peek and
+ *             line parsing are served from memory. Reads as large as the
+ *             buffer go straight to the source.
+ *             ### Example
+ *
+ *                 BufferedReader reader(entry);
+ *                 String line;
+ *
+ *                 while (reader.read_line(line).ok()) {
+ *                     parse(line);
+ *                 }
+ *
+ */
+class NX_API BufferedReader : public Read, private Uncopyable {
+public:
+    /**
+     * @brief      Constructs a new instance.
+     *
+     * @param      source    The source, must outlive the reader
+     * @param[in]  capacity  The buffer size
+     */
+    explicit BufferedReader(Read& source, size_t capacity = BUFFER_CAPACITY);
+
+    ReadResult read(void* buffer, size_t bytes) override;
+
+    /**
+     * @brief      the buffered bytes plus the source's size_hint()
+     */
+    Optional<size_t> size_hint() const override;
+
+    /**
+     * @brief      look at the next bytes without consuming them. The view is
+     *             valid until the next call on the reader.
+     *
+     * @param[in]  bytes  The bytes wanted, at most the capacity
+     *
+     * @return     a view of at least bytes, fewer only at the end of the
+     *             source, empty at its end
+     */
+    PeekResult peek(size_t bytes);
+
+    /**
+     * @brief      drop bytes from a view returned by peek()
+     */
+    void consume(size_t bytes);
+
+    /**
+     * @brief      append bytes to output up to and including delim, or up to
+     *             the end of the source
+     *
+     * @param[in]  delim   The delimiter
+     * @param      output  The output, not cleared
+     *
+     * @return     the bytes appended, EndOfFile if there were none left
+     */
+    ReadResult read_until(uint8_t delim, ByteBuffer& output);
+
+    /**
+     * @brief      read the next line into line, without its "\n" or "\r\n".
+     *             Reusing one String for every line saves an allocation per
+     *             line.
+     *
+     * @param      line  The line, replaced
+     *
+     * @return     the bytes consumed, EndOfFile after the last line
+     */
+    ReadResult read_line(String& line);
+
+private:
+    template <class Output>
+    ReadResult read_until_impl(uint8_t delim, Output& output);
+
+    ReadResult fill();
+
+    Read& source_;
+    ByteBuffer buffer_;
+    size_t pos_;
+    size_t end_;
+};
+
+/**
+ * @brief      collects small writes in a buffer and passes them on to the
+ *             sink in large blocks. Writes as large as the buffer go straight
+ *             to the sink. The destructor flushes, call flush() to see its
+ *             errors.
+ */
+class NX_API BufferedWriter : public Write, private Uncopyable {
+public:
+    /**
+     * @brief      Constructs a new instance.
+     *
+     * @param      sink      The sink, must outlive the writer
+     * @param[in]  capacity  The buffer size
+     */
+    explicit BufferedWriter(Write& sink, size_t capacity = BUFFER_CAPACITY);
+    ~BufferedWriter();
+
+    WriteResult write(const void* buffer, size_t bytes) override;
+
+    /**
+     * @brief      write everything buffered to the sink
+     *
+     * @return     success? On failure the data stays buffered.
+     */
+    bool flush();
+
+private:
+    Write& sink_;
+    ByteBuffer buffer_;
+    size_t end_;
+};
+
+/**
+ * @brief      reads ahead of the consumer on a background thread, into a
+ *             ring of buffers. The consumer's work (hashing, parsing,
+ *             writing) then overlaps the source's (disk, decompression).
+ *             Memory is bounded by buffers * buffer_size. The source belongs
+ *             to the background thread until the reader is destroyed, which
+ *             stops the thread after the source's current read returns.
+ *             ### Example
+ *
+ *                 PrefetchReader reader(*entry);
+ *
+ *                 nx::pipe(reader, file);
+ *
+ */
+class NX_API PrefetchReader : public Read, private Uncopyable {
+public:
+    /**
+     * @brief      Constructs a new instance and starts reading.
+     *
+     * @param      source       The source, must outlive the reader
+     * @param[in]  buffers      The buffers in the ring, at least 2
+     * @param[in]  buffer_size  The size of each buffer
+     */
+    explicit PrefetchReader(Read& source,
+                            size_t buffers = 4,
+                            size_t buffer_size = BUFFER_CAPACITY);
+    ~PrefetchReader();
+
+    ReadResult read(void* buffer, size_t bytes) override;
+
+    /**
+     * @brief      the source's size_hint() when the reader was made, less
+     *             what has been read since
+     */
+    Optional<size_t> size_hint() const override;
+
+private:
+    struct State;
+
+    UniquePtr<State> state_;
+    Optional<size_t> size_hint_;
+};
+
+} // namespace nx
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <nx/type.h>
+
+/**
+ * @brief compression codecs behind one interface
+ */
+namespace nx::compress {
+
+/**
+ * @brief      the codec of a frame, stored in its header. Values never
+ *             change.
+ */
+enum class CodecId : uint8_t {
+    STORE = 0,
+    ZLIB = 1,
+    LZ4 = 2,
+    ZSTD = 3,
+};
+
+/**
+ * @brief      a writer that compresses into a sink. finish() writes the end
+ *             of the stream, the destructor calls it if needed.
+ */
+class NX_API CodecWriter : public Write, private Uncopyable {
+public:
+    /**
+     * @brief      end the stream. Writes fail after it.
+     *
+     * @return     success?
+     */
+    virtual bool finish() = 0;
+};
+
+/**
+ * @brief      a compression algorithm. STORE is always registered, ZLIB,
+ *             LZ4 and ZSTD when nx is built with NX_BUILD_ZLIB, NX_BUILD_LZ4
+ *             and NX_BUILD_ZSTD. Other codecs can be registered under ids
+ *             from 128 up.
+ */
+class NX_API Codec {
+public:
+    virtual ~Codec();
+
+    virtual CodecId id() const = 0;
+    virtual const char* name() const = 0;
+
+    /**
+     * @brief      the level used for -1, the levels go from min_level() to
+     *             max_level(), higher is smaller and slower
+     */
+    virtual int default_level() const = 0;
+    virtual int min_level() const = 0;
+    virtual int max_level() const = 0;
+
+    /**
+     * @brief      the largest compressed size of len bytes
+     */
+    virtual size_t bound(size_t len) const = 0;
+
+    /**
+     * @brief      the largest size compress() output data could decompress
+     *             to, which decode() checks a frame's header against before
+     *             allocating. Nothing means no limit is known, the default.
+     *
+     * @param[in]  data  The compressed data
+     * @param[in]  len   The length
+     */
+    virtual Optional<size_t> max_raw_size(const uint8_t* data,
+                                          size_t len) const;
+
+    /**
+     * @brief      compress in one call
+     *
+     * @param[in]  data     The data
+     * @param[in]  len      The length
+     * @param      out      The output, at least bound(len) bytes
+     * @param[in]  level    The level, -1 for the default
+     *
+     * @return     The compressed size, nothing on error.
+     */
+    virtual Optional<size_t> compress(const uint8_t* data,
+                                      size_t len,
+                                      uint8_t* out,
+                                      int level) const
+        = 0;
+
+    /**
+     * @brief      decompress data whose size is known
+     *
+     * @param[in]  data     The compressed data
+     * @param[in]  len      The length
+     * @param      out      The output
+     * @param[in]  out_len  The exact decompressed size
+     *
+     * @return     success?
+     */
+    virtual bool decompress(const uint8_t* data,
+                            size_t len,
+                            uint8_t* out,
+                            size_t out_len) const
+        = 0;
+
+    /**
+     * @brief      a writer compressing into sink, in the codec's streaming
+     *             format, which may differ from compress()'s
+     */
+    virtual UniquePtr<CodecWriter> writer(Write& sink, int level) const = 0;
+
+    /**
+     * @brief      a reader of what writer() wrote
+     */
+    virtual UniquePtr<Read> reader(Read& source) const = 0;
+};
+
+/**
+ * @brief      add a codec, replacing one with the same id. The codec
+ *             replaced is kept until exit, so pointers to it and its readers
+ *             and writers stay valid.
+ */
+NX_API void register_codec(UniquePtr<Codec> codec);
+
+/**
+ * @brief      a codec by id, nullptr if it is not registered
+ */
+NX_API const Codec* find_codec(CodecId id);
+
+/**
+ * @brief      a codec by name ("store", "zlib", "lz4", "zstd"), nullptr if
+ *             it is not registered
+ */
+NX_API const Codec* find_codec(const String& name);
+
+/**
+ * @brief      every registered codec
+ */
+NX_API Vector<const Codec*> codecs();
+
+/**
+ * @brief      the size of a frame header
+ */
+constexpr size_t FRAME_HEADER_SIZE = 16;
+
+/**
+ * @brief      the raw size of a frame whose size was not known when it was
+ *             written
+ */
+constexpr uint64_t UNKNOWN_SIZE = UINT64_MAX;
+
+/**
+ * @brief      compress into a frame: a header recording the codec and the
+ *             raw size, then the output of the codec's compress(). decode()
+ *             then allocates its output exactly once.
+ *             ### Example
+ *
+ *                 auto frame = encode(*find_codec(CodecId::LZ4), data, len);
+ *                 auto back = decode(frame.data(), frame.size());
+ *
+ * @param[in]  codec  The codec
+ * @param[in]  data   The data
+ * @param[in]  len    The length
+ * @param[in]  level  The level, -1 for the codec's default
+ *
+ * @return     The frame, empty on error.
+ */
+NX_API ByteBuffer
+encode(const Codec& codec, const uint8_t* data, size_t len, int level = -1);
+
+/**
+ * @brief      decompress a frame written by encode() or frame_writer()
+ *
+ * @return     The data, IO_FAIL if the frame is corrupt or its codec is not
+ *             built in.
+ */
+NX_API ReadAllResult decode(const uint8_t* data, size_t len);
+
+/**
+ * @brief      a writer of one frame into sink, for data whose size is not
+ *             known up front. The header records UNKNOWN_SIZE and the data is
+ *             in the codec's streaming format.
+ */
+NX_API UniquePtr<CodecWriter>
+frame_writer(Write& sink, const Codec& codec, int level = -1);
+
+/**
+ * @brief      a reader of a frame from source, whatever its codec. Reads the
+ *             header first.
+ *
+ * @return     The reader, nullptr if the header is bad or its codec is not
+ *             built in.
+ */
+NX_API UniquePtr<Read> frame_reader(Read& source);
+
+} // namespace nx::compress
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <nx/type.h>
+
+namespace nx {
+
+/**
+ * @brief      the container around deflate data
+ */
+enum class DeflateFormat {
+    /**
+     * @brief  RFC 1950, what zlib_compress writes
+     */
+    ZLIB,
+    /**
+     * @brief  RFC 1952, what gzip writes. Readers accept zlib too, and
+     *         gzip files made of several members.
+     */
+    GZIP,
+    /**
+     * @brief  RFC 1951 with no header or checksum, as in zip archives
+     */
+    RAW,
+};
+
+/**
+ * @brief      the default buffer size of DeflateWriter and InflateReader
+ */
+constexpr size_t DEFLATE_BUFFER_SIZE = 64_kb;
+
+/**
+ * @brief      compresses what is written to it into sink, with memory
+ *             bounded by its buffer whatever the size of the data. finish()
+ *             writes the end of the stream, the destructor calls it if
+ *             needed. Panics if nx is built without zlib.
+ *             ### Example
+ *
+ *                 File out("log.gz");
+ *                 out.open_write();
+ *                 DeflateWriter writer(out, 6, DeflateFormat::GZIP);
+ *
+ *                 nx::pipe(log, writer);
+ *                 writer.finish();
+ *
+ */
+class NX_API DeflateWriter : public Write, private Uncopyable {
+public:
+    /**
+     * @brief      Constructs a new instance.
+     *
+     * @param      sink         The sink, must outlive the writer
+     * @param[in]  level        0 (store) to 9 (smallest), -1 is zlib's
+     *                          default of 6, others are clamped
+     * @param[in]  format       The format
+     * @param[in]  buffer_size  The size of the output buffer
+     */
+    explicit DeflateWriter(Write& sink,
+                           int level = -1,
+                           DeflateFormat format = DeflateFormat::ZLIB,
+                           size_t buffer_size = DEFLATE_BUFFER_SIZE);
+    ~DeflateWriter();
+
+    WriteResult write(const void* buffer, size_t bytes) override;
+
+    /**
+     * @brief      write out everything so far on a byte boundary, so that a
+     *             reader can decompress it before the stream ends. Costs a
+     *             few bytes and some compression each time.
+     *
+     * @return     success?
+     */
+    bool flush();
+
+    /**
+     * @brief      end the stream. Writes fail after it.
+     *
+     * @return     success?
+     */
+    bool finish();
+
+private:
+    struct Stream;
+
+    UniquePtr<Stream> stream_;
+};
+
+/**
+ * @brief      decompresses the data read from source. Reads fail with
+ *             IO_FAIL on corrupt or truncated data. Panics if nx is built
+ *             without zlib.
+ */
+class NX_API InflateReader : public Read, private Uncopyable {
+public:
+    /**
+     * @brief      Constructs a new instance.
+     *
+     * @param      source       The source, must outlive the reader
+     * @param[in]  format       The format
+     * @param[in]  buffer_size  The size of the input buffer
+     */
+    explicit InflateReader(Read& source,
+                           DeflateFormat format = DeflateFormat::ZLIB,
+                           size_t buffer_size = DEFLATE_BUFFER_SIZE);
+    ~InflateReader();
+
+    ReadResult read(void* buffer, size_t bytes) override;
+
+private:
+    struct Stream;
+
+    UniquePtr<Stream> stream_;
+};
+
+/**
+ * @brief      settings of parallel_compress
+ */
+struct ParallelCompressOptions {
+    /**
+     * @brief  0 (store) to 9 (smallest), -1 is zlib's default of 6, others
+     *         are clamped
+     */
+    int level = -1;
+    DeflateFormat format = DeflateFormat::GZIP;
+    /**
+     * @brief  0 means one per core
+     */
+    size_t threads = 0;
+    /**
+     * @brief  the input of one task. Smaller blocks spread better over
+     *         threads, each costs a few bytes of output.
+     */
+    size_t block_size = 128_kb;
+    /**
+     * @brief  the most memory the compressors and their pending output may
+     *         use, apart from the input. Fewer blocks are compressed at a
+     *         time to stay below it.
+     */
+    size_t memory_limit = 64 * 1024_kb;
+};
+
+/**
+ * @brief      compress on several threads into one standard stream, like
+ *             pigz. The input is cut into blocks compressed independently,
+ *             each primed with the 32 KB of input before it so the ratio
+ *             stays close to a single stream. Blocks are written to sink in
+ *             order as they are done. Panics if nx is built without zlib.
+ *             ### Example
+ *
+ *                 File out("snapshot.gz");
+ *                 out.open_write();
+ *                 auto snapshot = map_file("snapshot");
+ *
+ *                 parallel_compress(snapshot->data(), snapshot->size(), out);
+ *
+ * @param[in]  data     The data
+ * @param[in]  len      The length
+ * @param      sink     The sink
+ * @param[in]  options  The options
+ *
+ * @return     success?
+ */
+NX_API bool parallel_compress(const uint8_t* data,
+                              size_t len,
+                              Write& sink,
+                              const ParallelCompressOptions& options = {});
+
+/**
+ * @brief      parallel_compress into a buffer
+ *
+ * @return     The compressed data, empty on error.
+ */
+NX_API ByteBuffer
+parallel_compress(const uint8_t* data,
+                  size_t len,
+                  const ParallelCompressOptions& options = {});
+
+} // namespace nx
@@ -1,12 +1,68 @@
 #pragma once
 
 #include <nx/type.h>
+#include <nx/hex.h>
 
 /**
  * @brief digest namespace
  */
 namespace nx::digest {
 
+/**
+ * @brief      a raw digest of N bytes. A plain value: comparing, copying and
+ *             hashing it never allocates, and the hex form is only built
+ *             when to_hex() is called.
+ *             ### Example
+ *
+ *                 std::unordered_map<Sha256Digest, String> cache;
+ *
+ *                 auto it = cache.find(sha256_digest(data, len));
+ *
+ */
+template <size_t N>
+struct Digest {
+    uint8_t bytes[N];
+
+    static constexpr size_t size() { return N; }
+
+    const uint8_t* data() const { return bytes; }
+    uint8_t* data() { return bytes; }
+
+    bool operator==(const Digest& other) const
+    {
+        return memcmp(bytes, other.bytes, N) == 0;
+    }
+
+    bool operator!=(const Digest& other) const { return !(*this == other); }
+
+    bool operator<(const Digest& other) const
+    {
+        return memcmp(bytes, other.bytes, N) < 0;
+    }
+
+    /**
+     * @brief      lower case hex form, 2 * N characters
+     */
+    String to_hex() const { return hex_encode(bytes, N); }
+
+    /**
+     * @brief      parse a digest from 2 * N hex digits
+     *
+     * @return     The digest, or nothing if hex is not a valid digest.
+     */
+    static Optional<Digest> from_hex(const char* hex, size_t len)
+    {
+        Digest digest;
+        if (len != 2 * N || !hex_decode(hex, len, digest.bytes))
+            return {};
+        return digest;
+    }
+};
+
+using Md5Digest = Digest<16>;
+using Sha256Digest = Digest<32>;
+using Blake3Digest = Digest<32>;
+
 /**
  * @brief      MD5 algorithm
  *             ### Example
@@ -28,12 +84,13 @@ public:
     void reset();
 
     /**
-     * @brief      append more data to calculate md5
+     * @brief      append more data to calculate md5. Whole blocks are hashed
+     *             in place, there is no limit on length.
      *
      * @param[in]  input   The input
      * @param[in]  length  The length
      */
-    void update(const uint8_t* input, uint32_t length);
+    void update(const uint8_t* input, size_t length);
 
     /**
      * @brief      get md5
@@ -42,9 +99,16 @@ public:
      */
     void finish(uint8_t digest[16]);
 
+    /**
+     * @brief      get md5
+     *
+     * @return     The digest
+     */
+    Md5Digest finish();
+
 private:
     struct MD5_Context {
-        uint32_t total[2];
+        uint64_t total;
         uint32_t state[4];
         uint8_t buffer[64];
     };
@@ -53,14 +117,16 @@ private:
 
     static void md5_update(MD5_Context* ctx,
                            const uint8_t* input,
-                           uint32_t length);
+                           size_t length);
     static void md5_finish(MD5_Context* ctx, uint8_t digest[16]);
-    static void md5_process(MD5_Context* ctx, const uint8_t data[64]);
     static void md5_starts(MD5_Context* ctx);
 };
 
 /**
  * @brief      This class NX_API describes crc 32 algorithm.
+ *
+ *             The lookup tables are generated at compile time and shared,
+ *             so a CRC32 is just its 4 byte state and cheap to create.
  *             ### Example
  *
  *                 uint8_t digest[16];
@@ -90,10 +156,56 @@ public:
     uint32_t get_value() const;
 
 private:
-    uint32_t table_[256];
     uint32_t initial_;
 };
 
+/**
+ * @brief      crc32c (Castagnoli polynomial), as used by iSCSI, ext4 and
+ *             many storage formats. Uses the sse4.2 crc32 instruction when
+ *             the cpu has it.
+ *             ### Example
+ *
+ *                 CRC32C crc32c;
+ *
+ *                 crc32c.update("hello", 5);
+ *                 uint32_t checksum = crc32c.get_value();
+ *
+ */
+class NX_API CRC32C {
+public:
+    CRC32C();
+
+    /**
+     * @brief      put data
+     *
+     * @param[in]  buf   The buffer
+     * @param[in]  len   The length
+     */
+    void update(const uint8_t* buf, size_t len);
+
+    /**
+     * @brief      get crc32c value
+     *
+     * @return     The value.
+     */
+    uint32_t get_value() const;
+
+private:
+    uint32_t initial_;
+};
+
+/**
+ * @brief      SHA256 algorithm, using the Intel SHA extensions when the cpu
+ *             has them.
+ *             ### Example
+ *
+ *                 uint8_t digest[32];
+ *                 SHA256 sha256;
+ *
+ *                 sha256.update("hello", 5);
+ *                 sha256.finish(digest);
+ *
+ */
 class NX_API SHA256 {
 public:
     SHA256();
@@ -104,27 +216,32 @@ public:
     void reset();
 
     /**
-     * @brief      append more data to calculate md5
+     * @brief      append more data to calculate sha256. Whole blocks are
+     *             hashed in place, there is no limit on length.
      *
      * @param[in]  input   The input
      * @param[in]  length  The length
      */
-    void update(const uint8_t* input, uint32_t length);
+    void update(const uint8_t* input, size_t length);
 
     /**
-     * @brief      get md5
+     * @brief      get sha256
      *
-     * @param      digest  The buffer to accept md5
+     * @param      digest  The buffer to accept sha256
      */
     void finish(uint8_t digest[32]);
 
+    /**
+     * @brief      get sha256
+     *
+     * @return     The digest
+     */
+    Sha256Digest finish();
+
     struct SHA256_Context {
-        uint8_t buf[64];
         uint32_t hash[8];
-        uint32_t bits[2];
-        uint32_t len;
-        uint32_t rfu__;
-        uint32_t W[64];
+        uint64_t total;
+        uint8_t buf[64];
     };
 
 private:
@@ -135,13 +252,343 @@ private:
     // void sha256(const void *data, size_t len, uint8_t *hash);
 };
 
+/**
+ * @brief      BLAKE3, a cryptographic hash built as a tree over 1 KiB
+ *             chunks. Gives the same values as the reference BLAKE3
+ *             library. Whole chunks are compressed 4, 8 or 16 at a time
+ *             with sse4.1, avx2 or avx-512, and with more than one thread
+ *             large updates are split across threads, so a single big
+ *             buffer hashes at the speed of all cores.
+ *             ### Example
+ *
+ *                 BLAKE3 blake3(0);
+ *
+ *                 blake3.update(data, len);
+ *                 auto digest = blake3.finish();
+ *
+ */
+class NX_API BLAKE3 {
+public:
+    /**
+     * @brief      Constructs a new instance.
+     *
+     * @param[in]  threads  The maximum number of threads used by update, 0
+     *                      means one per core
+     */
+    explicit BLAKE3(size_t threads = 1);
+
+    /**
+     * @brief      Resets the object, keeping the thread count.
+     */
+    void reset();
+
+    /**
+     * @brief      append more data to hash. Splitting the data over several
+     *             calls gives the same hash, but updates of at least 1 MB
+     *             make the best use of threads.
+     *
+     * @param[in]  input   The input
+     * @param[in]  length  The length
+     */
+    void update(const uint8_t* input, size_t length);
+
+    /**
+     * @brief      get out_len bytes of extendable output, the first 32 of
+     *             which are the digest. More data may be appended afterwards.
+     *
+     * @param      out      The output
+     * @param[in]  out_len  The output length
+     */
+    void finish(uint8_t* out, size_t out_len) const;
+
+    /**
+     * @brief      get the 32 byte digest of the data so far
+     *
+     * @return     The digest
+     */
+    Blake3Digest finish() const;
+
+    struct Chunk_State {
+        uint32_t cv[8];
+        uint64_t counter;
+        uint8_t buf[64];
+        uint8_t buf_len;
+        uint8_t blocks_compressed;
+    };
+
+private:
+    void merge_cv_stack(uint64_t total_chunks);
+    void push_cv(const uint8_t cv[32], uint64_t chunk_counter);
+
+    Chunk_State chunk_;
+    // one chaining value per level of a tree of 2^64 bytes
+    uint8_t cv_stack_[55 * 32];
+    size_t cv_stack_len_;
+    size_t threads_;
+};
+
+/**
+ * @brief      a 128 bit hash value, as two 64 bit halves
+ */
+struct Hash128 {
+    uint64_t low64;
+    uint64_t high64;
+
+    bool operator==(const Hash128& other) const
+    {
+        return low64 == other.low64 && high64 == other.high64;
+    }
+
+    bool operator!=(const Hash128& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief      XXH3, a fast non-cryptographic hash with 64 and 128 bit
+ *             results, for hash tables, cache keys and change detection.
+ *             Gives the same values as the reference xxHash library. Uses
+ *             sse2 or avx2 for inputs longer than 240 bytes.
+ *             ### Example
+ *
+ *                 XXH3 xxh3;
+ *
+ *                 xxh3.update("hello", 5);
+ *                 uint64_t hash = xxh3.finish();
+ *
+ */
+class NX_API XXH3 {
+public:
+    explicit XXH3(uint64_t seed = 0);
+
+    /**
+     * @brief      Resets the object, keeping the seed.
+     */
+    void reset();
+
+    /**
+     * @brief      append more data to hash
+     *
+     * @param[in]  input   The input
+     * @param[in]  length  The length
+     */
+    void update(const uint8_t* input, size_t length);
+
+    /**
+     * @brief      get the 64 bit hash of the data so far. More data may be
+     *             appended afterwards.
+     *
+     * @return     The hash
+     */
+    uint64_t finish() const;
+
+    /**
+     * @brief      get the 128 bit hash of the data so far
+     *
+     * @return     The hash
+     */
+    Hash128 finish_128() const;
+
+private:
+    void digest_long(uint64_t acc[8]) const;
+
+    alignas(64) uint64_t acc_[8];
+    alignas(64) uint8_t secret_[192];
+    alignas(64) uint8_t buffer_[256];
+    size_t buffered_;
+    size_t stripes_;
+    uint64_t total_;
+    uint64_t seed_;
+};
+
 NX_API String md5(const uint8_t* data, size_t len);
 NX_API String md5(const char* data);
 
 NX_API String sha256(const uint8_t* data, size_t len);
 NX_API String sha256(const char* data);
 
+/**
+ * @brief      md5 as a raw digest, without building the hex string
+ */
+NX_API Md5Digest md5_digest(const uint8_t* data, size_t len);
+NX_API Md5Digest md5_digest(const char* data);
+
+/**
+ * @brief      sha256 as a raw digest, without building the hex string
+ */
+NX_API Sha256Digest sha256_digest(const uint8_t* data, size_t len);
+NX_API Sha256Digest sha256_digest(const char* data);
+
+NX_API String blake3(const uint8_t* data, size_t len);
+NX_API String blake3(const char* data);
+
+/**
+ * @brief      blake3 as a raw digest, without building the hex string
+ */
+NX_API Blake3Digest blake3_digest(const uint8_t* data, size_t len);
+NX_API Blake3Digest blake3_digest(const char* data);
+
+/**
+ * @brief      blake3 of a large buffer, its subtrees hashed on several
+ *             threads. Gives the same value as blake3_digest(data, len).
+ *
+ * @param[in]  data     The data
+ * @param[in]  len      The length
+ * @param[in]  threads  The maximum number of threads, 0 means one per core
+ *
+ * @return     The digest
+ */
+NX_API Blake3Digest parallel_blake3(const uint8_t* data,
+                                    size_t len,
+                                    size_t threads = 0);
+
+/**
+ * @brief      feed everything left in reader to hasher, reading through a
+ *             large aligned buffer.
+ *             ### Example
+ *
+ *                 nx::fs::File file(path);
+ *                 SHA256 sha256;
+ *
+ *                 if (file.open_read() && hash_stream(file, sha256)) {
+ *                     auto digest = sha256.finish();
+ *                 }
+ *
+ * @param      reader  The reader
+ * @param      hasher  The hasher
+ *
+ * @return     false on a read error.
+ */
+NX_API bool hash_stream(Read& reader, MD5& hasher);
+NX_API bool hash_stream(Read& reader, SHA256& hasher);
+NX_API bool hash_stream(Read& reader, BLAKE3& hasher);
+NX_API bool hash_stream(Read& reader, CRC32& hasher);
+NX_API bool hash_stream(Read& reader, CRC32C& hasher);
+
+/**
+ * @brief      md5 of everything left in reader
+ *
+ * @return     The digest, or nothing on a read error.
+ */
+NX_API Optional<Md5Digest> md5_digest(Read& reader);
+
+/**
+ * @brief      sha256 of everything left in reader
+ *
+ * @return     The digest, or nothing on a read error.
+ */
+NX_API Optional<Sha256Digest> sha256_digest(Read& reader);
+
+/**
+ * @brief      blake3 of everything left in reader
+ *
+ * @return     The digest, or nothing on a read error.
+ */
+NX_API Optional<Blake3Digest> blake3_digest(Read& reader);
+
+/**
+ * @brief      md5 of many independent buffers. On avx2 cpus eight buffers
+ *             are hashed at once, one per simd lane.
+ *
+ * @param[in]  inputs   The buffers
+ * @param[in]  count    The number of buffers
+ * @param      digests  Receives count * 16 bytes, the raw digest of
+ *                      inputs[i] at digests + 16 * i
+ * @param[in]  threads  The maximum number of threads, 0 means one per core
+ */
+NX_API void md5_many(const ByteSpan* inputs,
+                     size_t count,
+                     uint8_t* digests,
+                     size_t threads = 1);
+
+/**
+ * @brief      sha256 of many independent buffers. Uses the sha extensions
+ *             when available, otherwise on avx2 cpus eight buffers are
+ *             hashed at once, one per simd lane.
+ *
+ * @param[in]  inputs   The buffers
+ * @param[in]  count    The number of buffers
+ * @param      digests  Receives count * 32 bytes, the raw digest of
+ *                      inputs[i] at digests + 32 * i
+ * @param[in]  threads  The maximum number of threads, 0 means one per core
+ */
+NX_API void sha256_many(const ByteSpan* inputs,
+                        size_t count,
+                        uint8_t* digests,
+                        size_t threads = 1);
+
+inline void md5_many(const ByteSpan* inputs,
+                     size_t count,
+                     Md5Digest* digests,
+                     size_t threads = 1)
+{
+    static_assert(sizeof(Md5Digest) == 16);
+    md5_many(inputs, count, (uint8_t*)digests, threads);
+}
+
+inline void sha256_many(const ByteSpan* inputs,
+                        size_t count,
+                        Sha256Digest* digests,
+                        size_t threads = 1)
+{
+    static_assert(sizeof(Sha256Digest) == 32);
+    sha256_many(inputs, count, (uint8_t*)digests, threads);
+}
+
+/**
+ * @brief      64 bit XXH3 of a buffer, see XXH3
+ */
+NX_API uint64_t xxh3_64(const uint8_t* data, size_t len, uint64_t seed = 0);
+
+/**
+ * @brief      128 bit XXH3 of a buffer, see XXH3
+ */
+NX_API Hash128 xxh3_128(const uint8_t* data, size_t len, uint64_t seed = 0);
+
 NX_API uint32_t crc32(const uint8_t* data, size_t len);
 NX_API uint32_t crc32(const char* data);
 
+NX_API uint32_t crc32c(const uint8_t* data, size_t len);
+NX_API uint32_t crc32c(const char* data);
+
+/**
+ * @brief      combine the crc32 of two adjacent blocks A and B into the crc32
+ *             of A followed by B, in O(log len_b).
+ *
+ * @param[in]  crc_a  The crc32 of A
+ * @param[in]  crc_b  The crc32 of B
+ * @param[in]  len_b  The length of B
+ *
+ * @return     The crc32 of A followed by B.
+ */
+NX_API uint32_t crc32_combine(uint32_t crc_a, uint32_t crc_b, uint64_t len_b);
+
+/**
+ * @brief      crc32 of a large buffer, checksummed in chunks on several
+ *             threads and merged with crc32_combine. Gives the same value as
+ *             crc32(data, len).
+ *
+ * @param[in]  data     The data
+ * @param[in]  len      The length
+ * @param[in]  threads  The maximum number of threads, 0 means one per core
+ *
+ * @return     The crc32.
+ */
+NX_API uint32_t parallel_crc32(const uint8_t* data,
+                               size_t len,
+                               size_t threads = 0);
+
 } // namespace nx::digest
+
+/**
+ * @brief      digests are already uniformly distributed, so their first
+ *             bytes make a good hash
+ */
+template <size_t N>
+struct std::hash<nx::digest::Digest<N>> {
+    size_t operator()(const nx::digest::Digest<N>& digest) const noexcept
+    {
+        static_assert(N >= sizeof(size_t));
+        size_t h;
+        memcpy(&h, digest.bytes, sizeof(h));
+        return h;
+    }
+};
@@ -84,11 +84,87 @@ public:
     ReadResult read(void* buffer, size_t bytes) override;
     WriteResult write(const void* buffer, size_t bytes) override;
 
+    /**
+     * @brief      the bytes between the read position and the end of a
+     *             regular file, nothing for pipes and terminals
+     */
+    Optional<size_t> size_hint() const override;
+
+    /**
+     * @brief      on Linux, copy from the read position to the end into a
+     *             File open for write, with copy_file_range, sendfile or
+     *             splice. Both read and write positions move past the copied
+     *             data as if read() and write() had done it. A pipe goes
+     *             through the kernel only while read() was never called,
+     *             since the stream may hold data it read ahead.
+     */
+    Optional<bool> copy_to(Write& sink) override;
+
+    /**
+     * @brief      the size of a regular file, including writes still
+     *             buffered by this File
+     *
+     * @return     The size, or nothing for pipes and terminals.
+     */
+    Optional<uint64_t> size() const;
+
+    /**
+     * @brief      read up to bytes at offset, without using or moving the
+     *             read position. Any number of threads may call read_at and
+     *             readv on one File at once. Requires a file open for read.
+     *             On Windows the position is saved and restored around each
+     *             call, which keeps it only while calls do not overlap.
+     *             ### Example
+     *
+     *                 uint8_t header[64];
+     *                 auto result = file.read_at(0, header, sizeof(header));
+     *
+     * @param[in]  offset  The offset from the start of the file
+     * @param      buffer  The buffer
+     * @param[in]  bytes   The number of bytes
+     *
+     * @return     EndOfFile if offset is at or past the end, otherwise the
+     *             bytes read, fewer than asked only at the end of the file.
+     */
+    ReadResult read_at(uint64_t offset, void* buffer, size_t bytes);
+
+    /**
+     * @brief      write bytes at offset, without using or moving the write
+     *             position. Requires a file open for write.
+     *
+     * @return     The bytes written, all of them unless there is an error.
+     */
+    WriteResult write_at(uint64_t offset, const void* buffer, size_t bytes);
+
+    /**
+     * @brief      scatter read: fill the buffers in order with the data
+     *             starting at offset, in as few system calls as possible
+     *
+     * @param[in]  offset   The offset from the start of the file
+     * @param[in]  buffers  The buffers
+     * @param[in]  count    The number of buffers
+     *
+     * @return     as read_at, for the total size of the buffers
+     */
+    ReadResult readv(uint64_t offset,
+                     const MutableByteSpan* buffers,
+                     size_t count);
+
+    /**
+     * @brief      gather write: write the buffers one after the other
+     *             starting at offset
+     *
+     * @return     as write_at, for the total size of the buffers
+     */
+    WriteResult writev(uint64_t offset, const ByteSpan* buffers, size_t count);
+
 private:
     String path_;
     Optional<OpenMode> mode_;
     FILE* fp_;
     bool strong_ref_;
+    // read() was called, the stream may hold data read ahead
+    bool read_through_;
 };
 
 /**
@@ -115,16 +191,148 @@ NX_API File& err();
 
 NX_API ReadAllResult read_file(const String& path);
 
+/**
+ * @brief      copy a file with pipe(), inside the kernel where possible
+ *
+ * @param[in]  from  The source path
+ * @param[in]  to    The destination path, replaced if it exists
+ *
+ * @return     success?
+ */
+NX_API bool copy_file(const String& from, const String& to);
+
+/**
+ * @brief      how a mapped file is going to be accessed, passed on to the
+ *             kernel so it can tune read ahead
+ */
+enum class MapAdvice {
+    NORMAL,
+    SEQUENTIAL,
+    RANDOM,
+    WILL_NEED,
+};
+
+/**
+ * @brief      a file mapped read only into memory. span() views the whole
+ *             file without copying it, and read() copies from the mapping
+ *             like any other reader. On Windows the file is read into a
+ *             buffer instead.
+ *             ### Example
+ *
+ *                 MappedFile file(path);
+ *
+ *                 if (file.open()) {
+ *                     file.advise(MapAdvice::SEQUENTIAL);
+ *                     parse(file.data(), file.size());
+ *                 }
+ *
+ */
+class NX_API MappedFile : public Read, private Uncopyable {
+public:
+    explicit MappedFile(const String& path);
+    ~MappedFile();
+
+    /**
+     * @brief      map the whole file
+     *
+     * @return     false if the file can not be opened or mapped.
+     */
+    bool open();
+
+    /**
+     * @brief      unmap the file. Views into it are no longer valid.
+     */
+    void close();
+
+    bool is_open() const { return open_; }
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    ByteSpan span() const { return { data_, size_ }; }
+
+    /**
+     * @brief      hint how the whole file will be accessed
+     *
+     * @return     false if the hint was rejected
+     */
+    bool advise(MapAdvice advice) { return advise(advice, 0, size_); }
+
+    /**
+     * @brief      hint how a range of the file will be accessed
+     *
+     * @param[in]  advice  The advice
+     * @param[in]  offset  The offset of the range
+     * @param[in]  len     The length of the range
+     *
+     * @return     false if the hint was rejected
+     */
+    bool advise(MapAdvice advice, size_t offset, size_t len);
+
+    /**
+     * @brief      copy the next bytes of the file, starting at the beginning
+     */
+    ReadResult read(void* buffer, size_t bytes) override;
+    Optional<size_t> size_hint() const override;
+
+private:
+    String path_;
+    const uint8_t* data_;
+    size_t size_;
+    size_t read_pos_;
+    bool open_;
+    ByteBuffer fallback_;
+};
+
+/**
+ * @brief      map a file read only, the counterpart of read_file that does
+ *             not copy
+ *
+ * @param[in]  path  The path
+ *
+ * @return     The mapped file, or nullptr if it can not be opened.
+ */
+NX_API UniquePtr<MappedFile> map_file(const String& path);
+
 class NX_API Archive {
 public:
     virtual ~Archive() = 0;
     virtual Vector<String> list_dir(const String& path) = 0;
     virtual UniquePtr<Read> open(const String& path) = 0;
+
+    /**
+     * @brief      the bytes of a file stored without compression, straight
+     *             from the archive's memory, valid while the archive lives.
+     *             Unlike open() nothing is copied or checked.
+     *
+     * @return     nothing if the file does not exist, is compressed or the
+     *             archive is not in memory
+     */
+    virtual Optional<ByteSpan> view(const String& path)
+    {
+        (void)path;
+        return std::nullopt;
+    }
 };
 
-// dir:///
-// zip:///
+/**
+ * @brief      open an archive.
+ *             dir:///path is a directory.
+ *             zip:///path is a zip file, mapped into memory and read without
+ *             libzip: stored files are views of the mapping, deflated ones
+ *             are inflated as they are read. Archives using other features
+ *             (encryption, other methods, several disks) go through libzip
+ *             when nx is built with it.
+ *
+ * @param[in]  file_uri  The uri
+ *
+ * @return     The archive, nullptr if it can not be opened.
+ */
 NX_API UniquePtr<Archive> create_archive(const String& file_uri);
+
+/**
+ * @brief      open a zip archive in memory, like zip:// without the mapping.
+ *             The buffer must outlive the archive.
+ */
 NX_API UniquePtr<Archive> create_zip_archive_from_memory(const void* buf,
                                                          size_t len);
 
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <nx/type.h>
+
+namespace nx {
+
+/**
+ * @brief      a hex string could not be decoded
+ */
+struct HexError {
+    /**
+     * @brief  offset of the first invalid character. For an odd length
+     *         input this is the length, where the missing digit would be.
+     */
+    size_t position;
+};
+
+using HexDecodeResult = Variant<HexError, ByteBuffer>;
+
+/**
+ * @brief      encode bytes as lower case hex. Uses ssse3 or avx2 when the cpu
+ *             has them.
+ *
+ * @param[in]  data    The data
+ * @param[in]  len     The length
+ * @param      output  Receives 2 * len characters, not null terminated
+ */
+NX_API void hex_encode(const uint8_t* data, size_t len, char* output);
+
+NX_API String hex_encode(const uint8_t* data, size_t len);
+NX_API String hex_encode(const ByteBuffer& data);
+
+/**
+ * @brief      decode hex digits, either case, into bytes.
+ *
+ * @param[in]  hex        The hex digits
+ * @param[in]  len        The number of digits, must be even
+ * @param      output     Receives len / 2 bytes
+ * @param      error_pos  If not null, receives the HexError position on
+ *                        failure
+ *
+ * @return     false if the input is not valid hex, output is then only
+ *             partially written.
+ */
+NX_API bool hex_decode(const char* hex,
+                       size_t len,
+                       uint8_t* output,
+                       size_t* error_pos = nullptr);
+
+/**
+ * @brief      decode hex digits, either case, into a buffer
+ *             ### Example
+ *
+ *                 auto result = nx::hex_decode(line);
+ *                 if (auto error = std::get_if<nx::HexError>(&result)) {
+ *                     NX_LOG_ERROR("bad hex at %zu", error->position);
+ *                 }
+ *
+ */
+NX_API HexDecodeResult hex_decode(const char* hex, size_t len);
+NX_API HexDecodeResult hex_decode(const String& hex);
+
+} // namespace nx
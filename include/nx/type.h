@@ -40,6 +40,22 @@ namespace nx {
  */
 using ByteBuffer = std::vector<uint8_t>;
 
+/**
+ * @brief read only view of contiguous bytes
+ */
+struct ByteSpan {
+    const uint8_t* data;
+    size_t size;
+};
+
+/**
+ * @brief writable view of contiguous bytes
+ */
+struct MutableByteSpan {
+    uint8_t* data;
+    size_t size;
+};
+
 template <class T>
 using Optional = std::optional<T>;
 
@@ -118,24 +134,144 @@ enum class IO_Error {
     IO_FAIL,
 };
 
+/**
+ * @brief The variant results read and write returned before IoResult
+ */
+using ReadVariant = Variant<IO_Error, EndOfFile, IO_Success>;
+using WriteVariant = Variant<IO_Error, IO_Success>;
+
+/**
+ * @brief      Result of a read or write, packed in one integer: the bytes
+ *             moved, the end of file or an error. It is built implicitly
+ *             from IO_Success, EndOfFile and IO_Error, and converts to and
+ *             from the variants for code written against them.
+ *             ### Example
+ *
+ *                 auto result = file.read(buffer, sizeof(buffer));
+ *
+ *                 if (result.ok()) {
+ *                     consume(buffer, result.bytes());
+ *                 } else if (result.failed()) {
+ *                     return result.error();
+ *                 }
+ *
+ */
+class IoResult {
+public:
+    constexpr IoResult(IO_Success success) : value_((int64_t)success.bytes) { }
+    constexpr IoResult(EndOfFile) : value_(END_OF_FILE) { }
+    constexpr IoResult(IO_Error error)
+    : value_(FIRST_ERROR - (int64_t)error)
+    {
+    }
+
+    IoResult(const ReadVariant& result)
+    : IoResult(std::visit([](auto v) { return IoResult(v); }, result))
+    {
+    }
+
+    IoResult(const WriteVariant& result)
+    : IoResult(std::visit([](auto v) { return IoResult(v); }, result))
+    {
+    }
+
+    /**
+     * @brief      bytes were moved, maybe none
+     */
+    constexpr bool ok() const { return value_ >= 0; }
+
+    /**
+     * @brief      the end of file, reads only
+     */
+    constexpr bool eof() const { return value_ == END_OF_FILE; }
+
+    constexpr bool failed() const { return value_ <= FIRST_ERROR; }
+
+    /**
+     * @brief      the bytes moved, 0 unless ok()
+     */
+    constexpr size_t bytes() const { return ok() ? (size_t)value_ : 0; }
+
+    /**
+     * @brief      the error, only meaningful if failed()
+     */
+    constexpr IO_Error error() const
+    {
+        return (IO_Error)(FIRST_ERROR - value_);
+    }
+
+    operator ReadVariant() const
+    {
+        if (ok())
+            return IO_Success { bytes() };
+        if (eof())
+            return EndOfFile {};
+        return error();
+    }
+
+    /**
+     * @brief      the write variant, which has no end of file
+     */
+    operator WriteVariant() const
+    {
+        if (failed())
+            return error();
+        return IO_Success { bytes() };
+    }
+
+    constexpr bool operator==(const IoResult& other) const
+    {
+        return value_ == other.value_;
+    }
+
+    constexpr bool operator!=(const IoResult& other) const
+    {
+        return value_ != other.value_;
+    }
+
+private:
+    static constexpr int64_t END_OF_FILE = -1;
+    static constexpr int64_t FIRST_ERROR = -2;
+
+    int64_t value_;
+};
+
 /**
  * @brief Result of a read operation
  */
-using ReadResult = Variant<IO_Error, EndOfFile, IO_Success>;
+using ReadResult = IoResult;
 using ReadAllResult = Variant<IO_Error, ByteBuffer>;
 
+class Write;
+
 class NX_API Read {
 public:
     virtual ~Read() = 0;
     virtual ReadResult read(void* buffer, size_t bytes) = 0;
+
+    /**
+     * @brief      the number of bytes left to read, if the reader knows it.
+     *             read_all uses it to allocate its buffer once.
+     */
+    virtual Optional<size_t> size_hint() const { return std::nullopt; }
+
+    /**
+     * @brief      copy everything left to sink without a user space buffer,
+     *             when both ends allow it. pipe() tries this first.
+     *
+     * @return     nothing if the copy is not possible, then nothing was
+     *             read, otherwise whether it succeeded
+     */
+    virtual Optional<bool> copy_to(Write&) { return std::nullopt; }
+
     bool read_exact(void* buffer, size_t bytes);
     ReadAllResult read_all();
 };
 
 /**
- * @brief Result of a write operation
+ * @brief Result of a write operation, never the end of file
  */
-using WriteResult = Variant<IO_Error, IO_Success>;
+using WriteResult = IoResult;
 
 class NX_API Write {
 public:
@@ -145,20 +281,32 @@ public:
 };
 
 /**
- * @brief      pipe data from reader to writer
+ * @brief      the default buffer size of pipe()
+ */
+constexpr size_t PIPE_BUFFER_SIZE = 128_kb;
+
+/**
+ * @brief      pipe data from reader to writer. Files are copied inside the
+ *             kernel when the platform allows it, anything else through a
+ *             buffer.
  *
- * @param      reader  The reader
- * @param      writer  The writer
+ * @param      reader       The reader
+ * @param      writer       The writer
+ * @param[in]  buffer_size  The buffer size, never more than the reader's
+ *                          size_hint() needs
  *
  * @return     success?
  */
-NX_API bool pipe(Read& reader, Write& writer);
-NX_API bool pipe(Read* reader, Write* writer);
+NX_API bool
+pipe(Read& reader, Write& writer, size_t buffer_size = PIPE_BUFFER_SIZE);
+NX_API bool
+pipe(Read* reader, Write* writer, size_t buffer_size = PIPE_BUFFER_SIZE);
 
 class NX_API MemoryFile : public Read, private Uncopyable {
 public:
     MemoryFile(const uint8_t* buffer, size_t buf_len);
     ReadResult read(void* buffer, size_t bytes) override;
+    Optional<size_t> size_hint() const override;
 
 private:
     const uint8_t* buffer_;
@@ -249,8 +397,33 @@ inline bool is_pow2(T x) { return ((x - 1) & x) == 0; }
 // NX_API void set_error_log(PrintLike fn);
 // NX_API void set_no_error_log();
 
-NX_API ByteBuffer zlib_compress(const uint8_t* buf, size_t len);
-NX_API ByteBuffer zlib_uncompress(const uint8_t* buf, size_t len);
+/**
+ * @brief      compress into the zlib format (RFC 1950) in one call, into a
+ *             buffer sized by compressBound. Panics if nx is built without
+ *             zlib. DeflateWriter in nx/compress.h streams instead.
+ *
+ * @param[in]  buf    The data
+ * @param[in]  len    The length
+ * @param[in]  level  0 (store) to 9 (smallest), -1 is zlib's default of 6,
+ *                    others are clamped
+ *
+ * @return     The compressed data, empty on error.
+ */
+NX_API ByteBuffer zlib_compress(const uint8_t* buf, size_t len, int level = -1);
+
+/**
+ * @brief      uncompress zlib data in one call. A gzip header (RFC 1952),
+ *             as parallel_compress writes by default, is detected too.
+ *
+ * @param[in]  buf        The compressed data
+ * @param[in]  len        The length
+ * @param[in]  size_hint  The uncompressed size if known, then the output is
+ *                        allocated once. 0 means unknown.
+ *
+ * @return     The data, empty on error.
+ */
+NX_API ByteBuffer
+zlib_uncompress(const uint8_t* buf, size_t len, size_t size_hint = 0);
 
 } // namespace nx
 
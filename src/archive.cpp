@@ -1,4 +1,6 @@
 #include <nx/file_system.h>
+#include <nx/compress.h>
+#include <nx/digest.h>
 #include "url-parser/url.hpp"
 #include <nx/log.h>
 
@@ -12,7 +14,7 @@ template <class Data>
 struct FileNode {
     String name;
     Vector<UniquePtr<FileNode>> children;
-    Data data;
+    Data data {};
 };
 
 template <class Data>
@@ -157,11 +159,408 @@ private:
     String root_dir_;
 };
 
+// MappedZipArchive
+
+namespace {
+
+// APPNOTE.TXT, all little endian
+constexpr uint32_t ZIP_LOCAL_HEADER = 0x04034b50;
+constexpr uint32_t ZIP_CENTRAL_HEADER = 0x02014b50;
+constexpr uint32_t ZIP_END = 0x06054b50;
+constexpr uint32_t ZIP64_END = 0x06064b50;
+constexpr uint32_t ZIP64_LOCATOR = 0x07064b50;
+constexpr uint16_t ZIP64_EXTRA = 0x0001;
+
+constexpr size_t ZIP_LOCAL_HEADER_SIZE = 30;
+constexpr size_t ZIP_CENTRAL_HEADER_SIZE = 46;
+constexpr size_t ZIP_END_SIZE = 22;
+constexpr size_t ZIP64_END_SIZE = 56;
+constexpr size_t ZIP64_LOCATOR_SIZE = 20;
+
+constexpr uint16_t ZIP_ENCRYPTED = 1;
+
+enum class ZipMethod : uint16_t {
+    STORED = 0,
+    DEFLATED = 8,
+};
+
+uint16_t load_u16(const uint8_t* p) { return (uint16_t)(p[0] | p[1] << 8); }
+
+uint32_t load_u32(const uint8_t* p)
+{
+    return (uint32_t)load_u16(p) | (uint32_t)load_u16(p + 2) << 16;
+}
+
+uint64_t load_u64(const uint8_t* p)
+{
+    return (uint64_t)load_u32(p) | (uint64_t)load_u32(p + 4) << 32;
+}
+
+struct ZipRecord {
+    uint16_t method;
+    uint32_t crc;
+    uint64_t compressed_size;
+    uint64_t size;
+    uint64_t local_header;
+};
+
+enum class ZipParse {
+    OK,
+    // well formed, with files that need libzip
+    UNSUPPORTED,
+    CORRUPT,
+};
+
+// reads a stored file from the mapping, checking its crc once the last
+// byte is read
+class StoredEntry : public Read {
+public:
+    StoredEntry(ByteSpan data, uint32_t crc)
+    : source_(data.data, data.size)
+    , remain_(data.size)
+    , crc_(crc)
+    {
+    }
+
+    ReadResult read(void* buffer, size_t bytes) override
+    {
+        auto result = source_.read(buffer, bytes);
+        if (result.ok()) {
+            remain_ -= result.bytes();
+            checksum_.update((const uint8_t*)buffer, result.bytes());
+            if (remain_ == 0 && checksum_.get_value() != crc_)
+                return IO_Error::IO_FAIL;
+        } else if (result.eof()) {
+            if (checksum_.get_value() != crc_)
+                return IO_Error::IO_FAIL;
+        }
+        return result;
+    }
+
+    Optional<size_t> size_hint() const override { return remain_; }
+
+private:
+    MemoryFile source_;
+    size_t remain_;
+    uint32_t crc_;
+    digest::CRC32 checksum_;
+};
+
+#if defined(USE_ZLIB)
+
+// inflates a deflated file from the mapping, checking its size and crc at
+// the end
+class InflatedEntry : public Read {
+public:
+    InflatedEntry(ByteSpan data, size_t size, uint32_t crc)
+    : source_(data.data, data.size)
+    , inflate_(source_,
+               DeflateFormat::RAW,
+               std::min<size_t>(data.size + 1, DEFLATE_BUFFER_SIZE))
+    , remain_(size)
+    , crc_(crc)
+    // a deflate match of 258 bytes takes at least 2 bits, a larger size
+    // is forged and not worth allocating for
+    , plausible_(data.size >= SIZE_MAX / 1032 || size <= data.size * 1032)
+    {
+    }
+
+    ReadResult read(void* buffer, size_t bytes) override
+    {
+        auto result = inflate_.read(buffer, bytes);
+        if (result.ok()) {
+            if (result.bytes() > remain_)
+                return IO_Error::IO_FAIL;
+            remain_ -= result.bytes();
+            checksum_.update((const uint8_t*)buffer, result.bytes());
+            // read_exact stops at the size, it sees no EOF
+            if (remain_ == 0 && checksum_.get_value() != crc_)
+                return IO_Error::IO_FAIL;
+        } else if (result.eof()) {
+            if (remain_ != 0 || checksum_.get_value() != crc_)
+                return IO_Error::IO_FAIL;
+        }
+        return result;
+    }
+
+    Optional<size_t> size_hint() const override
+    {
+        if (!plausible_)
+            return std::nullopt;
+        return remain_;
+    }
+
+private:
+    MemoryFile source_;
+    InflateReader inflate_;
+    size_t remain_;
+    uint32_t crc_;
+    bool plausible_;
+    digest::CRC32 checksum_;
+};
+
+#endif
+
+} // namespace
+
+class MappedZipArchive : public Archive {
+public:
+    explicit MappedZipArchive(UniquePtr<MappedFile> file)
+    : file_(std::move(file))
+    , data_(file_->data())
+    , size_(file_->size())
+    {
+    }
+
+    MappedZipArchive(const void* buf, size_t len)
+    : data_((const uint8_t*)buf)
+    , size_(len)
+    {
+    }
+
+    ZipParse parse()
+    {
+        const uint8_t* end = find_end();
+        if (!end)
+            return ZipParse::CORRUPT;
+
+        uint64_t count = load_u16(end + 10);
+        uint64_t directory_size = load_u32(end + 12);
+        uint64_t directory = load_u32(end + 16);
+        if (load_u16(end + 4) != 0 || load_u16(end + 6) != 0)
+            return ZipParse::UNSUPPORTED;
+
+        // zip64 moves the counts, sizes and offsets to a larger record
+        size_t end_offset = end - data_;
+        if (end_offset >= ZIP64_LOCATOR_SIZE
+            && load_u32(end - ZIP64_LOCATOR_SIZE) == ZIP64_LOCATOR) {
+            uint64_t offset = load_u64(end - ZIP64_LOCATOR_SIZE + 8);
+            if (offset > size_ || size_ - offset < ZIP64_END_SIZE
+                || load_u32(data_ + offset) != ZIP64_END)
+                return ZipParse::CORRUPT;
+
+            const uint8_t* end64 = data_ + offset;
+            if (load_u32(end64 + 16) != 0 || load_u32(end64 + 20) != 0)
+                return ZipParse::UNSUPPORTED;
+            count = load_u64(end64 + 32);
+            directory_size = load_u64(end64 + 40);
+            directory = load_u64(end64 + 48);
+        }
+
+        if (directory > size_ || size_ - directory < directory_size)
+            return ZipParse::CORRUPT;
+
+        // each record takes at least its fixed part
+        if (count > directory_size / ZIP_CENTRAL_HEADER_SIZE)
+            return ZipParse::CORRUPT;
+
+        ZipParse status = ZipParse::OK;
+        const uint8_t* p = data_ + directory;
+        const uint8_t* directory_end = p + directory_size;
+        records_.reserve(count);
+        while (count-- > 0) {
+            auto parsed = parse_record(p, directory_end);
+            if (parsed == ZipParse::CORRUPT)
+                return parsed;
+            if (parsed == ZipParse::UNSUPPORTED) {
+                status = parsed;
+            }
+        }
+        return status;
+    }
+
+    Vector<String> list_dir(const String& path) override
+    {
+        NX_ASSERT(path.size() > 0 && path[0] == '/',
+                  "list_dir expect path start with '/'");
+        return vfs_.list_dir(path);
+    }
+
+    UniquePtr<Read> open(const String& path) override
+    {
+        NX_ASSERT(path.size() > 0 && path[0] == '/',
+                  "Archive::open expect path start with '/'");
+
+        const ZipRecord* record = find_record(path);
+        if (!record)
+            return nullptr;
+        auto data = record_data(*record);
+        if (!data)
+            return nullptr;
+
+        switch ((ZipMethod)record->method) {
+            case ZipMethod::STORED:
+                return std::make_unique<StoredEntry>(*data, record->crc);
+            case ZipMethod::DEFLATED:
+#if defined(USE_ZLIB)
+                return std::make_unique<InflatedEntry>(
+                    *data, record->size, record->crc);
+#else
+                NX_LOG_WARNING("zip: %s is deflated, build without zlib\n",
+                               path.c_str());
+                return nullptr;
+#endif
+        }
+        NX_LOG_WARNING("zip: %s uses method %d\n",
+                       path.c_str(),
+                       (int)record->method);
+        return nullptr;
+    }
+
+    Optional<ByteSpan> view(const String& path) override
+    {
+        const ZipRecord* record = find_record(path);
+        if (!record || (ZipMethod)record->method != ZipMethod::STORED)
+            return std::nullopt;
+        return record_data(*record);
+    }
+
+private:
+    // the end of central directory record, the last one in the file, which
+    // a comment of up to 64 KB may follow
+    const uint8_t* find_end() const
+    {
+        if (size_ < ZIP_END_SIZE)
+            return nullptr;
+
+        size_t last = size_ - ZIP_END_SIZE;
+        size_t first = last > 0xffff ? last - 0xffff : 0;
+        for (size_t i = last + 1; i-- > first;) {
+            if (load_u32(data_ + i) == ZIP_END
+                && i + ZIP_END_SIZE + load_u16(data_ + i + 20) <= size_)
+                return data_ + i;
+        }
+        return nullptr;
+    }
+
+    ZipParse parse_record(const uint8_t*& p, const uint8_t* end)
+    {
+        if (end - p < (ptrdiff_t)ZIP_CENTRAL_HEADER_SIZE
+            || load_u32(p) != ZIP_CENTRAL_HEADER)
+            return ZipParse::CORRUPT;
+
+        uint16_t flags = load_u16(p + 8);
+        ZipRecord record;
+        record.method = load_u16(p + 10);
+        record.crc = load_u32(p + 16);
+        record.compressed_size = load_u32(p + 20);
+        record.size = load_u32(p + 24);
+        size_t name_len = load_u16(p + 28);
+        size_t extra_len = load_u16(p + 30);
+        size_t comment_len = load_u16(p + 32);
+        uint16_t disk = load_u16(p + 34);
+        record.local_header = load_u32(p + 42);
+
+        const uint8_t* name = p + ZIP_CENTRAL_HEADER_SIZE;
+        const uint8_t* extra = name + name_len;
+        size_t total
+            = ZIP_CENTRAL_HEADER_SIZE + name_len + extra_len + comment_len;
+        if ((size_t)(end - p) < total)
+            return ZipParse::CORRUPT;
+        p += total;
+
+        if (!parse_zip64(extra, extra_len, &record, &disk))
+            return ZipParse::CORRUPT;
+
+        String path(name, name + name_len);
+        // directories only exist through the files in them
+        if (path.empty() || path.back() == '/')
+            return ZipParse::OK;
+
+        vfs_.add_file("/" + path);
+        vfs_.find_node("/" + path)->data = records_.size() + 1;
+        records_.push_back(record);
+
+        bool supported = disk == 0 && !(flags & ZIP_ENCRYPTED)
+                         && (record.method == (uint16_t)ZipMethod::STORED
+                             || record.method == (uint16_t)ZipMethod::DEFLATED);
+        return supported ? ZipParse::OK : ZipParse::UNSUPPORTED;
+    }
+
+    // the zip64 extra field holds, in order, the fields whose 32 bit
+    // versions are all ones
+    static bool parse_zip64(const uint8_t* extra,
+                            size_t len,
+                            ZipRecord* record,
+                            uint16_t* disk)
+    {
+        while (len >= 4) {
+            uint16_t id = load_u16(extra);
+            size_t size = load_u16(extra + 2);
+            if (size > len - 4)
+                return false;
+
+            if (id == ZIP64_EXTRA) {
+                const uint8_t* field = extra + 4;
+                const uint8_t* field_end = field + size;
+                for (uint64_t* value : { &record->size,
+                                         &record->compressed_size,
+                                         &record->local_header }) {
+                    if (*value != 0xffffffff)
+                        continue;
+                    if (field_end - field < 8)
+                        return false;
+                    *value = load_u64(field);
+                    field += 8;
+                }
+                if (*disk == 0xffff) {
+                    if (field_end - field < 4)
+                        return false;
+                    *disk = load_u32(field) == 0 ? 0 : 1;
+                }
+                return true;
+            }
+            extra += 4 + size;
+            len -= 4 + size;
+        }
+        return true;
+    }
+
+    const ZipRecord* find_record(const String& path)
+    {
+        auto node = vfs_.find_node(path);
+        if (!node || node->data == 0)
+            return nullptr;
+        return &records_[node->data - 1];
+    }
+
+    // the file's data follows its local header, whose name and extra field
+    // may differ in length from the central directory's
+    Optional<ByteSpan> record_data(const ZipRecord& record) const
+    {
+        uint64_t offset = record.local_header;
+        if (offset > size_ || size_ - offset < ZIP_LOCAL_HEADER_SIZE
+            || load_u32(data_ + offset) != ZIP_LOCAL_HEADER)
+            return std::nullopt;
+
+        const uint8_t* header = data_ + offset;
+        offset += ZIP_LOCAL_HEADER_SIZE + load_u16(header + 26)
+                  + load_u16(header + 28);
+        if (offset > size_ || size_ - offset < record.compressed_size)
+            return std::nullopt;
+        if ((ZipMethod)record.method == ZipMethod::STORED
+            && record.compressed_size != record.size)
+            return std::nullopt;
+        return ByteSpan { data_ + offset, (size_t)record.compressed_size };
+    }
+
+    UniquePtr<MappedFile> file_;
+    const uint8_t* data_;
+    size_t size_;
+    Vector<ZipRecord> records_;
+    // index in records_ plus one, 0 for directories
+    VFS<size_t> vfs_;
+};
+
 #if defined(USE_LIBZIP)
 
 class ZipEntry : public Read {
 public:
-    explicit ZipEntry(zip_file_t* entry) : entry_(entry) { }
+    ZipEntry(zip_file_t* entry, Optional<size_t> size)
+    : entry_(entry)
+    , remain_(size)
+    {
+    }
 
     ~ZipEntry() { zip_fclose(entry_); }
 
@@ -175,11 +574,17 @@ public:
         if (result == -1)
             return IO_Error::IO_FAIL;
 
+        if (remain_) {
+            *remain_ -= std::min(*remain_, (size_t)result);
+        }
         return IO_Success { .bytes = (size_t)result };
     }
 
+    Optional<size_t> size_hint() const override { return remain_; }
+
 private:
     zip_file_t* entry_;
+    Optional<size_t> remain_;
 };
 
 class ZipArchive : public Archive {
@@ -240,7 +645,13 @@ public:
         if (!file)
             return nullptr;
 
-        return std::make_unique<ZipEntry>(file);
+        Optional<size_t> size;
+        zip_stat_t info;
+        if (zip_stat_index(zip_file_, index, 0, &info) == 0
+            && (info.valid & ZIP_STAT_SIZE)) {
+            size = (size_t)info.size;
+        }
+        return std::make_unique<ZipEntry>(file, size);
     }
 
 private:
@@ -276,6 +687,26 @@ namespace nx::file_system {
 
 Archive::~Archive() { }
 
+static UniquePtr<Archive> open_zip_archive(const String& path)
+{
+    auto file = map_file(path);
+    if (!file)
+        return nullptr;
+
+    auto archive = std::make_unique<MappedZipArchive>(std::move(file));
+    auto status = archive->parse();
+    if (status == ZipParse::OK)
+        return archive;
+#if defined(USE_LIBZIP)
+    return std::make_unique<ZipArchive>(path);
+#else
+    if (status == ZipParse::UNSUPPORTED)
+        return archive;
+    NX_LOG_WARNING("zip: %s is corrupt\n", path.c_str());
+    return nullptr;
+#endif
+}
+
 UniquePtr<Archive> create_archive(const String& file_uri)
 {
     try {
@@ -285,11 +716,7 @@ UniquePtr<Archive> create_archive(const String& file_uri)
         if (scheme == "dir") {
             return std::make_unique<DirArchive>(path);
         } else if (scheme == "zip") {
-#if defined(USE_LIBZIP)
-            return std::make_unique<ZipArchive>(path);
-#else
-            return nullptr;
-#endif
+            return open_zip_archive(path);
         } else {
             return nullptr;
         }
@@ -301,11 +728,15 @@ UniquePtr<Archive> create_archive(const String& file_uri)
 
 UniquePtr<Archive> create_zip_archive_from_memory(const void* buf, size_t len)
 {
+    auto archive = std::make_unique<MappedZipArchive>(buf, len);
+    auto status = archive->parse();
+    if (status == ZipParse::OK)
+        return archive;
 #if defined(USE_LIBZIP)
     return std::make_unique<ZipArchive>(buf, len);
 #else
-    (void) buf;
-    (void) len;
+    if (status == ZipParse::UNSUPPORTED)
+        return archive;
     return nullptr;
 #endif
 }
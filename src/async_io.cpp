@@ -0,0 +1,635 @@
+#include <nx/async_io.h>
+#include <nx/file_system.h>
+#include <nx/log.h>
+#include "parallel.h"
+
+#if NX_PLATFORM_WINDOW != NX_PLATFORM
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/stat.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #define NX_HAS_IO_URING 1
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace nx::file_system {
+
+namespace {
+
+// the largest single read, the kernel caps reads a little below 2 GB
+constexpr size_t MAX_READ = 1 << 30;
+
+// files that report no size (procfs, pipes) are read to the end of file in
+// doubling steps starting here
+constexpr size_t UNSIZED_READ = 64 * 1024;
+
+#if NX_PLATFORM_WINDOW == NX_PLATFORM
+
+ReadAllResult read_blocking(const ReadRequest& request)
+{
+    if (request.fd >= 0)
+        return IO_Error::NOT_OPEN;
+
+    File file(request.path);
+    if (!file.open_read())
+        return IO_Error::NOT_OPEN;
+
+    size_t length = request.length;
+    if (length == WHOLE_FILE) {
+        auto size = file.size();
+        if (!size)
+            return IO_Error::IO_FAIL;
+        length = *size > request.offset ? *size - request.offset : 0;
+    }
+
+    ByteBuffer data(length);
+    size_t done = 0;
+    while (done < length) {
+        auto result = file.read_at(
+            request.offset + done, data.data() + done, length - done);
+        if (result.eof())
+            break;
+        if (result.failed())
+            return IO_Error::IO_FAIL;
+        done += result.bytes();
+    }
+    data.resize(done);
+    return data;
+}
+
+#else
+
+ReadAllResult read_blocking(const ReadRequest& request)
+{
+    int fd = request.fd;
+    if (fd < 0) {
+        fd = ::open(request.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return IO_Error::NOT_OPEN;
+    }
+
+    auto result = [&]() -> ReadAllResult {
+        size_t length = request.length;
+        bool unsized = false;
+        if (length == WHOLE_FILE) {
+            struct stat info;
+            if (fstat(fd, &info) != 0)
+                return IO_Error::IO_FAIL;
+            uint64_t size = (uint64_t)info.st_size;
+            unsized = size == 0;
+            length = size > request.offset ? size - request.offset : 0;
+            if (unsized) {
+                length = UNSIZED_READ;
+            }
+        }
+
+        ByteBuffer data(length);
+        size_t done = 0;
+        while (done < length) {
+            ssize_t n = pread(fd,
+                              data.data() + done,
+                              std::min(length - done, MAX_READ),
+                              (off_t)(request.offset + done));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+                return IO_Error::IO_FAIL;
+            if (n == 0)
+                break;
+            done += (size_t)n;
+            if (unsized && done == length) {
+                length *= 2;
+                data.resize(length);
+            }
+        }
+        data.resize(done);
+        return data;
+    }();
+
+    if (request.fd < 0) {
+        ::close(fd);
+    }
+    return result;
+}
+
+#endif
+
+} // namespace
+
+#if defined(NX_HAS_IO_URING)
+
+// A raw io_uring, set up with the system calls directly rather than
+// through liburing. The rings are shared with the kernel: we produce at
+// the submission tail and consume at the completion head.
+struct AsyncReader::Ring {
+    int fd = -1;
+    unsigned sq_entries = 0;
+    unsigned cq_entries = 0;
+
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    io_uring_sqe* sqes;
+
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    io_uring_cqe* cqes;
+
+    void* sq_ptr = MAP_FAILED;
+    size_t sq_len = 0;
+    void* cq_ptr = MAP_FAILED;
+    size_t cq_len = 0;
+    void* sqes_ptr = MAP_FAILED;
+    size_t sqes_len = 0;
+
+    ~Ring()
+    {
+        if (sqes_ptr != MAP_FAILED) {
+            munmap(sqes_ptr, sqes_len);
+        }
+        if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) {
+            munmap(cq_ptr, cq_len);
+        }
+        if (sq_ptr != MAP_FAILED) {
+            munmap(sq_ptr, sq_len);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    bool init(unsigned entries)
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+        if (fd < 0)
+            return false;
+
+        sq_entries = params.sq_entries;
+        cq_entries = params.cq_entries;
+        sq_len = params.sq_off.array + sq_entries * sizeof(unsigned);
+        cq_len = params.cq_off.cqes + cq_entries * sizeof(io_uring_cqe);
+        sqes_len = sq_entries * sizeof(io_uring_sqe);
+
+        // newer kernels map both rings at once
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            sq_len = cq_len = std::max(sq_len, cq_len);
+        }
+
+        sq_ptr = mmap(nullptr,
+                      sq_len,
+                      PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE,
+                      fd,
+                      IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED)
+            return false;
+
+        cq_ptr = single_mmap ? sq_ptr
+                             : mmap(nullptr,
+                                    cq_len,
+                                    PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_POPULATE,
+                                    fd,
+                                    IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED)
+            return false;
+
+        sqes_ptr = mmap(nullptr,
+                        sqes_len,
+                        PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE,
+                        fd,
+                        IORING_OFF_SQES);
+        if (sqes_ptr == MAP_FAILED)
+            return false;
+
+        auto* sq = (uint8_t*)sq_ptr;
+        sq_head = (unsigned*)(sq + params.sq_off.head);
+        sq_tail = (unsigned*)(sq + params.sq_off.tail);
+        sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+        sq_array = (unsigned*)(sq + params.sq_off.array);
+        sqes = (io_uring_sqe*)sqes_ptr;
+
+        auto* cq = (uint8_t*)cq_ptr;
+        cq_head = (unsigned*)(cq + params.cq_off.head);
+        cq_tail = (unsigned*)(cq + params.cq_off.tail);
+        cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+        return supports(
+            { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE });
+    }
+
+    bool supports(std::initializer_list<int> ops)
+    {
+        constexpr size_t n_ops = 256;
+        ByteBuffer buffer(sizeof(io_uring_probe)
+                          + n_ops * sizeof(io_uring_probe_op));
+        auto* probe = (io_uring_probe*)buffer.data();
+        if (syscall(__NR_io_uring_register,
+                    fd,
+                    IORING_REGISTER_PROBE,
+                    probe,
+                    n_ops)
+            < 0)
+            return false;
+
+        for (int op : ops) {
+            if (op > probe->last_op
+                || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+                return false;
+        }
+        return true;
+    }
+
+    // a zeroed submission entry, or nullptr when the ring is full
+    io_uring_sqe* get_sqe()
+    {
+        unsigned tail = *sq_tail;
+        unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        if (tail - head >= sq_entries)
+            return nullptr;
+
+        unsigned index = tail & *sq_mask;
+        sq_array[index] = index;
+        io_uring_sqe* sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        return sqe;
+    }
+
+    // submit everything queued and wait for at least one completion
+    int submit_and_wait()
+    {
+        unsigned queued
+            = *sq_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        return (int)syscall(__NR_io_uring_enter,
+                            fd,
+                            queued,
+                            1,
+                            IORING_ENTER_GETEVENTS,
+                            nullptr,
+                            0);
+    }
+
+    // wait for a completion without submitting anything
+    int wait_completions()
+    {
+        return (int)syscall(__NR_io_uring_enter,
+                            fd,
+                            0,
+                            1,
+                            IORING_ENTER_GETEVENTS,
+                            nullptr,
+                            0);
+    }
+
+    // entries queued that the kernel has not taken yet
+    unsigned unsubmitted() const
+    {
+        return *sq_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    }
+
+    template <class Handler>
+    void reap(Handler&& handler)
+    {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            const io_uring_cqe& cqe = cqes[head & *cq_mask];
+            handler(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+};
+
+namespace {
+
+enum class Op : uint8_t {
+    OPEN,
+    READ,
+    CLOSE,
+};
+
+// One request moving through open, then as many reads as it takes, then
+// close. The size comes from fstat() right after the open: a STATX in the
+// ring is always handed to a kernel worker thread and costs more than the
+// system call it saves.
+struct Job {
+    const ReadRequest* request;
+    int fd;
+    bool owns_fd;
+    bool unsized;
+    bool finished;
+    Optional<IO_Error> error;
+    size_t length;
+    size_t done;
+    ByteBuffer data;
+};
+
+struct Step {
+    size_t job;
+    Op op;
+};
+
+} // namespace
+
+#else
+
+struct AsyncReader::Ring { };
+
+#endif
+
+AsyncReader::AsyncReader(AsyncBackend backend, size_t threads)
+: threads_(nx::detail::resolve_thread_count(threads))
+{
+#if defined(NX_HAS_IO_URING)
+    if (backend != AsyncBackend::THREADS) {
+        ring_ = std::make_unique<Ring>();
+        if (!ring_->init(256)) {
+            ring_.reset();
+        }
+    }
+#else
+    (void)backend;
+#endif
+}
+
+AsyncReader::~AsyncReader() { }
+
+AsyncBackend AsyncReader::backend() const
+{
+    return ring_ ? AsyncBackend::IO_URING : AsyncBackend::THREADS;
+}
+
+void AsyncReader::submit(ReadRequest&& request)
+{
+    pending_.push_back(std::move(request));
+}
+
+void AsyncReader::wait_threads()
+{
+    Vector<ReadAllResult> results(pending_.size());
+    nx::detail::parallel_for(pending_.size(), threads_, [&](size_t i) {
+        results[i] = read_blocking(pending_[i]);
+    });
+
+    for (size_t i = 0; i < pending_.size(); i++) {
+        if (pending_[i].callback) {
+            pending_[i].callback(std::move(results[i]));
+        }
+    }
+}
+
+void AsyncReader::wait()
+{
+    if (!ring_) {
+        wait_threads();
+        pending_.clear();
+        return;
+    }
+
+#if defined(NX_HAS_IO_URING)
+    Vector<Job> jobs(pending_.size());
+    Queue<Step> ready;
+    size_t finished = 0;
+
+    auto finish = [&](Job& job) {
+        job.finished = true;
+        finished++;
+        if (!job.request->callback)
+            return;
+        if (job.error) {
+            job.request->callback(*job.error);
+        } else {
+            job.data.resize(job.done);
+            job.request->callback(std::move(job.data));
+        }
+    };
+
+    auto close_job = [&](size_t i) {
+        if (jobs[i].owns_fd && jobs[i].fd >= 0) {
+            ready.push({ i, Op::CLOSE });
+        } else {
+            finish(jobs[i]);
+        }
+    };
+
+    auto start_read = [&](size_t i) {
+        Job& job = jobs[i];
+        if (job.error) {
+            close_job(i);
+            return;
+        }
+
+        job.length = job.request->length;
+        if (job.length == WHOLE_FILE) {
+            struct stat info;
+            if (fstat(job.fd, &info) != 0) {
+                job.error = IO_Error::IO_FAIL;
+                close_job(i);
+                return;
+            }
+            uint64_t size = (uint64_t)info.st_size;
+            uint64_t offset = job.request->offset;
+            job.length = size > offset ? (size_t)(size - offset) : 0;
+            if (size == 0) {
+                job.unsized = true;
+                job.length = UNSIZED_READ;
+            }
+        }
+        job.data.resize(job.length);
+        if (job.length == 0) {
+            close_job(i);
+        } else {
+            ready.push({ i, Op::READ });
+        }
+    };
+
+    for (size_t i = 0; i < jobs.size(); i++) {
+        Job& job = jobs[i];
+        job.request = &pending_[i];
+        job.fd = job.request->fd;
+        job.owns_fd = job.fd < 0;
+        job.unsized = false;
+        job.finished = false;
+        job.done = 0;
+
+        if (job.owns_fd) {
+            ready.push({ i, Op::OPEN });
+        } else {
+            start_read(i);
+        }
+    }
+
+    auto prep = [&](io_uring_sqe* sqe, const Step& step) {
+        Job& job = jobs[step.job];
+        const ReadRequest& request = *job.request;
+        sqe->user_data = (uint64_t)step.job << 2 | (uint64_t)step.op;
+        switch (step.op) {
+            case Op::OPEN:
+                sqe->opcode = IORING_OP_OPENAT;
+                sqe->fd = AT_FDCWD;
+                sqe->addr = (uint64_t)request.path.c_str();
+                sqe->open_flags = O_RDONLY | O_CLOEXEC;
+                break;
+            case Op::READ:
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd = job.fd;
+                sqe->addr = (uint64_t)(job.data.data() + job.done);
+                sqe->len = (uint32_t)std::min(job.length - job.done, MAX_READ);
+                sqe->off = request.offset + job.done;
+                break;
+            case Op::CLOSE:
+                sqe->opcode = IORING_OP_CLOSE;
+                sqe->fd = job.fd;
+                break;
+        }
+    };
+
+    auto complete = [&](uint64_t user_data, int res) {
+        size_t i = (size_t)(user_data >> 2);
+        Job& job = jobs[i];
+        switch ((Op)(user_data & 3)) {
+            case Op::OPEN:
+                job.fd = res;
+                if (res < 0) {
+                    job.error = IO_Error::NOT_OPEN;
+                }
+                start_read(i);
+                break;
+            case Op::READ:
+                if (res == -EINTR || res == -EAGAIN) {
+                    ready.push({ i, Op::READ });
+                    break;
+                }
+                if (res < 0) {
+                    job.error = IO_Error::IO_FAIL;
+                } else {
+                    job.done += (size_t)res;
+                }
+                if (res > 0 && job.unsized && job.done == job.length) {
+                    job.length *= 2;
+                    job.data.resize(job.length);
+                }
+                // a short read is retried, no bytes means the end of file
+                if (res > 0 && job.done < job.length) {
+                    ready.push({ i, Op::READ });
+                } else {
+                    close_job(i);
+                }
+                break;
+            case Op::CLOSE:
+                job.fd = -1;
+                finish(job);
+                break;
+        }
+    };
+
+    // completions may outnumber submissions in flight by at most the size
+    // of the completion ring
+    size_t in_flight = 0;
+    bool broken = false;
+    while (finished < jobs.size()) {
+        while (!ready.empty() && in_flight < ring_->cq_entries) {
+            io_uring_sqe* sqe = ring_->get_sqe();
+            if (!sqe)
+                break;
+            prep(sqe, ready.front());
+            ready.pop();
+            in_flight++;
+        }
+
+        if (ring_->submit_and_wait() < 0 && errno != EINTR) {
+            NX_LOG_ERROR("io_uring_enter failed: %s\n", strerror(errno));
+            broken = true;
+            break;
+        }
+        ring_->reap([&](uint64_t user_data, int res) {
+            in_flight--;
+            complete(user_data, res);
+        });
+    }
+
+    // Entries the kernel has not taken never run, they go away with the
+    // ring. The others keep writing into the jobs' buffers and reading their
+    // paths until they complete, so wait for them without starting more,
+    // then close what they left open.
+    bool drained = true;
+    if (broken) {
+        in_flight -= ring_->unsubmitted();
+        while (in_flight > 0) {
+            if (ring_->wait_completions() < 0 && errno != EINTR) {
+                NX_LOG_ERROR("io_uring_enter failed: %s\n", strerror(errno));
+                drained = false;
+                break;
+            }
+            ring_->reap([&](uint64_t user_data, int res) {
+                in_flight--;
+                Job& job = jobs[(size_t)(user_data >> 2)];
+                Op op = (Op)(user_data & 3);
+                if (op == Op::OPEN && res >= 0) {
+                    job.fd = res;
+                } else if (op == Op::CLOSE) {
+                    job.fd = -1;
+                }
+            });
+        }
+
+        for (auto& job : jobs) {
+            if (job.owns_fd && job.fd >= 0) {
+                ::close(job.fd);
+                job.fd = -1;
+            }
+        }
+        ring_.reset();
+    }
+
+    // a broken ring fails whatever is left
+    for (auto& job : jobs) {
+        if (!job.finished && job.request->callback) {
+            job.request->callback(IO_Error::IO_FAIL);
+        }
+    }
+
+    // nothing tells when the kernel is done with the memory of requests
+    // still in flight, it is better leaked than reused
+    if (!drained) {
+        (void)new Vector<Job>(std::move(jobs));
+        (void)new Vector<ReadRequest>(std::move(pending_));
+    }
+#endif
+    pending_.clear();
+}
+
+Vector<ReadAllResult> read_files(const Vector<String>& paths)
+{
+    Vector<ReadAllResult> results(paths.size());
+    AsyncReader reader;
+    for (size_t i = 0; i < paths.size(); i++) {
+        reader.submit({ paths[i],
+                        -1,
+                        0,
+                        WHOLE_FILE,
+                        [&results, i](ReadAllResult&& result) {
+                            results[i] = std::move(result);
+                        } });
+    }
+    reader.wait();
+    return results;
+}
+
+} // namespace nx::file_system
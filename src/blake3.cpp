@@ -0,0 +1,673 @@
+#include <nx/digest.h>
+#include "blake3_impl.h"
+#include "parallel.h"
+
+// BLAKE3 in its default hash mode, following the reference implementation.
+// The input is split in 1 KiB chunks that form the leaves of a binary tree.
+// Runs of whole chunks are compressed several at a time by the simd kernels
+// in blake3_x86.cpp, and large power of two subtrees are split across
+// threads.
+
+namespace nx::digest {
+
+namespace detail {
+
+const uint32_t BLAKE3_IV[8] = {
+    0x6A09E667,
+    0xBB67AE85,
+    0x3C6EF372,
+    0xA54FF53A,
+    0x510E527F,
+    0x9B05688C,
+    0x1F83D9AB,
+    0x5BE0CD19,
+};
+
+const uint8_t BLAKE3_MSG_SCHEDULE[7][16] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 },
+    { 3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1 },
+    { 10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6 },
+    { 12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4 },
+    { 9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7 },
+    { 11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13 },
+};
+
+} // namespace detail
+
+namespace {
+
+using namespace detail;
+
+constexpr size_t BLOCK_LEN = BLAKE3_BLOCK_LEN;
+constexpr size_t CHUNK_LEN = BLAKE3_CHUNK_LEN;
+constexpr size_t OUT_LEN = BLAKE3_OUT_LEN;
+constexpr size_t MAX_SIMD_DEGREE = 16;
+
+// subtrees are split in at most this many pieces for the threads, and
+// a piece is not worth a thread below PIECE_MIN_LEN
+constexpr size_t MAX_PIECES = 64;
+constexpr size_t PIECE_MIN_LEN = 256_kb;
+
+inline uint32_t load32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16)
+           | ((uint32_t)p[3] << 24);
+}
+
+inline void store32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+inline uint32_t rotr32(uint32_t w, int c) { return (w >> c) | (w << (32 - c)); }
+
+inline void g(uint32_t* s,
+              size_t a,
+              size_t b,
+              size_t c,
+              size_t d,
+              uint32_t x,
+              uint32_t y)
+{
+    s[a] = s[a] + s[b] + x;
+    s[d] = rotr32(s[d] ^ s[a], 16);
+    s[c] = s[c] + s[d];
+    s[b] = rotr32(s[b] ^ s[c], 12);
+    s[a] = s[a] + s[b] + y;
+    s[d] = rotr32(s[d] ^ s[a], 8);
+    s[c] = s[c] + s[d];
+    s[b] = rotr32(s[b] ^ s[c], 7);
+}
+
+void compress_pre(uint32_t s[16],
+                  const uint32_t cv[8],
+                  const uint8_t block[BLOCK_LEN],
+                  uint8_t block_len,
+                  uint64_t counter,
+                  uint8_t flags)
+{
+    uint32_t m[16];
+    for (size_t i = 0; i < 16; i++) {
+        m[i] = load32(block + 4 * i);
+    }
+
+    for (size_t i = 0; i < 8; i++) {
+        s[i] = cv[i];
+    }
+    s[8] = BLAKE3_IV[0];
+    s[9] = BLAKE3_IV[1];
+    s[10] = BLAKE3_IV[2];
+    s[11] = BLAKE3_IV[3];
+    s[12] = (uint32_t)counter;
+    s[13] = (uint32_t)(counter >> 32);
+    s[14] = block_len;
+    s[15] = flags;
+
+    for (size_t r = 0; r < 7; r++) {
+        const uint8_t* w = BLAKE3_MSG_SCHEDULE[r];
+        g(s, 0, 4, 8, 12, m[w[0]], m[w[1]]);
+        g(s, 1, 5, 9, 13, m[w[2]], m[w[3]]);
+        g(s, 2, 6, 10, 14, m[w[4]], m[w[5]]);
+        g(s, 3, 7, 11, 15, m[w[6]], m[w[7]]);
+        g(s, 0, 5, 10, 15, m[w[8]], m[w[9]]);
+        g(s, 1, 6, 11, 12, m[w[10]], m[w[11]]);
+        g(s, 2, 7, 8, 13, m[w[12]], m[w[13]]);
+        g(s, 3, 4, 9, 14, m[w[14]], m[w[15]]);
+    }
+}
+
+void compress_in_place(uint32_t cv[8],
+                       const uint8_t block[BLOCK_LEN],
+                       uint8_t block_len,
+                       uint64_t counter,
+                       uint8_t flags)
+{
+    blake3_kernel().compress(cv, block, block_len, counter, flags);
+}
+
+// the full 64 byte output of a compression, used for the root
+void compress_xof(const uint32_t cv[8],
+                  const uint8_t block[BLOCK_LEN],
+                  uint8_t block_len,
+                  uint64_t counter,
+                  uint8_t flags,
+                  uint8_t out[64])
+{
+    uint32_t s[16];
+    compress_pre(s, cv, block, block_len, counter, flags);
+    for (size_t i = 0; i < 8; i++) {
+        store32(out + 4 * i, s[i] ^ s[i + 8]);
+        store32(out + 4 * (i + 8), s[i + 8] ^ cv[i]);
+    }
+}
+
+void store_cv(uint8_t out[OUT_LEN], const uint32_t cv[8])
+{
+    for (size_t i = 0; i < 8; i++) {
+        store32(out + 4 * i, cv[i]);
+    }
+}
+
+// The last compression of a node, kept back because the root is compressed
+// with an extra flag and may produce any number of output bytes.
+struct Output {
+    uint32_t cv[8];
+    uint8_t block[BLOCK_LEN];
+    uint8_t block_len;
+    uint64_t counter;
+    uint8_t flags;
+
+    void chaining_value(uint8_t out[OUT_LEN]) const
+    {
+        uint32_t v[8];
+        memcpy(v, cv, sizeof(v));
+        compress_in_place(v, block, block_len, counter, flags);
+        store_cv(out, v);
+    }
+
+    void root_bytes(uint8_t* out, size_t len) const
+    {
+        uint8_t wide[64];
+        uint8_t root_flags = flags | BLAKE3_ROOT;
+        uint64_t n_block = 0;
+        while (len > 0) {
+            compress_xof(cv, block, block_len, n_block++, root_flags, wide);
+            size_t n = std::min(len, sizeof(wide));
+            memcpy(out, wide, n);
+            out += n;
+            len -= n;
+        }
+    }
+};
+
+Output parent_output(const uint8_t block[BLOCK_LEN])
+{
+    Output output;
+    memcpy(output.cv, BLAKE3_IV, sizeof(output.cv));
+    memcpy(output.block, block, BLOCK_LEN);
+    output.block_len = BLOCK_LEN;
+    output.counter = 0;
+    output.flags = BLAKE3_PARENT;
+    return output;
+}
+
+using Chunk = BLAKE3::Chunk_State;
+
+void chunk_reset(Chunk* chunk, uint64_t counter)
+{
+    memcpy(chunk->cv, BLAKE3_IV, sizeof(chunk->cv));
+    chunk->counter = counter;
+    memset(chunk->buf, 0, sizeof(chunk->buf));
+    chunk->buf_len = 0;
+    chunk->blocks_compressed = 0;
+}
+
+size_t chunk_len(const Chunk& chunk)
+{
+    return BLOCK_LEN * chunk.blocks_compressed + chunk.buf_len;
+}
+
+uint8_t chunk_start_flag(const Chunk& chunk)
+{
+    return chunk.blocks_compressed == 0 ? BLAKE3_CHUNK_START : 0;
+}
+
+// The last block of a chunk gets the end flag, so a block is only
+// compressed once more input is known to follow it.
+void chunk_update(Chunk* chunk, const uint8_t* input, size_t len)
+{
+    if (chunk->buf_len > 0) {
+        size_t take = std::min(BLOCK_LEN - chunk->buf_len, len);
+        memcpy(chunk->buf + chunk->buf_len, input, take);
+        chunk->buf_len += (uint8_t)take;
+        input += take;
+        len -= take;
+        if (len == 0)
+            return;
+
+        compress_in_place(chunk->cv,
+                          chunk->buf,
+                          BLOCK_LEN,
+                          chunk->counter,
+                          chunk_start_flag(*chunk));
+        chunk->blocks_compressed++;
+        chunk->buf_len = 0;
+        memset(chunk->buf, 0, sizeof(chunk->buf));
+    }
+
+    while (len > BLOCK_LEN) {
+        compress_in_place(chunk->cv,
+                          input,
+                          BLOCK_LEN,
+                          chunk->counter,
+                          chunk_start_flag(*chunk));
+        chunk->blocks_compressed++;
+        input += BLOCK_LEN;
+        len -= BLOCK_LEN;
+    }
+
+    memcpy(chunk->buf, input, len);
+    chunk->buf_len = (uint8_t)len;
+}
+
+Output chunk_output(const Chunk& chunk)
+{
+    Output output;
+    memcpy(output.cv, chunk.cv, sizeof(output.cv));
+    memcpy(output.block, chunk.buf, BLOCK_LEN);
+    output.block_len = chunk.buf_len;
+    output.counter = chunk.counter;
+    output.flags = chunk_start_flag(chunk) | BLAKE3_CHUNK_END;
+    return output;
+}
+
+size_t round_down_to_power_of_2(uint64_t x)
+{
+    size_t p = 1;
+    while (x >> 1 >= p) {
+        p <<= 1;
+    }
+    return p;
+}
+
+size_t popcount(uint64_t x)
+{
+    size_t n = 0;
+    for (; x; x &= x - 1) {
+        n++;
+    }
+    return n;
+}
+
+// the left subtree of a node gets the largest power of two number of
+// chunks that leaves at least one byte for the right
+size_t left_subtree_len(size_t len)
+{
+    size_t full_chunks = (len - 1) / CHUNK_LEN;
+    return round_down_to_power_of_2(full_chunks) * CHUNK_LEN;
+}
+
+// Hashes up to degree chunks at once, plus a partial last chunk. Returns
+// the number of chaining values written to out.
+size_t compress_chunks_parallel(const uint8_t* input,
+                                size_t len,
+                                uint64_t chunk_counter,
+                                uint8_t* out)
+{
+    const uint8_t* chunks[MAX_SIMD_DEGREE];
+    size_t n = 0;
+    size_t pos = 0;
+    while (len - pos >= CHUNK_LEN) {
+        chunks[n++] = input + pos;
+        pos += CHUNK_LEN;
+    }
+
+    blake3_kernel().hash_many(chunks,
+                              n,
+                              CHUNK_LEN / BLOCK_LEN,
+                              BLAKE3_IV,
+                              chunk_counter,
+                              true,
+                              0,
+                              BLAKE3_CHUNK_START,
+                              BLAKE3_CHUNK_END,
+                              out);
+
+    if (len > pos) {
+        Chunk chunk;
+        chunk_reset(&chunk, chunk_counter + n);
+        chunk_update(&chunk, input + pos, len - pos);
+        chunk_output(chunk).chaining_value(out + n * OUT_LEN);
+        return n + 1;
+    }
+    return n;
+}
+
+// Combines pairs of chaining values into their parents, an odd one out is
+// passed through. Returns the number of chaining values written to out.
+size_t compress_parents_parallel(const uint8_t* cvs, size_t n_cvs, uint8_t* out)
+{
+    const uint8_t* parents[MAX_PIECES / 2];
+    size_t n = 0;
+    while (n_cvs - 2 * n >= 2) {
+        parents[n] = cvs + 2 * n * OUT_LEN;
+        n++;
+    }
+
+    blake3_kernel().hash_many(
+        parents, n, 1, BLAKE3_IV, 0, false, BLAKE3_PARENT, 0, 0, out);
+
+    if (n_cvs > 2 * n) {
+        memcpy(out + n * OUT_LEN, cvs + 2 * n * OUT_LEN, OUT_LEN);
+        return n + 1;
+    }
+    return n;
+}
+
+// Compresses a subtree down to at most degree chaining values, as long as
+// enough chunks are left to keep every simd lane busy. Returns the number
+// of chaining values written to out, at least 2 for more than one chunk.
+size_t compress_subtree_wide(const uint8_t* input,
+                             size_t len,
+                             uint64_t chunk_counter,
+                             uint8_t* out)
+{
+    size_t degree = blake3_kernel().degree;
+    if (len <= degree * CHUNK_LEN) {
+        return compress_chunks_parallel(input, len, chunk_counter, out);
+    }
+
+    size_t left_len = left_subtree_len(len);
+    size_t right_len = len - left_len;
+    uint64_t right_counter = chunk_counter + left_len / CHUNK_LEN;
+
+    // a single lane kernel still returns 2 values for each side
+    if (left_len > CHUNK_LEN && degree == 1) {
+        degree = 2;
+    }
+
+    uint8_t cvs[2 * MAX_SIMD_DEGREE * OUT_LEN];
+    uint8_t* right_cvs = cvs + degree * OUT_LEN;
+    size_t left_n = compress_subtree_wide(input, left_len, chunk_counter, cvs);
+    size_t right_n = compress_subtree_wide(
+        input + left_len, right_len, right_counter, right_cvs);
+
+    // the left side is one chunk, so the right side is too
+    if (left_n == 1) {
+        memcpy(out, cvs, 2 * OUT_LEN);
+        return 2;
+    }
+    return compress_parents_parallel(cvs, left_n + right_n, out);
+}
+
+// the chaining value of a subtree of a power of two number of chunks
+void compress_subtree_to_cv(const uint8_t* input,
+                            size_t len,
+                            uint64_t chunk_counter,
+                            uint8_t out[OUT_LEN])
+{
+    uint8_t cvs[MAX_SIMD_DEGREE * OUT_LEN];
+    uint8_t parents[MAX_SIMD_DEGREE / 2 * OUT_LEN];
+    size_t n = compress_subtree_wide(input, len, chunk_counter, cvs);
+    while (n > 1) {
+        n = compress_parents_parallel(cvs, n, parents);
+        memcpy(cvs, parents, n * OUT_LEN);
+    }
+    memcpy(out, cvs, OUT_LEN);
+}
+
+// Compresses a subtree of more than one chunk to the two chaining values
+// of its root's children. The root itself is left to the caller, which
+// knows whether it is the root of the whole tree.
+void compress_subtree_to_parent_node(const uint8_t* input,
+                                     size_t len,
+                                     uint64_t chunk_counter,
+                                     size_t threads,
+                                     uint8_t out[2 * OUT_LEN])
+{
+    uint8_t cvs[MAX_PIECES * OUT_LEN];
+    uint8_t parents[MAX_PIECES / 2 * OUT_LEN];
+    size_t n;
+
+    // Subtrees from the hasher are a power of two chunks long, so they
+    // split in equal power of two pieces that are subtrees themselves.
+    // Every thread reduces whole pieces to a single chaining value.
+    size_t pieces = 1;
+    if (threads > 1) {
+        while (pieces < MAX_PIECES && pieces < 4 * threads
+               && len / (2 * pieces) >= PIECE_MIN_LEN) {
+            pieces *= 2;
+        }
+    }
+
+    if (pieces > 1) {
+        size_t piece_len = len / pieces;
+        nx::detail::parallel_for(pieces, threads, [&](size_t i) {
+            compress_subtree_to_cv(input + i * piece_len,
+                                   piece_len,
+                                   chunk_counter + i * (piece_len / CHUNK_LEN),
+                                   cvs + i * OUT_LEN);
+        });
+        n = pieces;
+    } else {
+        n = compress_subtree_wide(input, len, chunk_counter, cvs);
+    }
+
+    while (n > 2) {
+        n = compress_parents_parallel(cvs, n, parents);
+        memcpy(cvs, parents, n * OUT_LEN);
+    }
+    memcpy(out, cvs, 2 * OUT_LEN);
+}
+
+} // namespace
+
+namespace detail {
+
+void blake3_compress_portable(uint32_t cv[8],
+                              const uint8_t block[64],
+                              uint8_t block_len,
+                              uint64_t counter,
+                              uint8_t flags)
+{
+    uint32_t s[16];
+    compress_pre(s, cv, block, block_len, counter, flags);
+    for (size_t i = 0; i < 8; i++) {
+        cv[i] = s[i] ^ s[i + 8];
+    }
+}
+
+void blake3_hash_many_portable(const uint8_t* const* inputs,
+                               size_t n_inputs,
+                               size_t n_blocks,
+                               const uint32_t key[8],
+                               uint64_t counter,
+                               bool increment_counter,
+                               uint8_t flags,
+                               uint8_t flags_start,
+                               uint8_t flags_end,
+                               uint8_t* out)
+{
+    for (size_t i = 0; i < n_inputs; i++) {
+        uint32_t cv[8];
+        memcpy(cv, key, sizeof(cv));
+        uint8_t block_flags = flags | flags_start;
+        for (size_t b = 0; b < n_blocks; b++) {
+            if (b + 1 == n_blocks) {
+                block_flags |= flags_end;
+            }
+            blake3_compress_portable(
+                cv, inputs[i] + b * BLOCK_LEN, BLOCK_LEN, counter, block_flags);
+            block_flags = flags;
+        }
+        store_cv(out + i * OUT_LEN, cv);
+        if (increment_counter) {
+            counter++;
+        }
+    }
+}
+
+static Blake3Kernel select_blake3_kernel()
+{
+#if defined(NX_ARCH_X86_64)
+    const auto& f = cpu::features();
+    // the wider kernels hand leftover inputs to the narrower ones
+    if (f.avx512 && f.avx2 && f.sse41) {
+        return { blake3_compress_sse41, blake3_hash_many_avx512, 16 };
+    }
+    if (f.avx2 && f.sse41) {
+        return { blake3_compress_sse41, blake3_hash_many_avx2, 8 };
+    }
+    if (f.sse41) {
+        return { blake3_compress_sse41, blake3_hash_many_sse41, 4 };
+    }
+#endif
+    return { blake3_compress_portable, blake3_hash_many_portable, 1 };
+}
+
+const Blake3Kernel& blake3_kernel()
+{
+    static const Blake3Kernel kernel = select_blake3_kernel();
+    return kernel;
+}
+
+} // namespace detail
+
+BLAKE3::BLAKE3(size_t threads)
+    : threads_(nx::detail::resolve_thread_count(threads))
+{
+    reset();
+}
+
+void BLAKE3::reset()
+{
+    chunk_reset(&chunk_, 0);
+    cv_stack_len_ = 0;
+}
+
+// Every completed subtree leaves its chaining value on the stack. The
+// number of entries after merging is the number of one bits in the chunk
+// count, one per complete power of two subtree.
+void BLAKE3::merge_cv_stack(uint64_t total_chunks)
+{
+    size_t post_merge_len = popcount(total_chunks);
+    while (cv_stack_len_ > post_merge_len) {
+        uint8_t* parent = cv_stack_ + (cv_stack_len_ - 2) * OUT_LEN;
+        parent_output(parent).chaining_value(parent);
+        cv_stack_len_--;
+    }
+}
+
+void BLAKE3::push_cv(const uint8_t cv[32], uint64_t chunk_counter)
+{
+    merge_cv_stack(chunk_counter);
+    memcpy(cv_stack_ + cv_stack_len_ * OUT_LEN, cv, OUT_LEN);
+    cv_stack_len_++;
+}
+
+void BLAKE3::update(const uint8_t* input, size_t length)
+{
+    if (length == 0)
+        return;
+
+    // finish the chunk in progress first, it is not pushed until more
+    // input shows it is not the last one
+    if (chunk_len(chunk_) > 0) {
+        size_t take = std::min(CHUNK_LEN - chunk_len(chunk_), length);
+        chunk_update(&chunk_, input, take);
+        input += take;
+        length -= take;
+        if (length == 0)
+            return;
+
+        uint8_t cv[OUT_LEN];
+        chunk_output(chunk_).chaining_value(cv);
+        push_cv(cv, chunk_.counter);
+        chunk_reset(&chunk_, chunk_.counter + 1);
+    }
+
+    // hash the largest subtrees that start at the current chunk count,
+    // always keeping some input back for the final chunk
+    while (length > CHUNK_LEN) {
+        size_t subtree_len = round_down_to_power_of_2(length);
+        uint64_t count_so_far = chunk_.counter * CHUNK_LEN;
+        while (((subtree_len - 1) & count_so_far) != 0) {
+            subtree_len /= 2;
+        }
+        uint64_t subtree_chunks = subtree_len / CHUNK_LEN;
+
+        if (subtree_len <= CHUNK_LEN) {
+            Chunk chunk;
+            chunk_reset(&chunk, chunk_.counter);
+            chunk_update(&chunk, input, subtree_len);
+            uint8_t cv[OUT_LEN];
+            chunk_output(chunk).chaining_value(cv);
+            push_cv(cv, chunk.counter);
+        } else {
+            uint8_t cv_pair[2 * OUT_LEN];
+            compress_subtree_to_parent_node(
+                input, subtree_len, chunk_.counter, threads_, cv_pair);
+            push_cv(cv_pair, chunk_.counter);
+            push_cv(cv_pair + OUT_LEN, chunk_.counter + subtree_chunks / 2);
+        }
+        chunk_.counter += subtree_chunks;
+        input += subtree_len;
+        length -= subtree_len;
+    }
+
+    if (length > 0) {
+        chunk_update(&chunk_, input, length);
+        merge_cv_stack(chunk_.counter);
+    }
+}
+
+void BLAKE3::finish(uint8_t* out, size_t out_len) const
+{
+    if (cv_stack_len_ == 0) {
+        chunk_output(chunk_).root_bytes(out, out_len);
+        return;
+    }
+
+    // the stack is not fully merged, fold it from the top down with the
+    // current chunk as the rightmost leaf
+    Output output;
+    size_t remaining;
+    if (chunk_len(chunk_) > 0) {
+        remaining = cv_stack_len_;
+        output = chunk_output(chunk_);
+    } else {
+        remaining = cv_stack_len_ - 2;
+        output = parent_output(cv_stack_ + remaining * OUT_LEN);
+    }
+
+    while (remaining > 0) {
+        remaining--;
+        uint8_t block[BLOCK_LEN];
+        memcpy(block, cv_stack_ + remaining * OUT_LEN, OUT_LEN);
+        output.chaining_value(block + OUT_LEN);
+        output = parent_output(block);
+    }
+    output.root_bytes(out, out_len);
+}
+
+Blake3Digest BLAKE3::finish() const
+{
+    Blake3Digest digest;
+    finish(digest.bytes, digest.size());
+    return digest;
+}
+
+Blake3Digest blake3_digest(const uint8_t* data, size_t len)
+{
+    BLAKE3 blake3;
+    blake3.update(data, len);
+    return blake3.finish();
+}
+
+Blake3Digest blake3_digest(const char* data)
+{
+    return blake3_digest((const uint8_t*)data, strlen(data));
+}
+
+String blake3(const uint8_t* data, size_t len)
+{
+    return blake3_digest(data, len).to_hex();
+}
+
+String blake3(const char* data)
+{
+    return blake3((const uint8_t*)data, strlen(data));
+}
+
+Blake3Digest parallel_blake3(const uint8_t* data, size_t len, size_t threads)
+{
+    BLAKE3 blake3(threads);
+    blake3.update(data, len);
+    return blake3.finish();
+}
+
+} // namespace nx::digest
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "cpu.h"
+
+namespace nx::digest::detail {
+
+constexpr size_t BLAKE3_BLOCK_LEN = 64;
+constexpr size_t BLAKE3_CHUNK_LEN = 1024;
+constexpr size_t BLAKE3_OUT_LEN = 32;
+
+enum Blake3Flags : uint8_t {
+    BLAKE3_CHUNK_START = 1 << 0,
+    BLAKE3_CHUNK_END = 1 << 1,
+    BLAKE3_PARENT = 1 << 2,
+    BLAKE3_ROOT = 1 << 3,
+};
+
+extern const uint32_t BLAKE3_IV[8];
+
+/**
+ * @brief      message word order of each of the 7 rounds
+ */
+extern const uint8_t BLAKE3_MSG_SCHEDULE[7][16];
+
+/**
+ * @brief      compress a single block into cv
+ */
+using Blake3Compress = void (*)(uint32_t cv[8],
+                                const uint8_t block[64],
+                                uint8_t block_len,
+                                uint64_t counter,
+                                uint8_t flags);
+
+/**
+ * @brief      hash n_inputs inputs of n_blocks blocks each, writing the 32
+ *             byte chaining value of input i to out + 32 * i.
+ *
+ *             Every input starts from key. Input i uses counter + i when
+ *             increment_counter is set, counter otherwise. Its first block
+ *             gets flags | flags_start, its last flags | flags_end.
+ */
+using Blake3HashMany = void (*)(const uint8_t* const* inputs,
+                                size_t n_inputs,
+                                size_t n_blocks,
+                                const uint32_t key[8],
+                                uint64_t counter,
+                                bool increment_counter,
+                                uint8_t flags,
+                                uint8_t flags_start,
+                                uint8_t flags_end,
+                                uint8_t* out);
+
+struct Blake3Kernel {
+    Blake3Compress compress;
+    Blake3HashMany hash_many;
+    /**
+     * @brief  the number of inputs hash_many handles at once
+     */
+    size_t degree;
+};
+
+/**
+ * @brief      the widest kernel for the cpu
+ */
+const Blake3Kernel& blake3_kernel();
+
+void blake3_compress_portable(uint32_t cv[8],
+                              const uint8_t block[64],
+                              uint8_t block_len,
+                              uint64_t counter,
+                              uint8_t flags);
+
+void blake3_hash_many_portable(const uint8_t* const* inputs,
+                               size_t n_inputs,
+                               size_t n_blocks,
+                               const uint32_t key[8],
+                               uint64_t counter,
+                               bool increment_counter,
+                               uint8_t flags,
+                               uint8_t flags_start,
+                               uint8_t flags_end,
+                               uint8_t* out);
+
+#if defined(NX_ARCH_X86_64)
+/**
+ * @brief      compress with the state rows in sse registers. requires
+ *             sse4.1.
+ */
+void blake3_compress_sse41(uint32_t cv[8],
+                           const uint8_t block[64],
+                           uint8_t block_len,
+                           uint64_t counter,
+                           uint8_t flags);
+
+/**
+ * @brief      4, 8 and 16 inputs per step, one per lane. Require sse4.1,
+ *             avx2 and avx-512 respectively. Leftover inputs are passed on
+ *             to the narrower kernels.
+ */
+void blake3_hash_many_sse41(const uint8_t* const* inputs,
+                            size_t n_inputs,
+                            size_t n_blocks,
+                            const uint32_t key[8],
+                            uint64_t counter,
+                            bool increment_counter,
+                            uint8_t flags,
+                            uint8_t flags_start,
+                            uint8_t flags_end,
+                            uint8_t* out);
+
+void blake3_hash_many_avx2(const uint8_t* const* inputs,
+                           size_t n_inputs,
+                           size_t n_blocks,
+                           const uint32_t key[8],
+                           uint64_t counter,
+                           bool increment_counter,
+                           uint8_t flags,
+                           uint8_t flags_start,
+                           uint8_t flags_end,
+                           uint8_t* out);
+
+void blake3_hash_many_avx512(const uint8_t* const* inputs,
+                             size_t n_inputs,
+                             size_t n_blocks,
+                             const uint32_t key[8],
+                             uint64_t counter,
+                             bool increment_counter,
+                             uint8_t flags,
+                             uint8_t flags_start,
+                             uint8_t flags_end,
+                             uint8_t* out);
+#endif
+
+} // namespace nx::digest::detail
@@ -0,0 +1,569 @@
+#include "blake3_impl.h"
+#include "simd_avx2.h"
+
+#if defined(NX_ARCH_X86_64)
+
+    #include <immintrin.h>
+
+namespace nx::digest::detail {
+
+// Every kernel hashes one input per 32 bit lane: the state words of all
+// lanes are kept transposed, v[i] holding word i of every input, so the
+// rounds are the scalar rounds on vectors. Message blocks are transposed
+// on load and the chaining values through a small buffer on store.
+
+namespace {
+
+// the counter of every lane, split in low and high words
+void lane_counters(uint32_t lo[],
+                   uint32_t hi[],
+                   size_t lanes,
+                   uint64_t counter,
+                   bool increment_counter)
+{
+    for (size_t i = 0; i < lanes; i++) {
+        uint64_t c = counter + (increment_counter ? i : 0);
+        lo[i] = (uint32_t)c;
+        hi[i] = (uint32_t)(c >> 32);
+    }
+}
+
+// h is word major, h[w * lanes + i] is word w of lane i
+void store_lane_cvs(const uint32_t* h, size_t lanes, uint8_t* out)
+{
+    for (size_t i = 0; i < lanes; i++) {
+        for (size_t w = 0; w < 8; w++) {
+            uint32_t v = h[w * lanes + i];
+            memcpy(out + 32 * i + 4 * w, &v, 4);
+        }
+    }
+}
+
+NX_TARGET("sse4.1")
+inline __m128i rotr_128(__m128i x, int c)
+{
+    const __m128i rot16 = _mm_set_epi8(
+        13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2);
+    const __m128i rot8 = _mm_set_epi8(
+        12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1);
+    if (c == 16)
+        return _mm_shuffle_epi8(x, rot16);
+    if (c == 8)
+        return _mm_shuffle_epi8(x, rot8);
+    return _mm_or_si128(_mm_srli_epi32(x, c), _mm_slli_epi32(x, 32 - c));
+}
+
+NX_TARGET("sse4.1")
+inline void g_128(__m128i* v,
+                  size_t a,
+                  size_t b,
+                  size_t c,
+                  size_t d,
+                  __m128i x,
+                  __m128i y)
+{
+    v[a] = _mm_add_epi32(_mm_add_epi32(v[a], v[b]), x);
+    v[d] = rotr_128(_mm_xor_si128(v[d], v[a]), 16);
+    v[c] = _mm_add_epi32(v[c], v[d]);
+    v[b] = rotr_128(_mm_xor_si128(v[b], v[c]), 12);
+    v[a] = _mm_add_epi32(_mm_add_epi32(v[a], v[b]), y);
+    v[d] = rotr_128(_mm_xor_si128(v[d], v[a]), 8);
+    v[c] = _mm_add_epi32(v[c], v[d]);
+    v[b] = rotr_128(_mm_xor_si128(v[b], v[c]), 7);
+}
+
+NX_TARGET("sse4.1")
+inline void transpose_4x4(__m128i* w)
+{
+    __m128i t0 = _mm_unpacklo_epi32(w[0], w[1]);
+    __m128i t1 = _mm_unpackhi_epi32(w[0], w[1]);
+    __m128i t2 = _mm_unpacklo_epi32(w[2], w[3]);
+    __m128i t3 = _mm_unpackhi_epi32(w[2], w[3]);
+    w[0] = _mm_unpacklo_epi64(t0, t2);
+    w[1] = _mm_unpackhi_epi64(t0, t2);
+    w[2] = _mm_unpacklo_epi64(t1, t3);
+    w[3] = _mm_unpackhi_epi64(t1, t3);
+}
+
+// The single block compress keeps row i of the 4x4 state in one register.
+// A column round is four g functions side by side, and rotating rows 0, 2
+// and 3 lines the diagonals up as columns for the diagonal round.
+NX_TARGET("sse4.1")
+inline void g_rows(__m128i* rows, __m128i x, __m128i y)
+{
+    rows[0] = _mm_add_epi32(_mm_add_epi32(rows[0], rows[1]), x);
+    rows[3] = rotr_128(_mm_xor_si128(rows[3], rows[0]), 16);
+    rows[2] = _mm_add_epi32(rows[2], rows[3]);
+    rows[1] = rotr_128(_mm_xor_si128(rows[1], rows[2]), 12);
+    rows[0] = _mm_add_epi32(_mm_add_epi32(rows[0], rows[1]), y);
+    rows[3] = rotr_128(_mm_xor_si128(rows[3], rows[0]), 8);
+    rows[2] = _mm_add_epi32(rows[2], rows[3]);
+    rows[1] = rotr_128(_mm_xor_si128(rows[1], rows[2]), 7);
+}
+
+NX_TARGET("sse4.1")
+void hash4_sse41(const uint8_t* const* inputs,
+                 size_t n_blocks,
+                 const uint32_t key[8],
+                 uint64_t counter,
+                 bool increment_counter,
+                 uint8_t flags,
+                 uint8_t flags_start,
+                 uint8_t flags_end,
+                 uint8_t* out)
+{
+    uint32_t lo[4], hi[4];
+    lane_counters(lo, hi, 4, counter, increment_counter);
+    const __m128i counter_lo = _mm_loadu_si128((const __m128i*)lo);
+    const __m128i counter_hi = _mm_loadu_si128((const __m128i*)hi);
+
+    __m128i h[8];
+    for (int i = 0; i < 8; i++) {
+        h[i] = _mm_set1_epi32((int)key[i]);
+    }
+
+    uint8_t block_flags = flags | flags_start;
+    for (size_t b = 0; b < n_blocks; b++) {
+        if (b + 1 == n_blocks) {
+            block_flags |= flags_end;
+        }
+
+        __m128i m[16];
+        for (size_t q = 0; q < 4; q++) {
+            for (size_t i = 0; i < 4; i++) {
+                m[4 * q + i] = _mm_loadu_si128(
+                    (const __m128i*)(inputs[i] + 64 * b + 16 * q));
+            }
+            transpose_4x4(m + 4 * q);
+        }
+
+        __m128i v[16];
+        for (int i = 0; i < 8; i++) {
+            v[i] = h[i];
+        }
+        for (int i = 0; i < 4; i++) {
+            v[8 + i] = _mm_set1_epi32((int)BLAKE3_IV[i]);
+        }
+        v[12] = counter_lo;
+        v[13] = counter_hi;
+        v[14] = _mm_set1_epi32((int)BLAKE3_BLOCK_LEN);
+        v[15] = _mm_set1_epi32(block_flags);
+
+        for (size_t r = 0; r < 7; r++) {
+            const uint8_t* s = BLAKE3_MSG_SCHEDULE[r];
+            g_128(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+            g_128(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+            g_128(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+            g_128(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+            g_128(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+            g_128(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+            g_128(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+            g_128(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+        }
+
+        for (int i = 0; i < 8; i++) {
+            h[i] = _mm_xor_si128(v[i], v[i + 8]);
+        }
+        block_flags = flags;
+    }
+
+    uint32_t cvs[8 * 4];
+    for (int i = 0; i < 8; i++) {
+        _mm_storeu_si128((__m128i*)cvs + i, h[i]);
+    }
+    store_lane_cvs(cvs, 4, out);
+}
+
+NX_TARGET("avx2")
+inline __m256i rotr_256(__m256i x, int c)
+{
+    const __m256i rot16 = _mm256_set_epi8(13, 12, 15, 14, 9, 8, 11, 10,
+                                          5, 4, 7, 6, 1, 0, 3, 2,
+                                          13, 12, 15, 14, 9, 8, 11, 10,
+                                          5, 4, 7, 6, 1, 0, 3, 2);
+    const __m256i rot8 = _mm256_set_epi8(12, 15, 14, 13, 8, 11, 10, 9,
+                                         4, 7, 6, 5, 0, 3, 2, 1,
+                                         12, 15, 14, 13, 8, 11, 10, 9,
+                                         4, 7, 6, 5, 0, 3, 2, 1);
+    if (c == 16)
+        return _mm256_shuffle_epi8(x, rot16);
+    if (c == 8)
+        return _mm256_shuffle_epi8(x, rot8);
+    return _mm256_or_si256(_mm256_srli_epi32(x, c),
+                           _mm256_slli_epi32(x, 32 - c));
+}
+
+NX_TARGET("avx2")
+inline void g_256(__m256i* v,
+                  size_t a,
+                  size_t b,
+                  size_t c,
+                  size_t d,
+                  __m256i x,
+                  __m256i y)
+{
+    v[a] = _mm256_add_epi32(_mm256_add_epi32(v[a], v[b]), x);
+    v[d] = rotr_256(_mm256_xor_si256(v[d], v[a]), 16);
+    v[c] = _mm256_add_epi32(v[c], v[d]);
+    v[b] = rotr_256(_mm256_xor_si256(v[b], v[c]), 12);
+    v[a] = _mm256_add_epi32(_mm256_add_epi32(v[a], v[b]), y);
+    v[d] = rotr_256(_mm256_xor_si256(v[d], v[a]), 8);
+    v[c] = _mm256_add_epi32(v[c], v[d]);
+    v[b] = rotr_256(_mm256_xor_si256(v[b], v[c]), 7);
+}
+
+NX_TARGET("avx2")
+void hash8_avx2(const uint8_t* const* inputs,
+                size_t n_blocks,
+                const uint32_t key[8],
+                uint64_t counter,
+                bool increment_counter,
+                uint8_t flags,
+                uint8_t flags_start,
+                uint8_t flags_end,
+                uint8_t* out)
+{
+    uint32_t lo[8], hi[8];
+    lane_counters(lo, hi, 8, counter, increment_counter);
+    const __m256i counter_lo = _mm256_loadu_si256((const __m256i*)lo);
+    const __m256i counter_hi = _mm256_loadu_si256((const __m256i*)hi);
+
+    __m256i h[8];
+    for (int i = 0; i < 8; i++) {
+        h[i] = _mm256_set1_epi32((int)key[i]);
+    }
+
+    uint8_t block_flags = flags | flags_start;
+    for (size_t b = 0; b < n_blocks; b++) {
+        if (b + 1 == n_blocks) {
+            block_flags |= flags_end;
+        }
+
+        __m256i m[16];
+        nx::detail::load_transposed_x8(m, inputs, 64 * b, false);
+        nx::detail::load_transposed_x8(m + 8, inputs, 64 * b + 32, false);
+
+        __m256i v[16];
+        for (int i = 0; i < 8; i++) {
+            v[i] = h[i];
+        }
+        for (int i = 0; i < 4; i++) {
+            v[8 + i] = _mm256_set1_epi32((int)BLAKE3_IV[i]);
+        }
+        v[12] = counter_lo;
+        v[13] = counter_hi;
+        v[14] = _mm256_set1_epi32((int)BLAKE3_BLOCK_LEN);
+        v[15] = _mm256_set1_epi32(block_flags);
+
+        for (size_t r = 0; r < 7; r++) {
+            const uint8_t* s = BLAKE3_MSG_SCHEDULE[r];
+            g_256(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+            g_256(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+            g_256(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+            g_256(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+            g_256(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+            g_256(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+            g_256(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+            g_256(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+        }
+
+        for (int i = 0; i < 8; i++) {
+            h[i] = _mm256_xor_si256(v[i], v[i + 8]);
+        }
+        block_flags = flags;
+    }
+
+    uint32_t cvs[8 * 8];
+    for (int i = 0; i < 8; i++) {
+        _mm256_storeu_si256((__m256i*)cvs + i, h[i]);
+    }
+    store_lane_cvs(cvs, 8, out);
+}
+
+// gcc 12 warns about the undefined pass-through operand inside its own
+// avx-512 intrinsics once they are inlined
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+NX_TARGET("avx512f")
+inline void g_512(__m512i* v,
+                  size_t a,
+                  size_t b,
+                  size_t c,
+                  size_t d,
+                  __m512i x,
+                  __m512i y)
+{
+    v[a] = _mm512_add_epi32(_mm512_add_epi32(v[a], v[b]), x);
+    v[d] = _mm512_ror_epi32(_mm512_xor_si512(v[d], v[a]), 16);
+    v[c] = _mm512_add_epi32(v[c], v[d]);
+    v[b] = _mm512_ror_epi32(_mm512_xor_si512(v[b], v[c]), 12);
+    v[a] = _mm512_add_epi32(_mm512_add_epi32(v[a], v[b]), y);
+    v[d] = _mm512_ror_epi32(_mm512_xor_si512(v[d], v[a]), 8);
+    v[c] = _mm512_add_epi32(v[c], v[d]);
+    v[b] = _mm512_ror_epi32(_mm512_xor_si512(v[b], v[c]), 7);
+}
+
+// Loads one 64 byte block of each of the 16 lanes, w[i] receiving word i
+// of every lane. After the two unpack steps u[4 * g + j] holds, in 128 bit
+// lane k, word 4 * k + j of rows 4 * g to 4 * g + 3, and two rounds of
+// 128 bit shuffles gather the four row groups.
+NX_TARGET("avx512f")
+inline void load_transposed_x16(__m512i w[16],
+                                const uint8_t* const* inputs,
+                                size_t offset)
+{
+    __m512i r[16], t[16], u[16];
+    for (int i = 0; i < 16; i++) {
+        r[i] = _mm512_loadu_si512((const void*)(inputs[i] + offset));
+    }
+    for (int i = 0; i < 16; i += 2) {
+        t[i] = _mm512_unpacklo_epi32(r[i], r[i + 1]);
+        t[i + 1] = _mm512_unpackhi_epi32(r[i], r[i + 1]);
+    }
+    for (int i = 0; i < 16; i += 4) {
+        u[i] = _mm512_unpacklo_epi64(t[i], t[i + 2]);
+        u[i + 1] = _mm512_unpackhi_epi64(t[i], t[i + 2]);
+        u[i + 2] = _mm512_unpacklo_epi64(t[i + 1], t[i + 3]);
+        u[i + 3] = _mm512_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+    for (int j = 0; j < 4; j++) {
+        __m512i x0 = _mm512_shuffle_i32x4(u[j], u[4 + j], 0x88);
+        __m512i x1 = _mm512_shuffle_i32x4(u[j], u[4 + j], 0xdd);
+        __m512i y0 = _mm512_shuffle_i32x4(u[8 + j], u[12 + j], 0x88);
+        __m512i y1 = _mm512_shuffle_i32x4(u[8 + j], u[12 + j], 0xdd);
+        w[j] = _mm512_shuffle_i32x4(x0, y0, 0x88);
+        w[4 + j] = _mm512_shuffle_i32x4(x1, y1, 0x88);
+        w[8 + j] = _mm512_shuffle_i32x4(x0, y0, 0xdd);
+        w[12 + j] = _mm512_shuffle_i32x4(x1, y1, 0xdd);
+    }
+}
+
+NX_TARGET("avx512f")
+void hash16_avx512(const uint8_t* const* inputs,
+                   size_t n_blocks,
+                   const uint32_t key[8],
+                   uint64_t counter,
+                   bool increment_counter,
+                   uint8_t flags,
+                   uint8_t flags_start,
+                   uint8_t flags_end,
+                   uint8_t* out)
+{
+    uint32_t lo[16], hi[16];
+    lane_counters(lo, hi, 16, counter, increment_counter);
+    const __m512i counter_lo = _mm512_loadu_si512((const void*)lo);
+    const __m512i counter_hi = _mm512_loadu_si512((const void*)hi);
+
+    __m512i h[8];
+    for (int i = 0; i < 8; i++) {
+        h[i] = _mm512_set1_epi32((int)key[i]);
+    }
+
+    uint8_t block_flags = flags | flags_start;
+    for (size_t b = 0; b < n_blocks; b++) {
+        if (b + 1 == n_blocks) {
+            block_flags |= flags_end;
+        }
+
+        __m512i m[16];
+        load_transposed_x16(m, inputs, 64 * b);
+
+        __m512i v[16];
+        for (int i = 0; i < 8; i++) {
+            v[i] = h[i];
+        }
+        for (int i = 0; i < 4; i++) {
+            v[8 + i] = _mm512_set1_epi32((int)BLAKE3_IV[i]);
+        }
+        v[12] = counter_lo;
+        v[13] = counter_hi;
+        v[14] = _mm512_set1_epi32((int)BLAKE3_BLOCK_LEN);
+        v[15] = _mm512_set1_epi32(block_flags);
+
+        for (size_t r = 0; r < 7; r++) {
+            const uint8_t* s = BLAKE3_MSG_SCHEDULE[r];
+            g_512(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+            g_512(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+            g_512(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+            g_512(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+            g_512(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+            g_512(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+            g_512(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+            g_512(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+        }
+
+        for (int i = 0; i < 8; i++) {
+            h[i] = _mm512_xor_si512(v[i], v[i + 8]);
+        }
+        block_flags = flags;
+    }
+
+    uint32_t cvs[8 * 16];
+    for (int i = 0; i < 8; i++) {
+        _mm512_storeu_si512((void*)(cvs + 16 * i), h[i]);
+    }
+    store_lane_cvs(cvs, 16, out);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic pop
+#endif
+
+} // namespace
+
+NX_TARGET("sse4.1")
+void blake3_compress_sse41(uint32_t cv[8],
+                           const uint8_t block[64],
+                           uint8_t block_len,
+                           uint64_t counter,
+                           uint8_t flags)
+{
+    uint32_t m[16];
+    memcpy(m, block, sizeof(m));
+
+    __m128i rows[4];
+    rows[0] = _mm_loadu_si128((const __m128i*)cv);
+    rows[1] = _mm_loadu_si128((const __m128i*)cv + 1);
+    rows[2] = _mm_loadu_si128((const __m128i*)BLAKE3_IV);
+    rows[3] = _mm_setr_epi32(
+        (int)counter, (int)(counter >> 32), block_len, flags);
+
+    for (size_t r = 0; r < 7; r++) {
+        const uint8_t* s = BLAKE3_MSG_SCHEDULE[r];
+        g_rows(rows,
+               _mm_setr_epi32(m[s[0]], m[s[2]], m[s[4]], m[s[6]]),
+               _mm_setr_epi32(m[s[1]], m[s[3]], m[s[5]], m[s[7]]));
+
+        // column i now holds the diagonal starting at word (i + 3) % 4
+        rows[0] = _mm_shuffle_epi32(rows[0], _MM_SHUFFLE(2, 1, 0, 3));
+        rows[2] = _mm_shuffle_epi32(rows[2], _MM_SHUFFLE(0, 3, 2, 1));
+        rows[3] = _mm_shuffle_epi32(rows[3], _MM_SHUFFLE(1, 0, 3, 2));
+        g_rows(rows,
+               _mm_setr_epi32(m[s[14]], m[s[8]], m[s[10]], m[s[12]]),
+               _mm_setr_epi32(m[s[15]], m[s[9]], m[s[11]], m[s[13]]));
+        rows[0] = _mm_shuffle_epi32(rows[0], _MM_SHUFFLE(0, 3, 2, 1));
+        rows[2] = _mm_shuffle_epi32(rows[2], _MM_SHUFFLE(2, 1, 0, 3));
+        rows[3] = _mm_shuffle_epi32(rows[3], _MM_SHUFFLE(1, 0, 3, 2));
+    }
+
+    _mm_storeu_si128((__m128i*)cv, _mm_xor_si128(rows[0], rows[2]));
+    _mm_storeu_si128((__m128i*)cv + 1, _mm_xor_si128(rows[1], rows[3]));
+}
+
+void blake3_hash_many_sse41(const uint8_t* const* inputs,
+                            size_t n_inputs,
+                            size_t n_blocks,
+                            const uint32_t key[8],
+                            uint64_t counter,
+                            bool increment_counter,
+                            uint8_t flags,
+                            uint8_t flags_start,
+                            uint8_t flags_end,
+                            uint8_t* out)
+{
+    for (; n_inputs >= 4; n_inputs -= 4) {
+        hash4_sse41(inputs,
+                    n_blocks,
+                    key,
+                    counter,
+                    increment_counter,
+                    flags,
+                    flags_start,
+                    flags_end,
+                    out);
+        inputs += 4;
+        counter += increment_counter ? 4 : 0;
+        out += 4 * BLAKE3_OUT_LEN;
+    }
+    blake3_hash_many_portable(inputs,
+                              n_inputs,
+                              n_blocks,
+                              key,
+                              counter,
+                              increment_counter,
+                              flags,
+                              flags_start,
+                              flags_end,
+                              out);
+}
+
+void blake3_hash_many_avx2(const uint8_t* const* inputs,
+                           size_t n_inputs,
+                           size_t n_blocks,
+                           const uint32_t key[8],
+                           uint64_t counter,
+                           bool increment_counter,
+                           uint8_t flags,
+                           uint8_t flags_start,
+                           uint8_t flags_end,
+                           uint8_t* out)
+{
+    for (; n_inputs >= 8; n_inputs -= 8) {
+        hash8_avx2(inputs,
+                   n_blocks,
+                   key,
+                   counter,
+                   increment_counter,
+                   flags,
+                   flags_start,
+                   flags_end,
+                   out);
+        inputs += 8;
+        counter += increment_counter ? 8 : 0;
+        out += 8 * BLAKE3_OUT_LEN;
+    }
+    blake3_hash_many_sse41(inputs,
+                           n_inputs,
+                           n_blocks,
+                           key,
+                           counter,
+                           increment_counter,
+                           flags,
+                           flags_start,
+                           flags_end,
+                           out);
+}
+
+void blake3_hash_many_avx512(const uint8_t* const* inputs,
+                             size_t n_inputs,
+                             size_t n_blocks,
+                             const uint32_t key[8],
+                             uint64_t counter,
+                             bool increment_counter,
+                             uint8_t flags,
+                             uint8_t flags_start,
+                             uint8_t flags_end,
+                             uint8_t* out)
+{
+    for (; n_inputs >= 16; n_inputs -= 16) {
+        hash16_avx512(inputs,
+                      n_blocks,
+                      key,
+                      counter,
+                      increment_counter,
+                      flags,
+                      flags_start,
+                      flags_end,
+                      out);
+        inputs += 16;
+        counter += increment_counter ? 16 : 0;
+        out += 16 * BLAKE3_OUT_LEN;
+    }
+    blake3_hash_many_avx2(inputs,
+                          n_inputs,
+                          n_blocks,
+                          key,
+                          counter,
+                          increment_counter,
+                          flags,
+                          flags_start,
+                          flags_end,
+                          out);
+}
+
+} // namespace nx::digest::detail
+
+#endif
@@ -0,0 +1,269 @@
+#include <nx/buffered_io.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace nx {
+
+BufferedReader::BufferedReader(Read& source, size_t capacity)
+: source_(source)
+, buffer_(std::max<size_t>(capacity, 1))
+, pos_(0)
+, end_(0)
+{
+}
+
+ReadResult BufferedReader::fill()
+{
+    // keep what is unread at the front, the rest of the buffer is free
+    if (pos_ > 0) {
+        memmove(buffer_.data(), buffer_.data() + pos_, end_ - pos_);
+        end_ -= pos_;
+        pos_ = 0;
+    }
+
+    auto result = source_.read(buffer_.data() + end_, buffer_.size() - end_);
+    end_ += result.bytes();
+    return result;
+}
+
+ReadResult BufferedReader::read(void* buffer, size_t bytes)
+{
+    if (pos_ == end_) {
+        if (bytes >= buffer_.size())
+            return source_.read(buffer, bytes);
+
+        pos_ = end_ = 0;
+        auto result = fill();
+        if (!result.ok())
+            return result;
+    }
+
+    size_t n = std::min(bytes, end_ - pos_);
+    memcpy(buffer, buffer_.data() + pos_, n);
+    pos_ += n;
+    return IO_Success { n };
+}
+
+Optional<size_t> BufferedReader::size_hint() const
+{
+    auto hint = source_.size_hint();
+    if (!hint)
+        return std::nullopt;
+    return *hint + (end_ - pos_);
+}
+
+PeekResult BufferedReader::peek(size_t bytes)
+{
+    bytes = std::min(bytes, buffer_.size());
+    while (end_ - pos_ < bytes) {
+        auto result = fill();
+        if (result.eof())
+            break;
+        if (result.failed())
+            return result.error();
+    }
+    return ByteSpan { buffer_.data() + pos_, std::min(bytes, end_ - pos_) };
+}
+
+void BufferedReader::consume(size_t bytes)
+{
+    pos_ += std::min(bytes, end_ - pos_);
+}
+
+template <class Output>
+ReadResult BufferedReader::read_until_impl(uint8_t delim, Output& output)
+{
+    size_t total = 0;
+    while (true) {
+        const uint8_t* begin = buffer_.data() + pos_;
+        size_t available = end_ - pos_;
+        auto* found = (const uint8_t*)memchr(begin, delim, available);
+        size_t n = found ? (size_t)(found - begin) + 1 : available;
+
+        output.insert(output.end(), begin, begin + n);
+        pos_ += n;
+        total += n;
+        if (found)
+            break;
+
+        pos_ = end_ = 0;
+        auto result = fill();
+        if (result.eof())
+            break;
+        if (result.failed())
+            return result;
+    }
+
+    if (total == 0)
+        return EndOfFile {};
+    return IO_Success { total };
+}
+
+ReadResult BufferedReader::read_until(uint8_t delim, ByteBuffer& output)
+{
+    return read_until_impl(delim, output);
+}
+
+ReadResult BufferedReader::read_line(String& line)
+{
+    line.clear();
+    auto result = read_until_impl('\n', line);
+    if (!line.empty() && line.back() == '\n') {
+        line.pop_back();
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+    }
+    return result;
+}
+
+BufferedWriter::BufferedWriter(Write& sink, size_t capacity)
+: sink_(sink)
+, buffer_(std::max<size_t>(capacity, 1))
+, end_(0)
+{
+}
+
+BufferedWriter::~BufferedWriter() { flush(); }
+
+WriteResult BufferedWriter::write(const void* buffer, size_t bytes)
+{
+    if (end_ + bytes > buffer_.size()) {
+        if (!flush())
+            return IO_Error::IO_FAIL;
+    }
+
+    if (bytes >= buffer_.size()) {
+        if (!sink_.write_all(buffer, bytes))
+            return IO_Error::IO_FAIL;
+    } else {
+        memcpy(buffer_.data() + end_, buffer, bytes);
+        end_ += bytes;
+    }
+    return IO_Success { bytes };
+}
+
+bool BufferedWriter::flush()
+{
+    if (end_ == 0)
+        return true;
+    if (!sink_.write_all(buffer_.data(), end_))
+        return false;
+    end_ = 0;
+    return true;
+}
+
+// The ring is shared under one mutex: the thread fills buffers at tail,
+// the consumer empties them at head. Data is copied outside the lock, a
+// buffer between head and tail belongs to the consumer alone.
+struct PrefetchReader::State {
+    Read& source;
+    Vector<ByteBuffer> buffers;
+    Vector<size_t> sizes;
+    size_t head = 0;
+    size_t tail = 0;
+    size_t count = 0;
+    size_t offset = 0;
+
+    // EndOfFile or an error from the source, once the thread is done
+    Optional<ReadResult> last;
+    bool stop = false;
+
+    std::mutex mutex;
+    std::condition_variable filled;
+    std::condition_variable emptied;
+    std::thread thread;
+
+    State(Read& source, size_t n, size_t buffer_size)
+    : source(source)
+    , buffers(n, ByteBuffer(buffer_size))
+    , sizes(n)
+    {
+    }
+
+    void run()
+    {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                emptied.wait(lock,
+                             [&] { return stop || count < sizes.size(); });
+                if (stop)
+                    return;
+            }
+
+            ByteBuffer& buffer = buffers[tail];
+            auto result = source.read(buffer.data(), buffer.size());
+            if (result.ok() && result.bytes() == 0)
+                continue;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (result.ok()) {
+                sizes[tail] = result.bytes();
+                tail = (tail + 1) % sizes.size();
+                count++;
+            } else {
+                last = result;
+            }
+            filled.notify_one();
+            if (last)
+                return;
+        }
+    }
+};
+
+PrefetchReader::PrefetchReader(Read& source,
+                               size_t buffers,
+                               size_t buffer_size)
+: state_(std::make_unique<State>(
+    source, std::max<size_t>(buffers, 2), std::max<size_t>(buffer_size, 1)))
+, size_hint_(source.size_hint())
+{
+    State* state = state_.get();
+    state->thread = std::thread([state] { state->run(); });
+}
+
+PrefetchReader::~PrefetchReader()
+{
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->stop = true;
+    }
+    state_->emptied.notify_one();
+    state_->thread.join();
+}
+
+ReadResult PrefetchReader::read(void* buffer, size_t bytes)
+{
+    State& state = *state_;
+    {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        state.filled.wait(
+            lock, [&] { return state.count > 0 || state.last.has_value(); });
+        if (state.count == 0)
+            return *state.last;
+    }
+
+    size_t head = state.head;
+    size_t n = std::min(bytes, state.sizes[head] - state.offset);
+    memcpy(buffer, state.buffers[head].data() + state.offset, n);
+    state.offset += n;
+    if (size_hint_) {
+        *size_hint_ -= std::min(*size_hint_, n);
+    }
+
+    if (state.offset == state.sizes[head]) {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.head = (head + 1) % state.sizes.size();
+        state.count--;
+        state.offset = 0;
+        state.emptied.notify_one();
+    }
+    return IO_Success { n };
+}
+
+Optional<size_t> PrefetchReader::size_hint() const { return size_hint_; }
+
+} // namespace nx
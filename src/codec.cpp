@@ -0,0 +1,391 @@
+#include <nx/codec.h>
+#include <nx/compress.h>
+#include "codec_builtin.h"
+
+#if defined(USE_ZLIB)
+    #include <zlib.h>
+#endif
+
+#include <climits>
+#include <mutex>
+
+namespace nx::compress {
+
+Codec::~Codec() { }
+
+Optional<size_t> Codec::max_raw_size(const uint8_t*, size_t) const
+{
+    return std::nullopt;
+}
+
+namespace detail {
+
+int resolve_level(const Codec& codec, int level)
+{
+    if (level == -1)
+        return codec.default_level();
+    return std::clamp(level, codec.min_level(), codec.max_level());
+}
+
+size_t expand_bound(size_t len, size_t ratio, size_t extra)
+{
+    if (len > (SIZE_MAX - extra) / ratio)
+        return SIZE_MAX;
+    return len * ratio + extra;
+}
+
+} // namespace detail
+
+namespace {
+
+class StoreWriter : public CodecWriter {
+public:
+    explicit StoreWriter(Write& sink)
+    : sink_(sink)
+    , finished_(false)
+    {
+    }
+
+    WriteResult write(const void* buffer, size_t bytes) override
+    {
+        if (finished_)
+            return IO_Error::IO_FAIL;
+        return sink_.write(buffer, bytes);
+    }
+
+    bool finish() override
+    {
+        finished_ = true;
+        return true;
+    }
+
+private:
+    Write& sink_;
+    bool finished_;
+};
+
+class StoreReader : public Read {
+public:
+    explicit StoreReader(Read& source)
+    : source_(source)
+    {
+    }
+
+    ReadResult read(void* buffer, size_t bytes) override
+    {
+        return source_.read(buffer, bytes);
+    }
+
+    Optional<size_t> size_hint() const override
+    {
+        return source_.size_hint();
+    }
+
+private:
+    Read& source_;
+};
+
+class StoreCodec : public Codec {
+public:
+    CodecId id() const override { return CodecId::STORE; }
+    const char* name() const override { return "store"; }
+    int default_level() const override { return 0; }
+    int min_level() const override { return 0; }
+    int max_level() const override { return 0; }
+
+    size_t bound(size_t len) const override { return len; }
+
+    Optional<size_t> max_raw_size(const uint8_t*, size_t len) const override
+    {
+        return len;
+    }
+
+    Optional<size_t> compress(const uint8_t* data,
+                              size_t len,
+                              uint8_t* out,
+                              int) const override
+    {
+        if (len > 0)
+            memcpy(out, data, len);
+        return len;
+    }
+
+    bool decompress(const uint8_t* data,
+                    size_t len,
+                    uint8_t* out,
+                    size_t out_len) const override
+    {
+        if (len != out_len)
+            return false;
+        if (len > 0)
+            memcpy(out, data, len);
+        return true;
+    }
+
+    UniquePtr<CodecWriter> writer(Write& sink, int) const override
+    {
+        return std::make_unique<StoreWriter>(sink);
+    }
+
+    UniquePtr<Read> reader(Read& source) const override
+    {
+        return std::make_unique<StoreReader>(source);
+    }
+};
+
+struct Registry {
+    std::mutex mutex;
+    Vector<UniquePtr<Codec>> codecs;
+    // replaced codecs, pointers to them stay valid
+    Vector<UniquePtr<Codec>> retired;
+
+    Registry()
+    {
+        codecs.push_back(std::make_unique<StoreCodec>());
+        for (auto* make :
+             { &detail::zlib_codec, &detail::lz4_codec, &detail::zstd_codec }) {
+            if (auto codec = make())
+                codecs.push_back(std::move(codec));
+        }
+    }
+};
+
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+const uint8_t FRAME_MAGIC[4] = { 'N', 'X', 'C', '1' };
+
+// magic, codec id, 3 reserved bytes, raw size in little endian
+void write_header(uint8_t* header, CodecId id, uint64_t raw_size)
+{
+    memcpy(header, FRAME_MAGIC, 4);
+    header[4] = (uint8_t)id;
+    header[5] = header[6] = header[7] = 0;
+    for (int i = 0; i < 8; i++) {
+        header[8 + i] = (uint8_t)(raw_size >> (i * 8));
+    }
+}
+
+const Codec* read_header(const uint8_t* header, uint64_t* raw_size)
+{
+    if (memcmp(header, FRAME_MAGIC, 4) != 0)
+        return nullptr;
+
+    *raw_size = 0;
+    for (int i = 0; i < 8; i++) {
+        *raw_size |= (uint64_t)header[8 + i] << (i * 8);
+    }
+    return find_codec((CodecId)header[4]);
+}
+
+} // namespace
+
+void register_codec(UniquePtr<Codec> codec)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (auto& registered : r.codecs) {
+        if (registered->id() == codec->id()) {
+            r.retired.push_back(std::move(registered));
+            registered = std::move(codec);
+            return;
+        }
+    }
+    r.codecs.push_back(std::move(codec));
+}
+
+const Codec* find_codec(CodecId id)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (auto& codec : r.codecs) {
+        if (codec->id() == id)
+            return codec.get();
+    }
+    return nullptr;
+}
+
+const Codec* find_codec(const String& name)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (auto& codec : r.codecs) {
+        if (name == codec->name())
+            return codec.get();
+    }
+    return nullptr;
+}
+
+Vector<const Codec*> codecs()
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    Vector<const Codec*> result;
+    for (auto& codec : r.codecs) {
+        result.push_back(codec.get());
+    }
+    return result;
+}
+
+ByteBuffer
+encode(const Codec& codec, const uint8_t* data, size_t len, int level)
+{
+    ByteBuffer frame(FRAME_HEADER_SIZE + codec.bound(len));
+    write_header(frame.data(), codec.id(), len);
+
+    auto size = codec.compress(data,
+                               len,
+                               frame.data() + FRAME_HEADER_SIZE,
+                               detail::resolve_level(codec, level));
+    if (!size)
+        return {};
+
+    frame.resize(FRAME_HEADER_SIZE + *size);
+    return frame;
+}
+
+ReadAllResult decode(const uint8_t* data, size_t len)
+{
+    uint64_t raw_size;
+    if (len < FRAME_HEADER_SIZE)
+        return IO_Error::IO_FAIL;
+    const Codec* codec = read_header(data, &raw_size);
+    if (!codec)
+        return IO_Error::IO_FAIL;
+
+    if (raw_size == UNKNOWN_SIZE) {
+        MemoryFile source(data, len);
+        auto reader = frame_reader(source);
+        return reader->read_all();
+    }
+
+    if (raw_size > SIZE_MAX)
+        return IO_Error::IO_FAIL;
+
+    // the header is not trusted with the allocation
+    const uint8_t* payload = data + FRAME_HEADER_SIZE;
+    size_t payload_len = len - FRAME_HEADER_SIZE;
+    auto limit = codec->max_raw_size(payload, payload_len);
+    if (limit && raw_size > *limit)
+        return IO_Error::IO_FAIL;
+
+    ByteBuffer output(raw_size);
+    if (!codec->decompress(payload, payload_len, output.data(), output.size()))
+        return IO_Error::IO_FAIL;
+    return output;
+}
+
+UniquePtr<CodecWriter> frame_writer(Write& sink, const Codec& codec, int level)
+{
+    uint8_t header[FRAME_HEADER_SIZE];
+    write_header(header, codec.id(), UNKNOWN_SIZE);
+    if (!sink.write_all(header, sizeof(header)))
+        return nullptr;
+    return codec.writer(sink, detail::resolve_level(codec, level));
+}
+
+UniquePtr<Read> frame_reader(Read& source)
+{
+    uint8_t header[FRAME_HEADER_SIZE];
+    uint64_t raw_size;
+    if (!source.read_exact(header, sizeof(header)))
+        return nullptr;
+    const Codec* codec = read_header(header, &raw_size);
+    if (!codec)
+        return nullptr;
+    return codec->reader(source);
+}
+
+#if defined(USE_ZLIB)
+
+namespace {
+
+class ZlibWriter : public CodecWriter {
+public:
+    ZlibWriter(Write& sink, int level)
+    : deflate_(sink, level, DeflateFormat::ZLIB)
+    {
+    }
+
+    WriteResult write(const void* buffer, size_t bytes) override
+    {
+        return deflate_.write(buffer, bytes);
+    }
+
+    bool finish() override { return deflate_.finish(); }
+
+private:
+    DeflateWriter deflate_;
+};
+
+class ZlibCodec : public Codec {
+public:
+    CodecId id() const override { return CodecId::ZLIB; }
+    const char* name() const override { return "zlib"; }
+    int default_level() const override { return 6; }
+    int min_level() const override { return 0; }
+    int max_level() const override { return 9; }
+
+    size_t bound(size_t len) const override
+    {
+        return compressBound((uLong)len);
+    }
+
+    // a deflate match of 258 bytes takes at least 2 bits
+    Optional<size_t> max_raw_size(const uint8_t*, size_t len) const override
+    {
+        return detail::expand_bound(len, 1032, 0);
+    }
+
+    Optional<size_t> compress(const uint8_t* data,
+                              size_t len,
+                              uint8_t* out,
+                              int level) const override
+    {
+        if (len > ULONG_MAX)
+            return std::nullopt;
+
+        uLongf size = compressBound((uLong)len);
+        if (compress2(out, &size, data, (uLong)len, level) != Z_OK)
+            return std::nullopt;
+        return size;
+    }
+
+    bool decompress(const uint8_t* data,
+                    size_t len,
+                    uint8_t* out,
+                    size_t out_len) const override
+    {
+        if (len > ULONG_MAX || out_len > ULONG_MAX)
+            return false;
+
+        uLongf size = (uLongf)out_len;
+        return uncompress(out, &size, data, (uLong)len) == Z_OK
+               && size == out_len;
+    }
+
+    UniquePtr<CodecWriter> writer(Write& sink, int level) const override
+    {
+        return std::make_unique<ZlibWriter>(sink, level);
+    }
+
+    UniquePtr<Read> reader(Read& source) const override
+    {
+        return std::make_unique<InflateReader>(source, DeflateFormat::ZLIB);
+    }
+};
+
+} // namespace
+
+UniquePtr<Codec> detail::zlib_codec() { return std::make_unique<ZlibCodec>(); }
+
+#else
+
+UniquePtr<Codec> detail::zlib_codec() { return nullptr; }
+
+#endif
+
+} // namespace nx::compress
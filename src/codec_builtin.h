@@ -0,0 +1,28 @@
+#pragma once
+
+#include <nx/codec.h>
+
+namespace nx::compress::detail {
+
+/**
+ * @brief      the built in codecs, nullptr when nx is built without their
+ *             library
+ */
+UniquePtr<Codec> zlib_codec();
+UniquePtr<Codec> lz4_codec();
+UniquePtr<Codec> zstd_codec();
+
+/**
+ * @brief      the level to use for a level passed by the user, -1 is the
+ *             codec's default and the rest is clamped to its range
+ */
+int resolve_level(const Codec& codec, int level);
+
+/**
+ * @brief      len * ratio + extra, SIZE_MAX if it does not fit. The most a
+ *             format expanding at most ratio times, apart from extra bytes
+ *             of output, makes out of len bytes.
+ */
+size_t expand_bound(size_t len, size_t ratio, size_t extra);
+
+} // namespace nx::compress::detail
@@ -0,0 +1,253 @@
+#include "codec_builtin.h"
+
+#if defined(USE_LZ4)
+    #include <lz4.h>
+    #include <lz4frame.h>
+    #include <lz4hc.h>
+#endif
+
+#include <climits>
+
+namespace nx::compress {
+
+#if defined(USE_LZ4)
+
+namespace {
+
+// the input of one LZ4F_compressUpdate, which bounds the output buffer
+constexpr size_t LZ4_CHUNK = 64_kb;
+
+class Lz4Writer : public CodecWriter {
+public:
+    Lz4Writer(Write& sink, int level)
+    : sink_(sink)
+    , finished_(false)
+    {
+        prefs_.compressionLevel = level;
+        if (LZ4F_isError(LZ4F_createCompressionContext(&ctx_, LZ4F_VERSION)))
+            NX_PANIC("LZ4F_createCompressionContext fail");
+
+        buffer_.resize(LZ4F_HEADER_SIZE_MAX
+                       + LZ4F_compressBound(LZ4_CHUNK, &prefs_));
+        // the frame header waits in the buffer for the first drain
+        used_ = LZ4F_compressBegin(
+            ctx_, buffer_.data(), buffer_.size(), &prefs_);
+        if (LZ4F_isError(used_))
+            NX_PANIC("LZ4F_compressBegin fail");
+    }
+
+    ~Lz4Writer()
+    {
+        finish();
+        LZ4F_freeCompressionContext(ctx_);
+    }
+
+    WriteResult write(const void* buffer, size_t bytes) override
+    {
+        if (finished_)
+            return IO_Error::IO_FAIL;
+
+        auto* data = (const uint8_t*)buffer;
+        size_t left = bytes;
+        while (left > 0) {
+            size_t n = std::min(left, LZ4_CHUNK);
+            if (!reserve(LZ4F_compressBound(n, &prefs_)))
+                return IO_Error::IO_FAIL;
+
+            size_t out = LZ4F_compressUpdate(ctx_,
+                                             buffer_.data() + used_,
+                                             buffer_.size() - used_,
+                                             data,
+                                             n,
+                                             nullptr);
+            if (LZ4F_isError(out))
+                return IO_Error::IO_FAIL;
+            used_ += out;
+            data += n;
+            left -= n;
+        }
+        return IO_Success { bytes };
+    }
+
+    bool finish() override
+    {
+        if (finished_)
+            return true;
+
+        finished_ = true;
+        if (!reserve(LZ4F_compressBound(0, &prefs_)))
+            return false;
+
+        size_t out = LZ4F_compressEnd(
+            ctx_, buffer_.data() + used_, buffer_.size() - used_, nullptr);
+        if (LZ4F_isError(out))
+            return false;
+        used_ += out;
+        return drain();
+    }
+
+private:
+    // make room for bytes of output
+    bool reserve(size_t bytes)
+    {
+        return used_ + bytes <= buffer_.size() || drain();
+    }
+
+    bool drain()
+    {
+        if (used_ == 0)
+            return true;
+        if (!sink_.write_all(buffer_.data(), used_))
+            return false;
+        used_ = 0;
+        return true;
+    }
+
+    Write& sink_;
+    LZ4F_cctx* ctx_ = nullptr;
+    LZ4F_preferences_t prefs_ = {};
+    ByteBuffer buffer_;
+    size_t used_;
+    bool finished_;
+};
+
+class Lz4Reader : public Read {
+public:
+    explicit Lz4Reader(Read& source)
+    : source_(source)
+    , buffer_(LZ4_CHUNK)
+    {
+        if (LZ4F_isError(
+                LZ4F_createDecompressionContext(&ctx_, LZ4F_VERSION))) {
+            NX_PANIC("LZ4F_createDecompressionContext fail");
+        }
+    }
+
+    ~Lz4Reader() { LZ4F_freeDecompressionContext(ctx_); }
+
+    ReadResult read(void* buffer, size_t bytes) override
+    {
+        if (bytes == 0)
+            return IO_Success { 0 };
+
+        while (true) {
+            if (pos_ == end_ && !source_end_) {
+                auto result = source_.read(buffer_.data(), buffer_.size());
+                if (result.failed())
+                    return result;
+                source_end_ = result.eof();
+                pos_ = 0;
+                end_ = result.bytes();
+                continue;
+            }
+            if (pos_ == end_ && frame_end_)
+                return EndOfFile {};
+
+            // without input the decoder may still flush what did not fit
+            // the last output
+            size_t out = bytes;
+            size_t in = end_ - pos_;
+            size_t hint = LZ4F_decompress(
+                ctx_, buffer, &out, buffer_.data() + pos_, &in, nullptr);
+            if (LZ4F_isError(hint))
+                return IO_Error::IO_FAIL;
+
+            pos_ += in;
+            // 0 ends a frame, another one may follow
+            frame_end_ = hint == 0;
+            if (out > 0)
+                return IO_Success { out };
+            if (pos_ == end_ && source_end_) {
+                if (frame_end_)
+                    return EndOfFile {};
+                return IO_Error::IO_FAIL;
+            }
+        }
+    }
+
+private:
+    Read& source_;
+    LZ4F_dctx* ctx_ = nullptr;
+    ByteBuffer buffer_;
+    size_t pos_ = 0;
+    size_t end_ = 0;
+    bool source_end_ = false;
+    bool frame_end_ = false;
+};
+
+class Lz4Codec : public Codec {
+public:
+    CodecId id() const override { return CodecId::LZ4; }
+    const char* name() const override { return "lz4"; }
+
+    // levels below LZ4HC_CLEVEL_MIN are the fast compressor, the rest HC
+    int default_level() const override { return 1; }
+    int min_level() const override { return 1; }
+    int max_level() const override { return LZ4HC_CLEVEL_MAX; }
+
+    size_t bound(size_t len) const override { return len + len / 255 + 16; }
+
+    // every 255 bytes of a match length take one more byte, a sequence
+    // starts with at most 19 bytes from 3
+    Optional<size_t> max_raw_size(const uint8_t*, size_t len) const override
+    {
+        return detail::expand_bound(len, 255, 16);
+    }
+
+    Optional<size_t> compress(const uint8_t* data,
+                              size_t len,
+                              uint8_t* out,
+                              int level) const override
+    {
+        if (len > LZ4_MAX_INPUT_SIZE)
+            return std::nullopt;
+
+        int capacity = LZ4_compressBound((int)len);
+        int size;
+        if (level < LZ4HC_CLEVEL_MIN) {
+            size = LZ4_compress_default(
+                (const char*)data, (char*)out, (int)len, capacity);
+        } else {
+            size = LZ4_compress_HC(
+                (const char*)data, (char*)out, (int)len, capacity, level);
+        }
+        if (size <= 0 && len > 0)
+            return std::nullopt;
+        return (size_t)size;
+    }
+
+    bool decompress(const uint8_t* data,
+                    size_t len,
+                    uint8_t* out,
+                    size_t out_len) const override
+    {
+        if (len > INT_MAX || out_len > INT_MAX)
+            return false;
+
+        int size = LZ4_decompress_safe(
+            (const char*)data, (char*)out, (int)len, (int)out_len);
+        return size >= 0 && (size_t)size == out_len;
+    }
+
+    UniquePtr<CodecWriter> writer(Write& sink, int level) const override
+    {
+        return std::make_unique<Lz4Writer>(sink, level);
+    }
+
+    UniquePtr<Read> reader(Read& source) const override
+    {
+        return std::make_unique<Lz4Reader>(source);
+    }
+};
+
+} // namespace
+
+UniquePtr<Codec> detail::lz4_codec() { return std::make_unique<Lz4Codec>(); }
+
+#else
+
+UniquePtr<Codec> detail::lz4_codec() { return nullptr; }
+
+#endif
+
+} // namespace nx::compress
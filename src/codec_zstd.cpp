@@ -0,0 +1,203 @@
+#include "codec_builtin.h"
+
+#if defined(USE_ZSTD)
+    #include <zstd.h>
+#endif
+
+namespace nx::compress {
+
+#if defined(USE_ZSTD)
+
+namespace {
+
+class ZstdWriter : public CodecWriter {
+public:
+    ZstdWriter(Write& sink, int level)
+    : sink_(sink)
+    , ctx_(ZSTD_createCCtx())
+    , buffer_(ZSTD_CStreamOutSize())
+    , finished_(false)
+    {
+        if (!ctx_)
+            NX_PANIC("ZSTD_createCCtx fail");
+        ZSTD_CCtx_setParameter(ctx_, ZSTD_c_compressionLevel, level);
+    }
+
+    ~ZstdWriter()
+    {
+        finish();
+        ZSTD_freeCCtx(ctx_);
+    }
+
+    WriteResult write(const void* buffer, size_t bytes) override
+    {
+        if (finished_)
+            return IO_Error::IO_FAIL;
+
+        ZSTD_inBuffer in = { buffer, bytes, 0 };
+        while (in.pos < in.size) {
+            if (!run(in, ZSTD_e_continue))
+                return IO_Error::IO_FAIL;
+        }
+        return IO_Success { bytes };
+    }
+
+    bool finish() override
+    {
+        if (finished_)
+            return true;
+
+        finished_ = true;
+        ZSTD_inBuffer in = { nullptr, 0, 0 };
+        // the stream is flushed when nothing is left
+        while (true) {
+            auto left = run(in, ZSTD_e_end);
+            if (!left)
+                return false;
+            if (*left == 0)
+                return true;
+        }
+    }
+
+private:
+    // one call to the compressor, its output goes to the sink
+    Optional<size_t> run(ZSTD_inBuffer& in, ZSTD_EndDirective directive)
+    {
+        ZSTD_outBuffer out = { buffer_.data(), buffer_.size(), 0 };
+        size_t left = ZSTD_compressStream2(ctx_, &out, &in, directive);
+        if (ZSTD_isError(left))
+            return std::nullopt;
+        if (out.pos > 0 && !sink_.write_all(buffer_.data(), out.pos))
+            return std::nullopt;
+        return left;
+    }
+
+    Write& sink_;
+    ZSTD_CCtx* ctx_;
+    ByteBuffer buffer_;
+    bool finished_;
+};
+
+class ZstdReader : public Read {
+public:
+    explicit ZstdReader(Read& source)
+    : source_(source)
+    , ctx_(ZSTD_createDCtx())
+    , buffer_(ZSTD_DStreamInSize())
+    {
+        if (!ctx_)
+            NX_PANIC("ZSTD_createDCtx fail");
+    }
+
+    ~ZstdReader() { ZSTD_freeDCtx(ctx_); }
+
+    ReadResult read(void* buffer, size_t bytes) override
+    {
+        if (bytes == 0)
+            return IO_Success { 0 };
+
+        while (true) {
+            if (in_.pos == in_.size && !source_end_) {
+                auto result = source_.read(buffer_.data(), buffer_.size());
+                if (result.failed())
+                    return result;
+                source_end_ = result.eof();
+                in_ = { buffer_.data(), result.bytes(), 0 };
+                continue;
+            }
+            if (in_.pos == in_.size && frame_end_)
+                return EndOfFile {};
+
+            // without input the decoder may still flush what did not fit
+            // the last output
+            ZSTD_outBuffer out = { buffer, bytes, 0 };
+            size_t hint = ZSTD_decompressStream(ctx_, &out, &in_);
+            if (ZSTD_isError(hint))
+                return IO_Error::IO_FAIL;
+
+            // 0 ends a frame, another one may follow
+            frame_end_ = hint == 0;
+            if (out.pos > 0)
+                return IO_Success { out.pos };
+            if (in_.pos == in_.size && source_end_) {
+                if (frame_end_)
+                    return EndOfFile {};
+                return IO_Error::IO_FAIL;
+            }
+        }
+    }
+
+private:
+    Read& source_;
+    ZSTD_DCtx* ctx_;
+    ByteBuffer buffer_;
+    ZSTD_inBuffer in_ = { nullptr, 0, 0 };
+    bool source_end_ = false;
+    bool frame_end_ = false;
+};
+
+class ZstdCodec : public Codec {
+public:
+    CodecId id() const override { return CodecId::ZSTD; }
+    const char* name() const override { return "zstd"; }
+    int default_level() const override { return ZSTD_CLEVEL_DEFAULT; }
+    int min_level() const override { return 1; }
+    int max_level() const override { return ZSTD_maxCLevel(); }
+
+    size_t bound(size_t len) const override { return ZSTD_compressBound(len); }
+
+    // compress() records the size in the frame. Without it, a block of 4
+    // bytes repeats one byte up to 128 KB.
+    Optional<size_t> max_raw_size(const uint8_t* data,
+                                  size_t len) const override
+    {
+        auto size = ZSTD_getFrameContentSize(data, len);
+        if (size == ZSTD_CONTENTSIZE_ERROR)
+            return 0;
+        if (size != ZSTD_CONTENTSIZE_UNKNOWN)
+            return (size_t)std::min<unsigned long long>(size, SIZE_MAX);
+        return detail::expand_bound(len / 4 + 1, 128_kb, 0);
+    }
+
+    Optional<size_t> compress(const uint8_t* data,
+                              size_t len,
+                              uint8_t* out,
+                              int level) const override
+    {
+        size_t size = ZSTD_compress(out, bound(len), data, len, level);
+        if (ZSTD_isError(size))
+            return std::nullopt;
+        return size;
+    }
+
+    bool decompress(const uint8_t* data,
+                    size_t len,
+                    uint8_t* out,
+                    size_t out_len) const override
+    {
+        size_t size = ZSTD_decompress(out, out_len, data, len);
+        return !ZSTD_isError(size) && size == out_len;
+    }
+
+    UniquePtr<CodecWriter> writer(Write& sink, int level) const override
+    {
+        return std::make_unique<ZstdWriter>(sink, level);
+    }
+
+    UniquePtr<Read> reader(Read& source) const override
+    {
+        return std::make_unique<ZstdReader>(source);
+    }
+};
+
+} // namespace
+
+UniquePtr<Codec> detail::zstd_codec() { return std::make_unique<ZstdCodec>(); }
+
+#else
+
+UniquePtr<Codec> detail::zstd_codec() { return nullptr; }
+
+#endif
+
+} // namespace nx::compress
@@ -1,29 +1,566 @@
-#include <nx/type.h>
+#include <nx/compress.h>
+#include <nx/digest.h>
+#include "parallel.h"
+
+#if defined(USE_ZLIB)
+    #include <zlib.h>
+#endif
+
+#include <atomic>
+#include <climits>
 
 namespace nx {
 
-ByteBuffer zlib_compress(const uint8_t* buf, size_t len)
-{
-    (void)buf;
-    (void)len;
 #if defined(USE_ZLIB)
-    NX_PANIC("build without zlib");
-    return {};
+
+namespace {
+
+int window_bits(DeflateFormat format, bool inflate)
+{
+    switch (format) {
+        case DeflateFormat::ZLIB:
+            return MAX_WBITS;
+        case DeflateFormat::GZIP:
+            // inflate detects zlib or gzip headers with +32
+            return MAX_WBITS + (inflate ? 32 : 16);
+        case DeflateFormat::RAW:
+            return -MAX_WBITS;
+    }
+    return MAX_WBITS;
+}
+
+// zlib counts in uInt, larger inputs are fed in pieces
+uInt clamp(size_t n) { return (uInt)std::min<size_t>(n, UINT_MAX); }
+
+// -1 is zlib's default, other levels out of 0..9 are clamped, as
+// deflateInit2 refuses them
+int deflate_level(int level)
+{
+    if (level == Z_DEFAULT_COMPRESSION)
+        return level;
+    return std::clamp(level, Z_NO_COMPRESSION, Z_BEST_COMPRESSION);
+}
+
+} // namespace
+
+ByteBuffer zlib_compress(const uint8_t* buf, size_t len, int level)
+{
+    uLongf size = compressBound((uLong)len);
+    ByteBuffer output(size);
+    if (compress2(
+            output.data(), &size, buf, (uLong)len, deflate_level(level))
+        != Z_OK)
+        return {};
+
+    output.resize(size);
+    return output;
+}
+
+ByteBuffer zlib_uncompress(const uint8_t* buf, size_t len, size_t size_hint)
+{
+    z_stream stream = {};
+    if (inflateInit2(&stream, window_bits(DeflateFormat::GZIP, true)) != Z_OK)
+        return {};
+
+    // one spare byte, so that a right hint does not grow the buffer
+    size_t capacity = size_hint ? size_hint + 1 : std::max<size_t>(len * 4, 64);
+    ByteBuffer output(capacity);
+    stream.next_in = (Bytef*)buf;
+    size_t in_left = len;
+    int status = Z_OK;
+    while (status != Z_STREAM_END) {
+        if (stream.total_out == output.size()) {
+            output.resize(output.size() * 2);
+        }
+        stream.next_out = output.data() + stream.total_out;
+        stream.avail_out = clamp(output.size() - stream.total_out);
+        size_t in_now = clamp(in_left);
+        stream.avail_in = (uInt)in_now;
+
+        status = inflate(&stream, Z_NO_FLUSH);
+        in_left -= in_now - stream.avail_in;
+        if (status == Z_BUF_ERROR && in_left == 0)
+            break;
+        if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR)
+            break;
+    }
+
+    size_t size = stream.total_out;
+    inflateEnd(&stream);
+    if (status != Z_STREAM_END)
+        return {};
+
+    output.resize(size);
+    return output;
+}
+
+struct DeflateWriter::Stream {
+    Write& sink;
+    z_stream z = {};
+    ByteBuffer buffer;
+    bool finished = false;
+
+    Stream(Write& sink, size_t buffer_size)
+    : sink(sink)
+    , buffer(std::max<size_t>(buffer_size, 64))
+    {
+    }
+
+    ~Stream() { deflateEnd(&z); }
+
+    // pass the compressed bytes in the buffer on to the sink
+    bool drain()
+    {
+        size_t pending = buffer.size() - z.avail_out;
+        z.next_out = buffer.data();
+        z.avail_out = clamp(buffer.size());
+        return pending == 0 || sink.write_all(buffer.data(), pending);
+    }
+
+    // run deflate until it has taken all input and, for a flush, until it
+    // has room left over, which means it has nothing more to give
+    bool run(int flush)
+    {
+        while (true) {
+            if (z.avail_out == 0 && !drain())
+                return false;
+
+            int status = deflate(&z, flush);
+            if (status == Z_STREAM_ERROR)
+                return false;
+            if (status == Z_STREAM_END)
+                return true;
+            if (z.avail_in == 0 && z.avail_out > 0 && flush != Z_FINISH)
+                return true;
+        }
+    }
+};
+
+DeflateWriter::DeflateWriter(Write& sink,
+                             int level,
+                             DeflateFormat format,
+                             size_t buffer_size)
+: stream_(std::make_unique<Stream>(sink, buffer_size))
+{
+    z_stream& z = stream_->z;
+    if (deflateInit2(&z,
+                     deflate_level(level),
+                     Z_DEFLATED,
+                     window_bits(format, false),
+                     8,
+                     Z_DEFAULT_STRATEGY)
+        != Z_OK) {
+        NX_PANIC("deflateInit2 fail");
+    }
+    z.next_out = stream_->buffer.data();
+    z.avail_out = clamp(stream_->buffer.size());
+}
+
+DeflateWriter::~DeflateWriter() { finish(); }
+
+WriteResult DeflateWriter::write(const void* buffer, size_t bytes)
+{
+    Stream& stream = *stream_;
+    if (stream.finished)
+        return IO_Error::IO_FAIL;
+
+    auto* data = (const uint8_t*)buffer;
+    size_t left = bytes;
+    while (left > 0) {
+        stream.z.next_in = (Bytef*)data;
+        stream.z.avail_in = clamp(left);
+        size_t now = stream.z.avail_in;
+        if (!stream.run(Z_NO_FLUSH))
+            return IO_Error::IO_FAIL;
+        data += now;
+        left -= now;
+    }
+    return IO_Success { bytes };
+}
+
+bool DeflateWriter::flush()
+{
+    Stream& stream = *stream_;
+    if (stream.finished)
+        return false;
+
+    stream.z.avail_in = 0;
+    return stream.run(Z_SYNC_FLUSH) && stream.drain();
+}
+
+bool DeflateWriter::finish()
+{
+    Stream& stream = *stream_;
+    if (stream.finished)
+        return true;
+
+    stream.finished = true;
+    stream.z.avail_in = 0;
+    return stream.run(Z_FINISH) && stream.drain();
+}
+
+struct InflateReader::Stream {
+    Read& source;
+    DeflateFormat format;
+    z_stream z = {};
+    ByteBuffer buffer;
+    bool source_end = false;
+    bool stream_end = false;
+
+    Stream(Read& source, DeflateFormat format, size_t buffer_size)
+    : source(source)
+    , format(format)
+    , buffer(std::max<size_t>(buffer_size, 64))
+    {
+    }
+
+    ~Stream() { inflateEnd(&z); }
+
+    IoResult refill()
+    {
+        auto result = source.read(buffer.data(), buffer.size());
+        if (result.eof()) {
+            source_end = true;
+        }
+        z.next_in = buffer.data();
+        z.avail_in = (uInt)result.bytes();
+        return result;
+    }
+};
+
+InflateReader::InflateReader(Read& source,
+                             DeflateFormat format,
+                             size_t buffer_size)
+: stream_(std::make_unique<Stream>(source, format, buffer_size))
+{
+    if (inflateInit2(&stream_->z, window_bits(format, true)) != Z_OK) {
+        NX_PANIC("inflateInit2 fail");
+    }
+}
+
+InflateReader::~InflateReader() { }
+
+ReadResult InflateReader::read(void* buffer, size_t bytes)
+{
+    Stream& stream = *stream_;
+    z_stream& z = stream.z;
+    if (bytes == 0)
+        return IO_Success { 0 };
+
+    z.next_out = (Bytef*)buffer;
+    z.avail_out = clamp(bytes);
+    size_t wanted = z.avail_out;
+    while (z.avail_out == wanted && !stream.stream_end) {
+        if (z.avail_in == 0 && !stream.source_end) {
+            if (stream.refill().failed())
+                return IO_Error::IO_FAIL;
+            continue;
+        }
+
+        int status = inflate(&z, Z_NO_FLUSH);
+        if (status == Z_STREAM_END) {
+            // gzip files may hold several members one after the other
+            while (stream.format == DeflateFormat::GZIP && z.avail_in == 0
+                   && !stream.source_end) {
+                if (stream.refill().failed())
+                    return IO_Error::IO_FAIL;
+            }
+            if (stream.format == DeflateFormat::GZIP && z.avail_in > 0) {
+                inflateReset(&z);
+            } else {
+                stream.stream_end = true;
+            }
+        } else if (status == Z_BUF_ERROR) {
+            // no progress possible: truncated if the source is done
+            if (stream.source_end)
+                return IO_Error::IO_FAIL;
+        } else if (status != Z_OK) {
+            return IO_Error::IO_FAIL;
+        }
+    }
+
+    size_t produced = wanted - z.avail_out;
+    if (produced == 0)
+        return EndOfFile {};
+    return IO_Success { produced };
+}
+
+namespace {
+
+// what one deflate stream allocates at the default memLevel of 8, rounded
+// up from zlib's (1 << (windowBits + 2)) + (1 << (memLevel + 9)) and the
+// pending buffer
+constexpr size_t DEFLATE_STATE_SIZE = 384_kb;
+
+// a dictionary longer than the window is of no use
+constexpr size_t DICTIONARY_SIZE = 32_kb;
+
+struct CompressedBlock {
+    ByteBuffer data;
+    uint32_t check;
+};
+
+int zlib_header_level(int level)
+{
+    if (level < 0)
+        return 2;
+    if (level < 2)
+        return 0;
+    if (level < 6)
+        return 1;
+    return level == 6 ? 2 : 3;
+}
+
+void put_be32(ByteBuffer& out, uint32_t v)
+{
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back((uint8_t)(v >> shift));
+    }
+}
+
+void put_le32(ByteBuffer& out, uint32_t v)
+{
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back((uint8_t)(v >> shift));
+    }
+}
+
+// Compresses blocks on one thread with one raw deflate stream, reset for
+// every block. All blocks but the last end with a sync flush, so that they
+// end on a byte boundary and can be concatenated.
+class BlockCompressor {
+public:
+    explicit BlockCompressor(int level)
+    {
+        ok_ = deflateInit2(&z_, level, Z_DEFLATED, -MAX_WBITS, 8,
+                           Z_DEFAULT_STRATEGY)
+              == Z_OK;
+    }
+
+    ~BlockCompressor() { deflateEnd(&z_); }
+
+    bool compress(const uint8_t* data,
+                  size_t begin,
+                  size_t end,
+                  bool last,
+                  CompressedBlock& block)
+    {
+        if (!ok_ || deflateReset(&z_) != Z_OK)
+            return false;
+
+        size_t dictionary = std::min(begin, DICTIONARY_SIZE);
+        if (dictionary > 0
+            && deflateSetDictionary(
+                   &z_, data + begin - dictionary, (uInt)dictionary)
+                   != Z_OK)
+            return false;
+
+        // the bound covers a final block, a sync flush adds a few bytes
+        size_t size = end - begin;
+        block.data.resize(deflateBound(&z_, (uLong)size) + 16);
+        z_.next_in = (Bytef*)(data + begin);
+        z_.avail_in = (uInt)size;
+        z_.next_out = block.data.data();
+        z_.avail_out = (uInt)block.data.size();
+
+        int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+        while (true) {
+            int status = deflate(&z_, flush);
+            if (status == Z_STREAM_ERROR)
+                return false;
+            if (status == Z_STREAM_END || (!last && z_.avail_out > 0))
+                break;
+            if (z_.avail_out == 0) {
+                size_t used = block.data.size();
+                block.data.resize(used * 2);
+                z_.next_out = block.data.data() + used;
+                z_.avail_out = (uInt)(block.data.size() - used);
+            }
+        }
+        block.data.resize(block.data.size() - z_.avail_out);
+        return true;
+    }
+
+private:
+    z_stream z_ = {};
+    bool ok_;
+};
+
+struct BufferSink : Write {
+    ByteBuffer& data;
+
+    explicit BufferSink(ByteBuffer& data) : data(data) { }
+
+    WriteResult write(const void* buffer, size_t bytes) override
+    {
+        auto* p = (const uint8_t*)buffer;
+        data.insert(data.end(), p, p + bytes);
+        return IO_Success { bytes };
+    }
+};
+
+} // namespace
+
+bool parallel_compress(const uint8_t* data,
+                       size_t len,
+                       Write& sink,
+                       const ParallelCompressOptions& options)
+{
+    DeflateFormat format = options.format;
+    int level = deflate_level(options.level);
+    size_t block_size
+        = std::clamp<size_t>(options.block_size, 1_kb, 1024 * 1024_kb);
+    size_t blocks = std::max<size_t>((len + block_size - 1) / block_size, 1);
+
+    // Blocks are done in batches that fit the memory limit together with
+    // one deflate stream per thread. A batch is written before the next.
+    size_t threads
+        = std::min(nx::detail::resolve_thread_count(options.threads), blocks);
+    size_t block_cost = compressBound((uLong)block_size) + 16;
+    size_t state_cost = threads * DEFLATE_STATE_SIZE;
+    size_t batch = options.memory_limit > state_cost
+                       ? (options.memory_limit - state_cost) / block_cost
+                       : 0;
+    batch = std::min(std::max<size_t>(batch, 1), blocks);
+    threads = std::min(threads, batch);
+
+    ByteBuffer header;
+    if (format == DeflateFormat::ZLIB) {
+        uint8_t cmf = 0x78;
+        uint8_t flg = (uint8_t)(zlib_header_level(level) << 6);
+        flg += (uint8_t)(31 - (cmf * 256 + flg) % 31);
+        header = { cmf, flg };
+    } else if (format == DeflateFormat::GZIP) {
+        uint8_t xfl = level == 9 ? 2 : level == 1 ? 4 : 0;
+        header = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, xfl, 255 };
+    }
+    if (!sink.write_all(header.data(), header.size()))
+        return false;
+
+    Vector<CompressedBlock> done(batch);
+    uint32_t check = format == DeflateFormat::GZIP ? 0 : 1;
+    for (size_t first = 0; first < blocks; first += batch) {
+        size_t count = std::min(batch, blocks - first);
+        std::atomic<size_t> next { 0 };
+        std::atomic<bool> failed { false };
+
+        nx::detail::parallel_for(threads, threads, [&](size_t) {
+            BlockCompressor compressor(level);
+            size_t i;
+            while ((i = next.fetch_add(1)) < count) {
+                size_t index = first + i;
+                size_t begin = index * block_size;
+                size_t end = std::min(begin + block_size, len);
+                bool last = index + 1 == blocks;
+                if (!compressor.compress(data, begin, end, last, done[i])) {
+                    failed = true;
+                    return;
+                }
+                done[i].check
+                    = format == DeflateFormat::GZIP
+                          ? nx::digest::crc32(data + begin, end - begin)
+                          : (uint32_t)adler32(
+                              1, data + begin, (uInt)(end - begin));
+            }
+        });
+        if (failed)
+            return false;
+
+        for (size_t i = 0; i < count; i++) {
+            size_t begin = (first + i) * block_size;
+            size_t size = std::min(begin + block_size, len) - begin;
+            if (format == DeflateFormat::GZIP) {
+                check = nx::digest::crc32_combine(check, done[i].check, size);
+            } else {
+                check = (uint32_t)adler32_combine(
+                    check, done[i].check, (z_off_t)size);
+            }
+            if (!sink.write_all(done[i].data.data(), done[i].data.size()))
+                return false;
+        }
+    }
+
+    ByteBuffer trailer;
+    if (format == DeflateFormat::ZLIB) {
+        put_be32(trailer, check);
+    } else if (format == DeflateFormat::GZIP) {
+        put_le32(trailer, check);
+        put_le32(trailer, (uint32_t)len);
+    }
+    return sink.write_all(trailer.data(), trailer.size());
+}
+
+ByteBuffer parallel_compress(const uint8_t* data,
+                             size_t len,
+                             const ParallelCompressOptions& options)
+{
+    ByteBuffer output;
+    output.reserve(len / 2 + 64);
+    BufferSink sink(output);
+    if (!parallel_compress(data, len, sink, options))
+        return {};
+    return output;
+}
+
 #else
+
+ByteBuffer zlib_compress(const uint8_t*, size_t, int)
+{
+    NX_PANIC("build without zlib");
     return {};
-#endif
 }
 
-ByteBuffer zlib_uncompress(const uint8_t* buf, size_t len)
+ByteBuffer zlib_uncompress(const uint8_t*, size_t, size_t)
 {
-    (void)buf;
-    (void)len;
-#if defined(USE_ZLIB)
     NX_PANIC("build without zlib");
     return {};
-#else
+}
+
+struct DeflateWriter::Stream { };
+
+DeflateWriter::DeflateWriter(Write&, int, DeflateFormat, size_t)
+{
+    NX_PANIC("build without zlib");
+}
+
+DeflateWriter::~DeflateWriter() { }
+
+WriteResult DeflateWriter::write(const void*, size_t)
+{
+    return IO_Error::IO_FAIL;
+}
+
+bool DeflateWriter::flush() { return false; }
+
+bool DeflateWriter::finish() { return false; }
+
+struct InflateReader::Stream { };
+
+InflateReader::InflateReader(Read&, DeflateFormat, size_t)
+{
+    NX_PANIC("build without zlib");
+}
+
+InflateReader::~InflateReader() { }
+
+ReadResult InflateReader::read(void*, size_t) { return IO_Error::IO_FAIL; }
+
+bool parallel_compress(const uint8_t*,
+                       size_t,
+                       Write&,
+                       const ParallelCompressOptions&)
+{
+    NX_PANIC("build without zlib");
+    return false;
+}
+
+ByteBuffer
+parallel_compress(const uint8_t*, size_t, const ParallelCompressOptions&)
+{
+    NX_PANIC("build without zlib");
     return {};
-#endif
 }
 
+#endif
+
 } // namespace nx
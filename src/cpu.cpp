@@ -0,0 +1,124 @@
+#include "cpu.h"
+
+#if defined(NX_ARCH_X86_64)
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
+namespace nx::cpu {
+
+#if defined(NX_ARCH_X86_64)
+
+static void cpuid(uint32_t leaf, uint32_t sub_leaf, uint32_t regs[4])
+{
+    #if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuidex(info, (int)leaf, (int)sub_leaf);
+    for (int i = 0; i < 4; i++) {
+        regs[i] = (uint32_t)info[i];
+    }
+    #else
+    __cpuid_count(leaf, sub_leaf, regs[0], regs[1], regs[2], regs[3]);
+    #endif
+}
+
+static uint64_t xgetbv()
+{
+    #if defined(_MSC_VER) && !defined(__clang__)
+    return _xgetbv(0);
+    #else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+    #endif
+}
+
+static Features detect_features()
+{
+    Features f {};
+    uint32_t regs[4];
+
+    cpuid(0, 0, regs);
+    uint32_t max_leaf = regs[0];
+    if (max_leaf < 1)
+        return f;
+
+    cpuid(1, 0, regs);
+    const uint32_t ecx1 = regs[2];
+    f.pclmul = NX_GET_BIT_BOOL(ecx1, 1);
+    f.ssse3 = NX_GET_BIT_BOOL(ecx1, 9);
+    f.sse41 = NX_GET_BIT_BOOL(ecx1, 19);
+    f.sse42 = NX_GET_BIT_BOOL(ecx1, 20);
+
+    // the OS must save the ymm registers on context switch
+    uint64_t xcr0 = NX_GET_BIT_BOOL(ecx1, 27) ? xgetbv() : 0;
+    bool os_avx = NX_GET_BIT_BOOL(ecx1, 28) && (xcr0 & 0x6) == 0x6;
+    // and the opmask and zmm registers for avx-512
+    bool os_avx512 = os_avx && (xcr0 & 0xE6) == 0xE6;
+
+    if (max_leaf >= 7) {
+        cpuid(7, 0, regs);
+        f.avx2 = os_avx && NX_GET_BIT_BOOL(regs[1], 5);
+        f.sha = NX_GET_BIT_BOOL(regs[1], 29);
+        f.avx512 = os_avx512 && NX_GET_BIT_BOOL(regs[1], 16);
+    }
+    return f;
+}
+
+#else
+
+static Features detect_features() { return Features {}; }
+
+#endif
+
+static void apply_disable_list(Features* f, const char* list)
+{
+    String item;
+    const char* p = list;
+    while (true) {
+        if (*p == ',' || *p == '\0') {
+            bool all = item == "all";
+            if (all || item == "sse4.1")
+                f->sse41 = false;
+            if (all || item == "sse4.2")
+                f->sse42 = false;
+            if (all || item == "pclmul")
+                f->pclmul = false;
+            if (all || item == "ssse3")
+                f->ssse3 = false;
+            if (all || item == "avx2")
+                f->avx2 = false;
+            if (all || item == "sha")
+                f->sha = false;
+            if (all || item == "avx512")
+                f->avx512 = false;
+            item.clear();
+            if (*p == '\0')
+                break;
+        } else if (*p != ' ') {
+            item.push_back(*p);
+        }
+        p++;
+    }
+}
+
+static Features init_features()
+{
+    Features f = detect_features();
+    const char* disabled = std::getenv("NX_CPU_DISABLE");
+    if (disabled) {
+        apply_disable_list(&f, disabled);
+    }
+    return f;
+}
+
+const Features& features()
+{
+    static const Features f = init_features();
+    return f;
+}
+
+} // namespace nx::cpu
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <nx/type.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define NX_ARCH_X86_64 1
+#endif
+
+// enable an instruction set for a single function, so that SIMD kernels can
+// live next to the portable code and be selected at runtime.
+#if defined(_MSC_VER) && !defined(__clang__)
+    #define NX_TARGET(features)
+#else
+    #define NX_TARGET(features) __attribute__((target(features)))
+#endif
+
+namespace nx::cpu {
+
+/**
+ * @brief      instruction set extensions usable by the current process
+ */
+struct Features {
+    bool sse41;
+    bool sse42;
+    bool pclmul;
+    bool ssse3;
+    bool avx2;
+    bool sha;
+    /**
+     * @brief  AVX-512 foundation instructions
+     */
+    bool avx512;
+};
+
+/**
+ * @brief      get cpu features, detected once on first use.
+ *
+ *             Features listed in the NX_CPU_DISABLE environment variable
+ *             (comma separated, e.g. "avx2,sha", or "all") are reported as
+ *             unavailable, which forces the portable code paths.
+ *
+ * @return     The features.
+ */
+const Features& features();
+
+} // namespace nx::cpu
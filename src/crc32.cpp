@@ -1,43 +1,150 @@
 #include <cstdint>
 #include <cstddef>
 #include <nx/digest.h>
+#include "crc32_impl.h"
+#include "parallel.h"
 
 namespace nx::digest {
 
-void __generate_table(uint32_t table[256])
-{
-    uint32_t polynomial = 0xEDB88320;
-    for (uint32_t i = 0; i < 256; i++) {
-        uint32_t c = i;
-        for (size_t j = 0; j < 8; j++) {
-            if (c & 1) {
-                c = polynomial ^ (c >> 1);
-            } else {
-                c >>= 1;
-            }
-        }
-        table[i] = c;
+namespace detail {
+
+static constexpr CRC32_Tables crc32_tables
+    = make_crc32_tables(CRC32_POLYNOMIAL);
+static constexpr CRC32_Tables crc32c_tables
+    = make_crc32_tables(CRC32C_POLYNOMIAL);
+
+static constexpr X2N_Table crc32_x2n_table = make_x2n_table(CRC32_POLYNOMIAL);
+
+static inline uint32_t load_u32_le(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16)
+           | ((uint32_t)p[3] << 24);
+}
+
+uint32_t crc32_slice16(const CRC32_Tables& tables,
+                       uint32_t c,
+                       const uint8_t* u,
+                       size_t len)
+{
+    const auto& t = tables.table;
+
+    while (len >= 16) {
+        uint32_t a = c ^ load_u32_le(u);
+        uint32_t b = load_u32_le(u + 4);
+        uint32_t d = load_u32_le(u + 8);
+        uint32_t e = load_u32_le(u + 12);
+        c = t[15][a & 0xFF] ^ t[14][(a >> 8) & 0xFF] ^ t[13][(a >> 16) & 0xFF]
+            ^ t[12][a >> 24] ^ t[11][b & 0xFF] ^ t[10][(b >> 8) & 0xFF]
+            ^ t[9][(b >> 16) & 0xFF] ^ t[8][b >> 24] ^ t[7][d & 0xFF]
+            ^ t[6][(d >> 8) & 0xFF] ^ t[5][(d >> 16) & 0xFF] ^ t[4][d >> 24]
+            ^ t[3][e & 0xFF] ^ t[2][(e >> 8) & 0xFF] ^ t[1][(e >> 16) & 0xFF]
+            ^ t[0][e >> 24];
+        u += 16;
+        len -= 16;
+    }
+
+    if (len >= 8) {
+        uint32_t a = c ^ load_u32_le(u);
+        uint32_t b = load_u32_le(u + 4);
+        c = t[7][a & 0xFF] ^ t[6][(a >> 8) & 0xFF] ^ t[5][(a >> 16) & 0xFF]
+            ^ t[4][a >> 24] ^ t[3][b & 0xFF] ^ t[2][(b >> 8) & 0xFF]
+            ^ t[1][(b >> 16) & 0xFF] ^ t[0][b >> 24];
+        u += 8;
+        len -= 8;
     }
+
+    while (len--) {
+        c = t[0][(c ^ *u++) & 0xFF] ^ (c >> 8);
+    }
+    return c;
+}
+
+uint32_t crc32_update(uint32_t initial, const void* buf, size_t len)
+{
+    uint32_t c = initial ^ 0xFFFFFFFF;
+    const uint8_t* u = static_cast<const uint8_t*>(buf);
+
+#if defined(NX_ARCH_X86_64)
+    if (len >= 64 && cpu::features().pclmul && cpu::features().sse41) {
+        size_t n = len & ~(size_t)15;
+        c = crc32_pclmul(c, u, n);
+        u += n;
+        len -= n;
+    }
+#endif
+
+    c = crc32_slice16(crc32_tables, c, u, len);
+    return c ^ 0xFFFFFFFF;
 }
 
-uint32_t
-__update(uint32_t table[256], uint32_t initial, const void* buf, size_t len)
+uint32_t crc32c_update(uint32_t initial, const void* buf, size_t len)
 {
     uint32_t c = initial ^ 0xFFFFFFFF;
     const uint8_t* u = static_cast<const uint8_t*>(buf);
-    for (size_t i = 0; i < len; ++i) {
-        c = table[(c ^ u[i]) & 0xFF] ^ (c >> 8);
+
+#if defined(NX_ARCH_X86_64)
+    if (cpu::features().sse42) {
+        return crc32c_sse42(c, u, len) ^ 0xFFFFFFFF;
     }
+#endif
+
+    c = crc32_slice16(crc32c_tables, c, u, len);
     return c ^ 0xFFFFFFFF;
 }
 
-CRC32::CRC32() : initial_(0) { __generate_table(table_); }
+} // namespace detail
+
+uint32_t crc32_combine(uint32_t crc_a, uint32_t crc_b, uint64_t len_b)
+{
+    const uint32_t polynomial = detail::CRC32_POLYNOMIAL;
+    const auto& x2n = detail::crc32_x2n_table;
+    uint32_t shift = detail::x8nmodp(x2n, len_b, polynomial);
+    return detail::multmodp(shift, crc_a, polynomial) ^ crc_b;
+}
+
+uint32_t parallel_crc32(const uint8_t* data, size_t len, size_t threads)
+{
+    // below this a chunk is not worth a thread
+    const size_t min_chunk = 1024_kb;
+
+    size_t chunks = std::min(nx::detail::resolve_thread_count(threads),
+                             std::max<size_t>(len / min_chunk, 1));
+    if (chunks == 1) {
+        return crc32(data, len);
+    }
+
+    size_t chunk_len = len / chunks;
+    Vector<uint32_t> values(chunks);
+    nx::detail::parallel_for(chunks, chunks, [&](size_t i) {
+        size_t begin = i * chunk_len;
+        size_t end = (i + 1 == chunks) ? len : begin + chunk_len;
+        values[i] = crc32(data + begin, end - begin);
+    });
+
+    uint32_t value = values[0];
+    for (size_t i = 1; i + 1 < chunks; i++) {
+        value = crc32_combine(value, values[i], chunk_len);
+    }
+    return crc32_combine(
+        value, values[chunks - 1], len - (chunks - 1) * chunk_len);
+}
+
+CRC32::CRC32() : initial_(0) { }
 
 void CRC32::update(const uint8_t* buf, size_t len)
 {
-    initial_ = __update(table_, initial_, (const void*)buf, len);
+    initial_ = detail::crc32_update(initial_, (const void*)buf, len);
 }
 
 uint32_t CRC32::get_value() const { return initial_; }
 
-} // namespace nx::digest
\ No newline at end of file
+CRC32C::CRC32C() : initial_(0) { }
+
+void CRC32C::update(const uint8_t* buf, size_t len)
+{
+    initial_ = detail::crc32c_update(initial_, (const void*)buf, len);
+}
+
+uint32_t CRC32C::get_value() const { return initial_; }
+
+} // namespace nx::digest
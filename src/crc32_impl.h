@@ -0,0 +1,153 @@
+#pragma once
+
+#include "cpu.h"
+
+namespace nx::digest::detail {
+
+// reflected polynomials
+constexpr uint32_t CRC32_POLYNOMIAL = 0xEDB88320;
+constexpr uint32_t CRC32C_POLYNOMIAL = 0x82F63B78;
+
+// table[k][i] is the crc of byte i followed by k zero bytes
+struct CRC32_Tables {
+    uint32_t table[16][256];
+};
+
+constexpr CRC32_Tables make_crc32_tables(uint32_t polynomial)
+{
+    CRC32_Tables t {};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (size_t j = 0; j < 8; j++) {
+            if (c & 1) {
+                c = polynomial ^ (c >> 1);
+            } else {
+                c >>= 1;
+            }
+        }
+        t.table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = t.table[0][i];
+        for (size_t k = 1; k < 16; k++) {
+            c = t.table[0][c & 0xFF] ^ (c >> 8);
+            t.table[k][i] = c;
+        }
+    }
+    return t;
+}
+
+// multiply a and b modulo the polynomial, both in reflected bit order.
+// a must not be zero.
+constexpr uint32_t multmodp(uint32_t a, uint32_t b, uint32_t polynomial)
+{
+    uint32_t m = (uint32_t)1 << 31;
+    uint32_t p = 0;
+    while (true) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ polynomial : b >> 1;
+    }
+    return p;
+}
+
+// table[k] is x^(2^k) mod P, 67 entries cover any 64 bit byte count
+struct X2N_Table {
+    uint32_t table[67];
+};
+
+constexpr X2N_Table make_x2n_table(uint32_t polynomial)
+{
+    X2N_Table t {};
+    uint32_t p = (uint32_t)1 << 30;
+    t.table[0] = p;
+    for (size_t k = 1; k < 67; k++) {
+        p = multmodp(p, p, polynomial);
+        t.table[k] = p;
+    }
+    return t;
+}
+
+// x^(8 * bytes) mod P, the operator that appends `bytes` zero bytes
+constexpr uint32_t
+x8nmodp(const X2N_Table& t, uint64_t bytes, uint32_t polynomial)
+{
+    uint32_t p = (uint32_t)1 << 31;
+    unsigned k = 3;
+    while (bytes) {
+        if (bytes & 1) {
+            p = multmodp(t.table[k], p, polynomial);
+        }
+        bytes >>= 1;
+        k++;
+    }
+    return p;
+}
+
+// appends a fixed number of zero bytes to a crc register with 4 lookups
+struct CRC32_ShiftTable {
+    uint32_t table[4][256];
+};
+
+constexpr CRC32_ShiftTable make_shift_table(uint32_t polynomial,
+                                            uint64_t bytes)
+{
+    CRC32_ShiftTable t {};
+    uint32_t op = x8nmodp(make_x2n_table(polynomial), bytes, polynomial);
+    for (uint32_t k = 0; k < 4; k++) {
+        for (uint32_t i = 0; i < 256; i++) {
+            t.table[k][i] = multmodp(op, i << (8 * k), polynomial);
+        }
+    }
+    return t;
+}
+
+inline uint32_t shift_crc(const CRC32_ShiftTable& t, uint32_t crc)
+{
+    return t.table[0][crc & 0xFF] ^ t.table[1][(crc >> 8) & 0xFF]
+           ^ t.table[2][(crc >> 16) & 0xFF] ^ t.table[3][crc >> 24];
+}
+
+/**
+ * @brief      update a finished crc32 value with more data, picking the
+ *             fastest kernel for the cpu.
+ */
+uint32_t crc32_update(uint32_t initial, const void* buf, size_t len);
+
+/**
+ * @brief      update a finished crc32c value with more data, picking the
+ *             fastest kernel for the cpu.
+ */
+uint32_t crc32c_update(uint32_t initial, const void* buf, size_t len);
+
+// All kernels work on the raw crc register, the caller does the pre and
+// post inversion.
+
+/**
+ * @brief      portable slicing-by-16 kernel
+ */
+uint32_t crc32_slice16(const CRC32_Tables& t,
+                       uint32_t crc,
+                       const uint8_t* buf,
+                       size_t len);
+
+#if defined(NX_ARCH_X86_64)
+/**
+ * @brief      carry-less multiplication folding kernel for crc32.
+ *
+ *             requires pclmulqdq and sse4.1, len >= 64 and len % 16 == 0.
+ */
+uint32_t crc32_pclmul(uint32_t crc, const uint8_t* buf, size_t len);
+
+/**
+ * @brief      crc32c with the sse4.2 crc32 instruction, three streams
+ *             interleaved to hide its latency.
+ */
+uint32_t crc32c_sse42(uint32_t crc, const uint8_t* buf, size_t len);
+#endif
+
+} // namespace nx::digest::detail
@@ -0,0 +1,185 @@
+#include "crc32_impl.h"
+
+#if defined(NX_ARCH_X86_64)
+
+    #include <immintrin.h>
+    #include <string.h>
+
+namespace nx::digest::detail {
+
+// Folding constants for the reflected polynomial 0xEDB88320, see Intel's
+// "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+//   k1 = x^(4*128+32) mod P, k2 = x^(4*128-32) mod P
+//   k3 = x^(128+32) mod P,   k4 = x^(128-32) mod P
+//   k5 = x^64 mod P
+//   mu = x^64 / P, P' = P
+NX_TARGET("pclmul,sse4.1")
+uint32_t crc32_pclmul(uint32_t crc, const uint8_t* buf, size_t len)
+{
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5k0 = _mm_set_epi64x(0x0000000000, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+    x1 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    buf += 64;
+    len -= 64;
+
+    // fold 4 x 128 bits in parallel
+    x0 = k1k2;
+    while (len >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+        y5 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+        y6 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+        y7 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+        y8 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+        buf += 64;
+        len -= 64;
+    }
+
+    // fold into 128 bits
+    x0 = k3k4;
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // single fold the remaining 16 byte blocks
+    while (len >= 16) {
+        x2 = _mm_loadu_si128((const __m128i*)buf);
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        buf += 16;
+        len -= 16;
+    }
+
+    // fold 128 bits to 64 bits
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+
+    x0 = k5k0;
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask32);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // barrett reduction to 32 bits
+    x0 = poly;
+    x2 = _mm_and_si128(x1, mask32);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, mask32);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+// lane sizes of the interleaved crc32c loop, and the operators that shift a
+// lane crc over the following lane
+static constexpr size_t CRC32C_LONG = 8192;
+static constexpr size_t CRC32C_SHORT = 256;
+
+static constexpr CRC32_ShiftTable crc32c_long_shift
+    = make_shift_table(CRC32C_POLYNOMIAL, CRC32C_LONG);
+static constexpr CRC32_ShiftTable crc32c_short_shift
+    = make_shift_table(CRC32C_POLYNOMIAL, CRC32C_SHORT);
+
+static inline uint64_t load_u64(const uint8_t* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// crc the three lanes buf[0, n), buf[n, 2n), buf[2n, 3n) independently so
+// that the three crc32 instructions overlap, then merge them.
+NX_TARGET("sse4.2")
+static inline uint64_t crc32c_3way(uint64_t crc0,
+                                   const uint8_t* buf,
+                                   size_t n,
+                                   const CRC32_ShiftTable& shift)
+{
+    uint64_t crc1 = 0;
+    uint64_t crc2 = 0;
+    const uint8_t* end = buf + n;
+    do {
+        crc0 = _mm_crc32_u64(crc0, load_u64(buf));
+        crc1 = _mm_crc32_u64(crc1, load_u64(buf + n));
+        crc2 = _mm_crc32_u64(crc2, load_u64(buf + 2 * n));
+        buf += 8;
+    } while (buf < end);
+
+    crc0 = shift_crc(shift, (uint32_t)crc0) ^ crc1;
+    crc0 = shift_crc(shift, (uint32_t)crc0) ^ crc2;
+    return crc0;
+}
+
+NX_TARGET("sse4.2")
+uint32_t crc32c_sse42(uint32_t crc, const uint8_t* buf, size_t len)
+{
+    uint64_t crc0 = crc;
+
+    while (len && ((uintptr_t)buf & 7)) {
+        crc0 = _mm_crc32_u8((uint32_t)crc0, *buf++);
+        len--;
+    }
+
+    while (len >= 3 * CRC32C_LONG) {
+        crc0 = crc32c_3way(crc0, buf, CRC32C_LONG, crc32c_long_shift);
+        buf += 3 * CRC32C_LONG;
+        len -= 3 * CRC32C_LONG;
+    }
+
+    while (len >= 3 * CRC32C_SHORT) {
+        crc0 = crc32c_3way(crc0, buf, CRC32C_SHORT, crc32c_short_shift);
+        buf += 3 * CRC32C_SHORT;
+        len -= 3 * CRC32C_SHORT;
+    }
+
+    while (len >= 8) {
+        crc0 = _mm_crc32_u64(crc0, load_u64(buf));
+        buf += 8;
+        len -= 8;
+    }
+
+    while (len) {
+        crc0 = _mm_crc32_u8((uint32_t)crc0, *buf++);
+        len--;
+    }
+    return (uint32_t)crc0;
+}
+
+} // namespace nx::digest::detail
+
+#endif
@@ -1,22 +1,11 @@
 #include <nx/digest.h>
+#include "crc32_impl.h"
 
 namespace nx::digest {
 
-void hex_encode(const uint8_t* digest, size_t len, char* output)
-{
-    static char trans[16] = { '0', '1', '2', '3', '4', '5', '6', '7',
-                              '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
-    for (size_t x = 0; x < len; x++) {
-        output[x * 2] = trans[digest[x] >> 4];
-        output[x * 2 + 1] = trans[digest[x] & 0x0F];
-    }
-}
-
 uint32_t crc32(const uint8_t* data, size_t len)
 {
-    CRC32 crc32_context;
-    crc32_context.update(data, len);
-    return crc32_context.get_value();
+    return detail::crc32_update(0, data, len);
 }
 
 uint32_t crc32(const char* data)
@@ -24,32 +13,128 @@ uint32_t crc32(const char* data)
     return crc32((const uint8_t*)data, strlen(data));
 }
 
-String md5(const uint8_t* data, size_t len)
+uint32_t crc32c(const uint8_t* data, size_t len)
+{
+    return detail::crc32c_update(0, data, len);
+}
+
+uint32_t crc32c(const char* data)
+{
+    return crc32c((const uint8_t*)data, strlen(data));
+}
+
+Md5Digest md5_digest(const uint8_t* data, size_t len)
 {
     MD5 md5_context;
     md5_context.update(data, len);
-    uint8_t digest[16];
-    md5_context.finish(digest);
-
-    String result;
-    result.resize(32);
-    hex_encode(digest, 16, result.data());
-    return result;
+    return md5_context.finish();
 }
 
-String md5(const char* data) { return md5((const uint8_t*)data, strlen(data)); }
+Md5Digest md5_digest(const char* data)
+{
+    return md5_digest((const uint8_t*)data, strlen(data));
+}
 
-String sha256(const uint8_t* data, size_t len)
+Sha256Digest sha256_digest(const uint8_t* data, size_t len)
 {
     SHA256 sha256_context;
     sha256_context.update(data, len);
-    uint8_t digest[32];
-    sha256_context.finish(digest);
+    return sha256_context.finish();
+}
+
+Sha256Digest sha256_digest(const char* data)
+{
+    return sha256_digest((const uint8_t*)data, strlen(data));
+}
+
+namespace {
+
+constexpr size_t HASH_STREAM_BUFFER = 1024 * 1024;
+
+template <class Hasher>
+bool hash_stream_impl(Read& reader, Hasher& hasher)
+{
+    // cache line aligned, so that the kernels' block loads never split
+    struct alignas(64) Chunk {
+        uint8_t bytes[64];
+    };
+    // a short stream gets a buffer of its size, at least one chunk
+    size_t size = std::min(reader.size_hint().value_or(HASH_STREAM_BUFFER),
+                           HASH_STREAM_BUFFER);
+    Vector<Chunk> buffer(std::max<size_t>(
+        (size + sizeof(Chunk) - 1) / sizeof(Chunk), 1));
+    auto* data = (uint8_t*)buffer.data();
+    size = buffer.size() * sizeof(Chunk);
+
+    while (true) {
+        auto result = reader.read(data, size);
+        if (!result.ok())
+            return result.eof();
+        hasher.update(data, result.bytes());
+    }
+}
+
+} // namespace
+
+bool hash_stream(Read& reader, MD5& hasher)
+{
+    return hash_stream_impl(reader, hasher);
+}
 
-    String result;
-    result.resize(64);
-    hex_encode(digest, 32, result.data());
-    return result;
+bool hash_stream(Read& reader, SHA256& hasher)
+{
+    return hash_stream_impl(reader, hasher);
+}
+
+bool hash_stream(Read& reader, BLAKE3& hasher)
+{
+    return hash_stream_impl(reader, hasher);
+}
+
+bool hash_stream(Read& reader, CRC32& hasher)
+{
+    return hash_stream_impl(reader, hasher);
+}
+
+bool hash_stream(Read& reader, CRC32C& hasher)
+{
+    return hash_stream_impl(reader, hasher);
+}
+
+Optional<Md5Digest> md5_digest(Read& reader)
+{
+    MD5 md5_context;
+    if (!hash_stream(reader, md5_context))
+        return {};
+    return md5_context.finish();
+}
+
+Optional<Sha256Digest> sha256_digest(Read& reader)
+{
+    SHA256 sha256_context;
+    if (!hash_stream(reader, sha256_context))
+        return {};
+    return sha256_context.finish();
+}
+
+Optional<Blake3Digest> blake3_digest(Read& reader)
+{
+    BLAKE3 blake3_context;
+    if (!hash_stream(reader, blake3_context))
+        return {};
+    return blake3_context.finish();
+}
+
+String md5(const uint8_t* data, size_t len)
+{
+    return md5_digest(data, len).to_hex();
+}
+
+String md5(const char* data) { return md5((const uint8_t*)data, strlen(data)); }
+
+String sha256(const uint8_t* data, size_t len)
+{
+    return sha256_digest(data, len).to_hex();
 }
 
 String sha256(const char* data)
@@ -57,4 +142,4 @@ String sha256(const char* data)
     return sha256((const uint8_t*)data, strlen(data));
 }
 
-} // namespace nx::digest
\ No newline at end of file
+} // namespace nx::digest
@@ -0,0 +1,309 @@
+#include <nx/digest.h>
+#include "md5_impl.h"
+#include "sha256_impl.h"
+#include "parallel.h"
+
+namespace nx::digest {
+
+namespace {
+
+struct MD5_Traits {
+    static constexpr size_t state_words = 4;
+    static constexpr size_t digest_size = 16;
+    static constexpr bool big_endian = false;
+    static constexpr uint32_t iv[4] = {
+        0x67452301,
+        0xEFCDAB89,
+        0x98BADCFE,
+        0x10325476,
+    };
+
+    static void compress(uint32_t* state, const uint8_t* blocks, size_t n)
+    {
+        detail::md5_compress(state, blocks, n);
+    }
+
+#if defined(NX_ARCH_X86_64)
+    static bool use_x8() { return cpu::features().avx2; }
+
+    static void compress_x8(uint32_t state[state_words][8],
+                            const uint8_t* const data[8],
+                            size_t n)
+    {
+        detail::md5_compress_x8_avx2(state, data, n);
+    }
+#endif
+};
+
+struct SHA256_Traits {
+    static constexpr size_t state_words = 8;
+    static constexpr size_t digest_size = 32;
+    static constexpr bool big_endian = true;
+    static constexpr uint32_t iv[8] = {
+        0x6a09e667,
+        0xbb67ae85,
+        0x3c6ef372,
+        0xa54ff53a,
+        0x510e527f,
+        0x9b05688c,
+        0x1f83d9ab,
+        0x5be0cd19,
+    };
+
+    static void compress(uint32_t* state, const uint8_t* blocks, size_t n)
+    {
+        detail::sha256_compress()(state, blocks, n);
+    }
+
+#if defined(NX_ARCH_X86_64)
+    // a single sha-ni stream is as fast as eight avx2 lanes
+    static bool use_x8()
+    {
+        return cpu::features().avx2 && !cpu::features().sha;
+    }
+
+    static void compress_x8(uint32_t state[state_words][8],
+                            const uint8_t* const data[8],
+                            size_t n)
+    {
+        detail::sha256_compress_x8_avx2(state, data, n);
+    }
+#endif
+};
+
+template <class T>
+static void store_uint(uint8_t* p, T v, bool big_endian)
+{
+    for (size_t i = 0; i < sizeof(T); i++) {
+        size_t shift = big_endian ? 8 * (sizeof(T) - 1 - i) : 8 * i;
+        p[i] = (uint8_t)(v >> shift);
+    }
+}
+
+// A message is hashed as its whole blocks, read in place, followed by one
+// or two padded tail blocks.
+struct Message {
+    const uint8_t* blocks;
+    size_t n_blocks;
+    uint8_t tail[128];
+    size_t n_tail_blocks;
+};
+
+template <class Traits>
+static void init_message(Message* m, const ByteSpan& input)
+{
+    size_t rem = input.size % 64;
+    m->blocks = input.data;
+    m->n_blocks = input.size / 64;
+    m->n_tail_blocks = rem + 9 <= 64 ? 1 : 2;
+
+    size_t tail_len = m->n_tail_blocks * 64;
+    if (rem) {
+        memcpy(m->tail, input.data + input.size - rem, rem);
+    }
+    m->tail[rem] = 0x80;
+    memset(m->tail + rem + 1, 0, tail_len - rem - 1);
+    store_uint(m->tail + tail_len - 8,
+               (uint64_t)input.size << 3,
+               Traits::big_endian);
+}
+
+template <class Traits>
+static void write_digest(const uint32_t* state, uint8_t* digest)
+{
+    for (size_t i = 0; i < Traits::state_words; i++) {
+        store_uint(digest + 4 * i, state[i], Traits::big_endian);
+    }
+}
+
+template <class Traits>
+static void hash_one(const ByteSpan& input, uint8_t* digest)
+{
+    Message m;
+    init_message<Traits>(&m, input);
+
+    uint32_t state[Traits::state_words];
+    memcpy(state, Traits::iv, sizeof(state));
+    if (m.n_blocks) {
+        Traits::compress(state, m.blocks, m.n_blocks);
+    }
+    Traits::compress(state, m.tail, m.n_tail_blocks);
+    write_digest<Traits>(state, digest);
+}
+
+#if defined(NX_ARCH_X86_64)
+
+// Keeps 8 messages in flight, one per simd lane. Every kernel call runs
+// all lanes for as many blocks as the shortest current segment has left,
+// and a lane that finishes its message picks up the next one.
+template <class Traits>
+static void hash_x8(const ByteSpan* inputs, size_t count, uint8_t* digests)
+{
+    struct Lane {
+        bool active;
+        size_t index;
+        Message message;
+        const uint8_t* ptr;
+        size_t remain;
+        bool in_tail;
+    };
+
+    Lane lanes[8];
+    uint32_t state[Traits::state_words][8];
+    size_t next = 0;
+
+    auto start_lane = [&](size_t l) {
+        Lane& lane = lanes[l];
+        lane.active = next < count;
+        if (!lane.active)
+            return;
+
+        lane.index = next++;
+        init_message<Traits>(&lane.message, inputs[lane.index]);
+        lane.in_tail = lane.message.n_blocks == 0;
+        lane.ptr = lane.in_tail ? lane.message.tail : lane.message.blocks;
+        lane.remain = lane.in_tail ? lane.message.n_tail_blocks
+                                   : lane.message.n_blocks;
+        for (size_t w = 0; w < Traits::state_words; w++) {
+            state[w][l] = Traits::iv[w];
+        }
+    };
+
+    auto finish_lane = [&](size_t l) {
+        uint32_t s[Traits::state_words];
+        for (size_t w = 0; w < Traits::state_words; w++) {
+            s[w] = state[w][l];
+        }
+        uint8_t* digest = digests + Traits::digest_size * lanes[l].index;
+        write_digest<Traits>(s, digest);
+    };
+
+    for (size_t l = 0; l < 8; l++) {
+        start_lane(l);
+    }
+
+    while (true) {
+        size_t active = 0;
+        size_t n = SIZE_MAX;
+        const uint8_t* any_ptr = nullptr;
+        for (auto& lane : lanes) {
+            if (lane.active) {
+                active++;
+                n = std::min(n, lane.remain);
+                any_ptr = lane.ptr;
+            }
+        }
+
+        if (active == 0)
+            break;
+
+        // with few lanes left the scalar code is faster
+        if (active <= 2 && next == count) {
+            for (size_t l = 0; l < 8; l++) {
+                Lane& lane = lanes[l];
+                if (!lane.active)
+                    continue;
+
+                uint32_t s[Traits::state_words];
+                for (size_t w = 0; w < Traits::state_words; w++) {
+                    s[w] = state[w][l];
+                }
+                Traits::compress(s, lane.ptr, lane.remain);
+                if (!lane.in_tail) {
+                    Traits::compress(
+                        s, lane.message.tail, lane.message.n_tail_blocks);
+                }
+                write_digest<Traits>(
+                    s, digests + Traits::digest_size * lane.index);
+            }
+            break;
+        }
+
+        // idle lanes hash a copy of an active lane, the result is dropped
+        const uint8_t* ptrs[8];
+        for (size_t l = 0; l < 8; l++) {
+            ptrs[l] = lanes[l].active ? lanes[l].ptr : any_ptr;
+        }
+        Traits::compress_x8(state, ptrs, n);
+
+        for (size_t l = 0; l < 8; l++) {
+            Lane& lane = lanes[l];
+            if (!lane.active)
+                continue;
+
+            lane.ptr += 64 * n;
+            lane.remain -= n;
+            if (lane.remain)
+                continue;
+
+            if (!lane.in_tail) {
+                lane.in_tail = true;
+                lane.ptr = lane.message.tail;
+                lane.remain = lane.message.n_tail_blocks;
+            } else {
+                finish_lane(l);
+                start_lane(l);
+            }
+        }
+    }
+}
+
+#endif
+
+template <class Traits>
+static void hash_range(const ByteSpan* inputs, size_t count, uint8_t* digests)
+{
+#if defined(NX_ARCH_X86_64)
+    if (count > 1 && Traits::use_x8()) {
+        hash_x8<Traits>(inputs, count, digests);
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < count; i++) {
+        hash_one<Traits>(inputs[i], digests + Traits::digest_size * i);
+    }
+}
+
+template <class Traits>
+static void hash_many(const ByteSpan* inputs,
+                      size_t count,
+                      uint8_t* digests,
+                      size_t threads)
+{
+    if (nx::detail::resolve_thread_count(threads) == 1) {
+        hash_range<Traits>(inputs, count, digests);
+        return;
+    }
+
+    // inputs are handed to the threads in batches
+    const size_t batch = 64;
+
+    size_t n_batches = (count + batch - 1) / batch;
+    nx::detail::parallel_for(n_batches, threads, [&](size_t i) {
+        size_t begin = i * batch;
+        size_t n = std::min(batch, count - begin);
+        hash_range<Traits>(
+            inputs + begin, n, digests + Traits::digest_size * begin);
+    });
+}
+
+} // namespace
+
+void md5_many(const ByteSpan* inputs,
+              size_t count,
+              uint8_t* digests,
+              size_t threads)
+{
+    hash_many<MD5_Traits>(inputs, count, digests, threads);
+}
+
+void sha256_many(const ByteSpan* inputs,
+                 size_t count,
+                 uint8_t* digests,
+                 size_t threads)
+{
+    hash_many<SHA256_Traits>(inputs, count, digests, threads);
+}
+
+} // namespace nx::digest
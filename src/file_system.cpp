@@ -7,6 +7,9 @@
 #endif
 
 #if NX_PLATFORM_WINDOW == NX_PLATFORM
+    #define NOMINMAX
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
     #include <process.h>
     #include <io.h>
     #include <direct.h>
@@ -15,9 +18,17 @@
     #define mkdir(a, b) _mkdir((a))
 #else
     #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
     #include <sys/stat.h>
+    #include <sys/uio.h>
 #endif
 
+#if defined(__linux__)
+    #include <sys/sendfile.h>
+#endif
+
+#include <cerrno>
 #include <sstream>
 #include <nx/log.h>
 
@@ -134,7 +145,13 @@ bool make_dirs(const String& path)
     return true;
 }
 
-File::File(const String& p) : path_(p), fp_(nullptr), strong_ref_(true) { }
+File::File(const String& p)
+: path_(p)
+, fp_(nullptr)
+, strong_ref_(true)
+, read_through_(false)
+{
+}
 
 File::~File() { close(); }
 
@@ -153,6 +170,7 @@ bool File::open(OpenMode m)
     }
 
     mode_ = m;
+    read_through_ = false;
     return true;
 }
 
@@ -173,6 +191,7 @@ File::File(const String& p, FILE* file, OpenMode m)
 , mode_(m)
 , fp_(file)
 , strong_ref_(false)
+, read_through_(false)
 {
 }
 
@@ -188,9 +207,393 @@ ReadResult File::read(void* buffer, size_t bytes)
     if (ferror(fp_))
         return IO_Error::IO_FAIL;
 
+    read_through_ = true;
     return IO_Success {  fread(buffer, 1, bytes, fp_) };
 }
 
+Optional<size_t> File::size_hint() const
+{
+    if (mode_ != OpenMode::READ)
+        return std::nullopt;
+
+    auto file_size = size();
+#if NX_PLATFORM_WINDOW == NX_PLATFORM
+    int64_t pos = _ftelli64(fp_);
+#else
+    int64_t pos = ftello(fp_);
+#endif
+    if (!file_size || pos < 0 || (uint64_t)pos > *file_size)
+        return std::nullopt;
+    return (size_t)(*file_size - pos);
+}
+
+Optional<uint64_t> File::size() const
+{
+    if (!mode_)
+        return std::nullopt;
+    if (mode_ == OpenMode::WRITE) {
+        fflush(fp_);
+    }
+
+#if NX_PLATFORM_WINDOW == NX_PLATFORM
+    struct _stat64 info;
+    if (_fstat64(_fileno(fp_), &info) != 0 || !(info.st_mode & _S_IFREG))
+        return std::nullopt;
+#else
+    struct stat info;
+    if (fstat(fileno(fp_), &info) != 0 || !S_ISREG(info.st_mode))
+        return std::nullopt;
+#endif
+    return (uint64_t)info.st_size;
+}
+
+#if defined(__linux__)
+
+enum class KernelCopy {
+    COPY_FILE_RANGE,
+    SENDFILE,
+    SPLICE,
+};
+
+#endif
+
+Optional<bool> File::copy_to(Write& sink)
+{
+#if defined(__linux__)
+    auto* out = dynamic_cast<File*>(&sink);
+    if (mode_ != OpenMode::READ || !out || out->mode_ != OpenMode::WRITE)
+        return std::nullopt;
+
+    int in_fd = fileno(fp_);
+    int out_fd = fileno(out->fp_);
+    struct stat in_info, out_info;
+    if (fstat(in_fd, &in_info) != 0 || fstat(out_fd, &out_info) != 0)
+        return std::nullopt;
+
+    // A file is copied from the stream position with an explicit offset. A
+    // pipe has no position, stdio may have read ahead of what the caller has
+    // seen, so the kernel only copies pipes never read through the stream.
+    bool in_file = S_ISREG(in_info.st_mode);
+    bool out_file = S_ISREG(out_info.st_mode);
+    off_t in_pos = 0;
+    KernelCopy method = KernelCopy::SPLICE;
+    if (in_file) {
+        in_pos = ftello(fp_);
+        if (in_pos < 0)
+            return std::nullopt;
+        method = out_file ? KernelCopy::COPY_FILE_RANGE : KernelCopy::SENDFILE;
+    } else if (!S_ISFIFO(in_info.st_mode) || read_through_) {
+        return std::nullopt;
+    }
+
+    if (fflush(out->fp_) != 0)
+        return false;
+
+    constexpr size_t CHUNK = 1 << 30;
+    uint64_t moved = 0;
+    bool ok = true;
+    while (true) {
+        ssize_t n = 0;
+        switch (method) {
+            case KernelCopy::COPY_FILE_RANGE:
+                n = copy_file_range(in_fd, &in_pos, out_fd, nullptr, CHUNK, 0);
+                break;
+            case KernelCopy::SENDFILE:
+                n = sendfile(out_fd, in_fd, &in_pos, CHUNK);
+                break;
+            case KernelCopy::SPLICE:
+                n = splice(
+                    in_fd, nullptr, out_fd, nullptr, CHUNK, SPLICE_F_MOVE);
+                break;
+        }
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            // the kernel refuses many pairs (across file systems before
+            // Linux 5.19, O_APPEND outputs, some special files). Before
+            // anything moved, the buffered copy takes over whatever the
+            // reason.
+            if (moved == 0) {
+                if (method == KernelCopy::COPY_FILE_RANGE) {
+                    method = KernelCopy::SENDFILE;
+                    continue;
+                }
+                return std::nullopt;
+            }
+            ok = false;
+            break;
+        }
+        if (n == 0)
+            break;
+        moved += (uint64_t)n;
+    }
+
+    // the kernel moved the descriptors, the streams follow
+    if (in_file && fseeko(fp_, in_pos, SEEK_SET) != 0) {
+        ok = false;
+    }
+    if (out_file) {
+        off_t out_pos = lseek(out_fd, 0, SEEK_CUR);
+        if (out_pos < 0 || fseeko(out->fp_, out_pos, SEEK_SET) != 0) {
+            ok = false;
+        }
+    }
+    return ok;
+#else
+    (void)sink;
+    return std::nullopt;
+#endif
+}
+
+#if NX_PLATFORM_WINDOW == NX_PLATFORM
+
+// ReadFile and WriteFile at an OVERLAPPED offset still move the file
+// pointer of a handle opened for synchronous io, which the stream reads and
+// writes from next. The guard puts it back.
+class FilePointerGuard {
+public:
+    explicit FilePointerGuard(HANDLE handle)
+    : handle_(handle)
+    , saved_(SetFilePointerEx(handle, {}, &pos_, FILE_CURRENT) != 0)
+    {
+    }
+
+    ~FilePointerGuard()
+    {
+        if (saved_) {
+            SetFilePointerEx(handle_, pos_, nullptr, FILE_BEGIN);
+        }
+    }
+
+private:
+    HANDLE handle_;
+    LARGE_INTEGER pos_ = {};
+    bool saved_;
+};
+
+#endif
+
+// Positional io on the descriptor under a stdio stream, which leaves the
+// stream's position alone. Both calls are retried until all bytes are
+// moved, the end of the file or an error, and return the bytes moved or -1
+// on error.
+static int64_t pread_full(FILE* fp, uint64_t offset, void* buffer, size_t bytes)
+{
+    auto* p = (uint8_t*)buffer;
+    size_t done = 0;
+#if NX_PLATFORM_WINDOW == NX_PLATFORM
+    HANDLE handle = (HANDLE)_get_osfhandle(_fileno(fp));
+    FilePointerGuard guard(handle);
+#endif
+    while (done < bytes) {
+#if NX_PLATFORM_WINDOW == NX_PLATFORM
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = (DWORD)(offset + done);
+        overlapped.OffsetHigh = (DWORD)((offset + done) >> 32);
+        DWORD n = 0;
+        DWORD chunk = (DWORD)std::min<size_t>(bytes - done, 1 << 30);
+        if (!ReadFile(handle, p + done, chunk, &n, &overlapped)) {
+            if (GetLastError() == ERROR_HANDLE_EOF)
+                break;
+            return -1;
+        }
+#else
+        ssize_t n = pread(
+            fileno(fp), p + done, bytes - done, (off_t)(offset + done));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+#endif
+        if (n == 0)
+            break;
+        done += (size_t)n;
+    }
+    return (int64_t)done;
+}
+
+static int64_t
+pwrite_full(FILE* fp, uint64_t offset, const void* buffer, size_t bytes)
+{
+    auto* p = (const uint8_t*)buffer;
+    size_t done = 0;
+#if NX_PLATFORM_WINDOW == NX_PLATFORM
+    HANDLE handle = (HANDLE)_get_osfhandle(_fileno(fp));
+    FilePointerGuard guard(handle);
+#endif
+    while (done < bytes) {
+#if NX_PLATFORM_WINDOW == NX_PLATFORM
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = (DWORD)(offset + done);
+        overlapped.OffsetHigh = (DWORD)((offset + done) >> 32);
+        DWORD n = 0;
+        DWORD chunk = (DWORD)std::min<size_t>(bytes - done, 1 << 30);
+        if (!WriteFile(handle, p + done, chunk, &n, &overlapped))
+            return -1;
+#else
+        ssize_t n = pwrite(
+            fileno(fp), p + done, bytes - done, (off_t)(offset + done));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+#endif
+        if (n == 0)
+            return -1;
+        done += (size_t)n;
+    }
+    return (int64_t)done;
+}
+
+#if defined(__linux__)
+
+// Moves the data of a list of buffers with preadv or pwritev, up to
+// IOV_BATCH buffers per call, resuming inside a buffer after a short
+// transfer. Returns the bytes moved or -1 on error.
+template <class Span, class Call>
+static int64_t
+vectored_io(uint64_t offset, const Span* buffers, size_t count, Call call)
+{
+    constexpr size_t IOV_BATCH = 64;
+
+    uint64_t done = 0;
+    size_t index = 0;
+    size_t skip = 0;
+    while (index < count) {
+        struct iovec iov[IOV_BATCH];
+        size_t n = 0;
+        for (size_t i = index; i < count && n < IOV_BATCH; i++, n++) {
+            size_t used = i == index ? skip : 0;
+            iov[n].iov_base = (void*)(buffers[i].data + used);
+            iov[n].iov_len = buffers[i].size - used;
+        }
+
+        ssize_t moved = call(iov, (int)n, (off_t)(offset + done));
+        if (moved < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+
+        size_t left = (size_t)moved;
+        done += left;
+        while (index < count && left >= buffers[index].size - skip) {
+            left -= buffers[index].size - skip;
+            skip = 0;
+            index++;
+        }
+        skip += left;
+
+        // the end of the file, with buffers left to fill
+        if (moved == 0 && index < count)
+            break;
+    }
+    return (int64_t)done;
+}
+
+#endif
+
+ReadResult File::read_at(uint64_t offset, void* buffer, size_t bytes)
+{
+    if (mode_ != OpenMode::READ) {
+        return IO_Error::NOT_OPEN;
+    }
+
+    int64_t n = pread_full(fp_, offset, buffer, bytes);
+    if (n < 0)
+        return IO_Error::IO_FAIL;
+    if (n == 0 && bytes > 0)
+        return EndOfFile {};
+    return IO_Success { (size_t)n };
+}
+
+WriteResult File::write_at(uint64_t offset, const void* buffer, size_t bytes)
+{
+    if (mode_ != OpenMode::WRITE) {
+        return IO_Error::NOT_OPEN;
+    }
+
+    // earlier sequential writes must reach the file first
+    if (fflush(fp_) != 0)
+        return IO_Error::IO_FAIL;
+
+    int64_t n = pwrite_full(fp_, offset, buffer, bytes);
+    if (n < 0)
+        return IO_Error::IO_FAIL;
+    return IO_Success { (size_t)n };
+}
+
+ReadResult
+File::readv(uint64_t offset, const MutableByteSpan* buffers, size_t count)
+{
+    if (mode_ != OpenMode::READ) {
+        return IO_Error::NOT_OPEN;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += buffers[i].size;
+    }
+
+#if defined(__linux__)
+    int fd = fileno(fp_);
+    int64_t n = vectored_io(
+        offset, buffers, count, [fd](const iovec* iov, int n, off_t pos) {
+            return preadv(fd, iov, n, pos);
+        });
+#else
+    int64_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        int64_t r
+            = pread_full(fp_, offset + n, buffers[i].data, buffers[i].size);
+        if (r < 0)
+            return IO_Error::IO_FAIL;
+        n += r;
+        if ((size_t)r < buffers[i].size)
+            break;
+    }
+#endif
+    if (n < 0)
+        return IO_Error::IO_FAIL;
+    if (n == 0 && total > 0)
+        return EndOfFile {};
+    return IO_Success { (size_t)n };
+}
+
+WriteResult
+File::writev(uint64_t offset, const ByteSpan* buffers, size_t count)
+{
+    if (mode_ != OpenMode::WRITE) {
+        return IO_Error::NOT_OPEN;
+    }
+
+    if (fflush(fp_) != 0)
+        return IO_Error::IO_FAIL;
+
+#if defined(__linux__)
+    int fd = fileno(fp_);
+    int64_t n = vectored_io(
+        offset, buffers, count, [fd](const iovec* iov, int n, off_t pos) {
+            return pwritev(fd, iov, n, pos);
+        });
+#else
+    int64_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        int64_t r
+            = pwrite_full(fp_, offset + n, buffers[i].data, buffers[i].size);
+        if (r < 0)
+            return IO_Error::IO_FAIL;
+        n += r;
+    }
+#endif
+    if (n < 0)
+        return IO_Error::IO_FAIL;
+    return IO_Success { (size_t)n };
+}
+
 WriteResult File::write(const void* buffer, size_t bytes)
 {
     if (mode_ != OpenMode::WRITE) {
@@ -258,6 +661,162 @@ ReadAllResult read_file(const String& path)
     return file.read_all();
 }
 
+bool copy_file(const String& from, const String& to)
+{
+    File source(from);
+    File sink(to);
+    if (!source.open_read() || !sink.open_write())
+        return false;
+
+    return pipe(source, sink);
+}
+
+MappedFile::MappedFile(const String& path)
+: path_(path)
+, data_(nullptr)
+, size_(0)
+, read_pos_(0)
+, open_(false)
+{
+}
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::open()
+{
+    if (open_) {
+        NX_LOG_WARNING("map fail: %s, reason: busy\n", path_.c_str());
+        return false;
+    }
+
+#if NX_PLATFORM_WINDOW == NX_PLATFORM
+    auto result = read_file(path_);
+    auto* bytes = std::get_if<ByteBuffer>(&result);
+    if (!bytes)
+        return false;
+    fallback_ = std::move(*bytes);
+    data_ = fallback_.data();
+    size_ = fallback_.size();
+#else
+    int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        NX_LOG_WARNING("map fail: %s, reason: %s\n",
+                       path_.c_str(),
+                       strerror(errno));
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        NX_LOG_WARNING("map fail: %s, reason: not a regular file\n",
+                       path_.c_str());
+        ::close(fd);
+        return false;
+    }
+
+    // an empty file can not be mapped, it is an empty span
+    size_ = (size_t)info.st_size;
+    if (size_ > 0) {
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            NX_LOG_WARNING("map fail: %s, reason: %s\n",
+                           path_.c_str(),
+                           strerror(errno));
+            ::close(fd);
+            size_ = 0;
+            return false;
+        }
+        data_ = (const uint8_t*)p;
+    }
+    // the mapping stays valid without the descriptor
+    ::close(fd);
+#endif
+
+    read_pos_ = 0;
+    open_ = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+#if NX_PLATFORM_WINDOW == NX_PLATFORM
+    fallback_ = ByteBuffer();
+#else
+    if (data_) {
+        munmap((void*)data_, size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    read_pos_ = 0;
+    open_ = false;
+}
+
+bool MappedFile::advise(MapAdvice advice, size_t offset, size_t len)
+{
+    if (!open_ || offset > size_)
+        return false;
+    len = std::min(len, size_ - offset);
+    if (len == 0)
+        return true;
+
+#if NX_PLATFORM_WINDOW == NX_PLATFORM
+    (void)advice;
+    return true;
+#else
+    int native = MADV_NORMAL;
+    switch (advice) {
+        case MapAdvice::NORMAL:
+            native = MADV_NORMAL;
+            break;
+        case MapAdvice::SEQUENTIAL:
+            native = MADV_SEQUENTIAL;
+            break;
+        case MapAdvice::RANDOM:
+            native = MADV_RANDOM;
+            break;
+        case MapAdvice::WILL_NEED:
+            native = MADV_WILLNEED;
+            break;
+    }
+
+    // madvise wants a page aligned start
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t begin = offset / page * page;
+    return madvise((void*)(data_ + begin), offset + len - begin, native) == 0;
+#endif
+}
+
+ReadResult MappedFile::read(void* buffer, size_t bytes)
+{
+    if (!open_) {
+        return IO_Error::NOT_OPEN;
+    }
+
+    if (read_pos_ == size_)
+        return EndOfFile {};
+
+    size_t n = std::min(bytes, size_ - read_pos_);
+    memcpy(buffer, data_ + read_pos_, n);
+    read_pos_ += n;
+    return IO_Success { n };
+}
+
+Optional<size_t> MappedFile::size_hint() const
+{
+    if (!open_)
+        return std::nullopt;
+    return size_ - read_pos_;
+}
+
+UniquePtr<MappedFile> map_file(const String& path)
+{
+    auto file = std::make_unique<MappedFile>(path);
+    if (!file->open())
+        return nullptr;
+    return file;
+}
+
 Vector<String> list_dir(const String& path)
 {
     Vector<String> result;
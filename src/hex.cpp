@@ -0,0 +1,125 @@
+#include <nx/hex.h>
+#include "hex_impl.h"
+
+namespace nx {
+
+namespace {
+
+constexpr uint8_t HEX_INVALID = 0xFF;
+
+struct HexDecodeTable {
+    uint8_t table[256];
+};
+
+constexpr HexDecodeTable make_hex_decode_table()
+{
+    HexDecodeTable t {};
+    for (int c = 0; c < 256; c++) {
+        if (c >= '0' && c <= '9') {
+            t.table[c] = (uint8_t)(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            t.table[c] = (uint8_t)(c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            t.table[c] = (uint8_t)(c - 'A' + 10);
+        } else {
+            t.table[c] = HEX_INVALID;
+        }
+    }
+    return t;
+}
+
+constexpr HexDecodeTable hex_decode_table = make_hex_decode_table();
+
+void hex_encode_generic(const uint8_t* data, size_t len, char* output)
+{
+    static const char trans[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        output[2 * i] = trans[data[i] >> 4];
+        output[2 * i + 1] = trans[data[i] & 0x0F];
+    }
+}
+
+// returns the offset of the first invalid character, or len
+size_t hex_decode_generic(const char* hex, size_t len, uint8_t* output)
+{
+    const uint8_t* table = hex_decode_table.table;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        uint8_t hi = table[(uint8_t)hex[i]];
+        uint8_t lo = table[(uint8_t)hex[i + 1]];
+        if ((hi | lo) & 0xF0) {
+            return hi == HEX_INVALID ? i : i + 1;
+        }
+        output[i / 2] = (uint8_t)(hi << 4 | lo);
+    }
+    return len;
+}
+
+} // namespace
+
+void hex_encode(const uint8_t* data, size_t len, char* output)
+{
+    size_t done = 0;
+#if defined(NX_ARCH_X86_64)
+    // avx2 takes 32 byte blocks, a trailing 16 byte block goes to ssse3
+    if (cpu::features().avx2) {
+        done = detail::hex_encode_avx2(data, len, output);
+    }
+    if (cpu::features().ssse3) {
+        done += detail::hex_encode_ssse3(
+            data + done, len - done, output + 2 * done);
+    }
+#endif
+    hex_encode_generic(data + done, len - done, output + 2 * done);
+}
+
+String hex_encode(const uint8_t* data, size_t len)
+{
+    String result(2 * len, '\0');
+    hex_encode(data, len, result.data());
+    return result;
+}
+
+String hex_encode(const ByteBuffer& data)
+{
+    return hex_encode(data.data(), data.size());
+}
+
+bool hex_decode(const char* hex, size_t len, uint8_t* output, size_t* error_pos)
+{
+    size_t done = 0;
+#if defined(NX_ARCH_X86_64)
+    if (cpu::features().avx2) {
+        done = detail::hex_decode_avx2(hex, len, output);
+    }
+    if (cpu::features().ssse3) {
+        done += detail::hex_decode_ssse3(
+            hex + done, len - done, output + done / 2);
+    }
+#endif
+    size_t pos = done
+                 + hex_decode_generic(hex + done, len - done, output + done / 2);
+    if (pos == len && len % 2 == 0)
+        return true;
+
+    if (error_pos) {
+        *error_pos = pos;
+    }
+    return false;
+}
+
+HexDecodeResult hex_decode(const char* hex, size_t len)
+{
+    ByteBuffer output(len / 2);
+    size_t error_pos;
+    if (!hex_decode(hex, len, output.data(), &error_pos)) {
+        return HexError { error_pos };
+    }
+    return output;
+}
+
+HexDecodeResult hex_decode(const String& hex)
+{
+    return hex_decode(hex.data(), hex.size());
+}
+
+} // namespace nx
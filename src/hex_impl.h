@@ -0,0 +1,28 @@
+#pragma once
+
+#include "cpu.h"
+
+namespace nx::detail {
+
+#if defined(NX_ARCH_X86_64)
+/**
+ * @brief      encode the leading whole 16 or 32 byte blocks of data.
+ *
+ * @return     The number of bytes encoded, the caller encodes the rest.
+ */
+size_t hex_encode_ssse3(const uint8_t* data, size_t len, char* output);
+size_t hex_encode_avx2(const uint8_t* data, size_t len, char* output);
+
+/**
+ * @brief      decode the leading whole 32 or 64 character blocks of hex,
+ *             stopping before the first block that holds an invalid
+ *             character.
+ *
+ * @return     The number of characters decoded, the caller decodes the rest
+ *             and locates the error.
+ */
+size_t hex_decode_ssse3(const char* hex, size_t len, uint8_t* output);
+size_t hex_decode_avx2(const char* hex, size_t len, uint8_t* output);
+#endif
+
+} // namespace nx::detail
@@ -0,0 +1,146 @@
+#include "hex_impl.h"
+
+#if defined(NX_ARCH_X86_64)
+
+    #include <immintrin.h>
+
+namespace nx::detail {
+
+// Encoding splits every byte into its two nibbles and maps each nibble to
+// its digit with a pshufb table lookup, then interleaves high and low
+// digits.
+NX_TARGET("ssse3")
+size_t hex_encode_ssse3(const uint8_t* data, size_t len, char* output)
+{
+    const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6',
+                                         '7', '8', '9', 'a', 'b', 'c', 'd',
+                                         'e', 'f');
+    const __m128i low_mask = _mm_set1_epi8(0x0F);
+
+    size_t done = 0;
+    for (; done + 16 <= len; done += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(data + done));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), low_mask);
+        __m128i lo = _mm_and_si128(x, low_mask);
+        hi = _mm_shuffle_epi8(digits, hi);
+        lo = _mm_shuffle_epi8(digits, lo);
+
+        char* out = output + 2 * done;
+        _mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(out + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return done;
+}
+
+NX_TARGET("avx2")
+size_t hex_encode_avx2(const uint8_t* data, size_t len, char* output)
+{
+    const __m256i digits = _mm256_setr_epi8(
+        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd',
+        'e', 'f', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b',
+        'c', 'd', 'e', 'f');
+    const __m256i low_mask = _mm256_set1_epi8(0x0F);
+
+    size_t done = 0;
+    for (; done + 32 <= len; done += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(data + done));
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), low_mask);
+        __m256i lo = _mm256_and_si256(x, low_mask);
+        hi = _mm256_shuffle_epi8(digits, hi);
+        lo = _mm256_shuffle_epi8(digits, lo);
+
+        // the unpacks work within 128 bit lanes, so a holds the digits of
+        // bytes 0-7 and 16-23, b those of bytes 8-15 and 24-31
+        __m256i a = _mm256_unpacklo_epi8(hi, lo);
+        __m256i b = _mm256_unpackhi_epi8(hi, lo);
+
+        char* out = output + 2 * done;
+        _mm256_storeu_si256((__m256i*)out,
+                            _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i*)(out + 32),
+                            _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    return done;
+}
+
+// Decoding maps every character to its nibble value and checks it at the
+// same time: c - '0' must be below 10, or (c | 0x20) - 'a' below 6. Pairs
+// of nibbles are then merged with pmaddubsw, hi * 16 + lo.
+NX_TARGET("ssse3")
+static inline __m128i decode_nibbles_ssse3(__m128i c, __m128i* valid)
+{
+    __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i l = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)),
+                             _mm_set1_epi8('a'));
+    __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+    __m128i is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(l, _mm_set1_epi8(5)), l);
+    l = _mm_add_epi8(l, _mm_set1_epi8(10));
+
+    *valid = _mm_and_si128(*valid, _mm_or_si128(is_digit, is_alpha));
+    return _mm_maddubs_epi16(
+        _mm_or_si128(_mm_and_si128(d, is_digit), _mm_and_si128(l, is_alpha)),
+        _mm_set1_epi16(0x0110));
+}
+
+NX_TARGET("ssse3")
+size_t hex_decode_ssse3(const char* hex, size_t len, uint8_t* output)
+{
+    size_t done = 0;
+    for (; done + 32 <= len; done += 32) {
+        __m128i valid = _mm_set1_epi8(-1);
+        __m128i c0 = _mm_loadu_si128((const __m128i*)(hex + done));
+        __m128i c1 = _mm_loadu_si128((const __m128i*)(hex + done + 16));
+        __m128i v0 = decode_nibbles_ssse3(c0, &valid);
+        __m128i v1 = decode_nibbles_ssse3(c1, &valid);
+        if (_mm_movemask_epi8(valid) != 0xFFFF)
+            break;
+
+        _mm_storeu_si128((__m128i*)(output + done / 2),
+                         _mm_packus_epi16(v0, v1));
+    }
+    return done;
+}
+
+NX_TARGET("avx2")
+static inline __m256i decode_nibbles_avx2(__m256i c, __m256i* valid)
+{
+    __m256i d = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    __m256i l = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)),
+                                _mm256_set1_epi8('a'));
+    __m256i is_digit
+        = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+    __m256i is_alpha
+        = _mm256_cmpeq_epi8(_mm256_min_epu8(l, _mm256_set1_epi8(5)), l);
+    l = _mm256_add_epi8(l, _mm256_set1_epi8(10));
+
+    *valid = _mm256_and_si256(*valid, _mm256_or_si256(is_digit, is_alpha));
+    return _mm256_maddubs_epi16(
+        _mm256_or_si256(_mm256_and_si256(d, is_digit),
+                        _mm256_and_si256(l, is_alpha)),
+        _mm256_set1_epi16(0x0110));
+}
+
+NX_TARGET("avx2")
+size_t hex_decode_avx2(const char* hex, size_t len, uint8_t* output)
+{
+    size_t done = 0;
+    for (; done + 64 <= len; done += 64) {
+        __m256i valid = _mm256_set1_epi8(-1);
+        __m256i c0 = _mm256_loadu_si256((const __m256i*)(hex + done));
+        __m256i c1 = _mm256_loadu_si256((const __m256i*)(hex + done + 32));
+        __m256i v0 = decode_nibbles_avx2(c0, &valid);
+        __m256i v1 = decode_nibbles_avx2(c1, &valid);
+        if (_mm256_movemask_epi8(valid) != -1)
+            break;
+
+        // packus works within 128 bit lanes, put the quarters back in order
+        __m256i packed = _mm256_packus_epi16(v0, v1);
+        _mm256_storeu_si256((__m256i*)(output + done / 2),
+                            _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    return done;
+}
+
+} // namespace nx::detail
+
+#endif
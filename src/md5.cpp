@@ -13,6 +13,7 @@
 
 #include <string.h>
 #include <nx/digest.h>
+#include "md5_impl.h"
 
 #define GET_UINT32(n, b, i)                                                    \
     {                                                                          \
@@ -32,15 +33,14 @@ namespace nx::digest {
 
 void MD5::md5_starts(MD5_Context* ctx)
 {
-    ctx->total[0] = 0;
-    ctx->total[1] = 0;
+    ctx->total = 0;
     ctx->state[0] = 0x67452301;
     ctx->state[1] = 0xEFCDAB89;
     ctx->state[2] = 0x98BADCFE;
     ctx->state[3] = 0x10325476;
 }
 
-void MD5::md5_process(MD5_Context* ctx, const uint8_t data[64])
+static void md5_block(uint32_t state[4], const uint8_t data[64])
 {
     uint32_t A, B, C, D, X[16];
 
@@ -69,10 +69,10 @@ void MD5::md5_process(MD5_Context* ctx, const uint8_t data[64])
         a = S(a, s) + b;                                                       \
     }
 
-    A = ctx->state[0];
-    B = ctx->state[1];
-    C = ctx->state[2];
-    D = ctx->state[3];
+    A = state[0];
+    B = state[1];
+    C = state[2];
+    D = state[3];
 
 #define F(x, y, z) (z ^ (x & (y ^ z)))
 
@@ -158,44 +158,51 @@ void MD5::md5_process(MD5_Context* ctx, const uint8_t data[64])
 
 #undef F
 
-    ctx->state[0] += A;
-    ctx->state[1] += B;
-    ctx->state[2] += C;
-    ctx->state[3] += D;
+    state[0] += A;
+    state[1] += B;
+    state[2] += C;
+    state[3] += D;
 }
 
-void MD5::md5_update(MD5_Context* ctx, const uint8_t* input, uint32_t length)
+namespace detail {
+
+void md5_compress(uint32_t state[4], const uint8_t* blocks, size_t n_blocks)
 {
-    uint32_t left, fill;
+    while (n_blocks--) {
+        md5_block(state, blocks);
+        blocks += 64;
+    }
+}
 
+} // namespace detail
+
+void MD5::md5_update(MD5_Context* ctx, const uint8_t* input, size_t length)
+{
     if (!length)
         return;
 
-    left = (ctx->total[0] >> 3) & 0x3F;
-    fill = 64 - left;
-
-    ctx->total[0] += length << 3;
-    ctx->total[1] += length >> 29;
+    size_t left = ctx->total & 0x3F;
+    ctx->total += length;
 
-    ctx->total[0] &= 0xFFFFFFFF;
-    ctx->total[1] += ctx->total[0] < (length << 3);
-
-    if (left && length >= fill) {
-        memcpy((void*)(ctx->buffer + left), (void*)input, fill);
-        md5_process(ctx, ctx->buffer);
-        length -= fill;
+    if (left) {
+        size_t fill = std::min<size_t>(64 - left, length);
+        memcpy(ctx->buffer + left, input, fill);
         input += fill;
-        left = 0;
+        length -= fill;
+        if (left + fill < 64)
+            return;
+        detail::md5_compress(ctx->state, ctx->buffer, 1);
     }
 
-    while (length >= 64) {
-        md5_process(ctx, input);
-        length -= 64;
-        input += 64;
+    // whole blocks are hashed straight from the caller's buffer
+    if (length >= 64) {
+        detail::md5_compress(ctx->state, input, length / 64);
+        input += length & ~(size_t)0x3F;
+        length &= 0x3F;
     }
 
     if (length) {
-        memcpy((void*)(ctx->buffer + left), (void*)input, length);
+        memcpy(ctx->buffer, input, length);
     }
 }
 
@@ -208,11 +215,12 @@ void MD5::md5_finish(MD5_Context* ctx, uint8_t digest[16])
 {
     uint32_t last, padn;
     uint8_t msglen[8];
+    uint64_t bits = ctx->total << 3;
 
-    PUT_UINT32(ctx->total[0], msglen, 0);
-    PUT_UINT32(ctx->total[1], msglen, 4);
+    PUT_UINT32((uint32_t)bits, msglen, 0);
+    PUT_UINT32((uint32_t)(bits >> 32), msglen, 4);
 
-    last = (ctx->total[0] >> 3) & 0x3F;
+    last = ctx->total & 0x3F;
     padn = (last < 56) ? (56 - last) : (120 - last);
 
     md5_update(ctx, md5_padding, padn);
@@ -230,11 +238,18 @@ MD5::MD5() { reset(); }
 
 void MD5::reset() { md5_starts(&context_); }
 
-void MD5::update(const uint8_t* input, uint32_t length)
+void MD5::update(const uint8_t* input, size_t length)
 {
     md5_update(&context_, input, length);
 }
 
 void MD5::finish(uint8_t digest[16]) { md5_finish(&context_, digest); }
 
+Md5Digest MD5::finish()
+{
+    Md5Digest digest;
+    md5_finish(&context_, digest.bytes);
+    return digest;
+}
+
 } // namespace nx::digest
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "cpu.h"
+
+namespace nx::digest::detail {
+
+/**
+ * @brief      compress n_blocks consecutive 64 byte blocks into state
+ */
+void md5_compress(uint32_t state[4], const uint8_t* blocks, size_t n_blocks);
+
+#if defined(NX_ARCH_X86_64)
+/**
+ * @brief      compress 8 independent messages at once, one per avx2 lane.
+ *
+ *             state is word major: state[i][lane] is word i of the lane's
+ *             hash. Every lane consumes n_blocks blocks starting at
+ *             data[lane]. requires avx2.
+ */
+void md5_compress_x8_avx2(uint32_t state[4][8],
+                          const uint8_t* const data[8],
+                          size_t n_blocks);
+#endif
+
+} // namespace nx::digest::detail
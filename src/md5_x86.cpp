@@ -0,0 +1,104 @@
+#include "md5_impl.h"
+#include "simd_avx2.h"
+
+#if defined(NX_ARCH_X86_64)
+
+namespace nx::digest::detail {
+
+static const uint32_t MD5_T[64] = {
+    0xD76AA478, 0xE8C7B756, 0x242070DB, 0xC1BDCEEE, 0xF57C0FAF, 0x4787C62A,
+    0xA8304613, 0xFD469501, 0x698098D8, 0x8B44F7AF, 0xFFFF5BB1, 0x895CD7BE,
+    0x6B901122, 0xFD987193, 0xA679438E, 0x49B40821, 0xF61E2562, 0xC040B340,
+    0x265E5A51, 0xE9B6C7AA, 0xD62F105D, 0x02441453, 0xD8A1E681, 0xE7D3FBC8,
+    0x21E1CDE6, 0xC33707D6, 0xF4D50D87, 0x455A14ED, 0xA9E3E905, 0xFCEFA3F8,
+    0x676F02D9, 0x8D2A4C8A, 0xFFFA3942, 0x8771F681, 0x6D9D6122, 0xFDE5380C,
+    0xA4BEEA44, 0x4BDECFA9, 0xF6BB4B60, 0xBEBFBC70, 0x289B7EC6, 0xEAA127FA,
+    0xD4EF3085, 0x04881D05, 0xD9D4D039, 0xE6DB99E5, 0x1FA27CF8, 0xC4AC5665,
+    0xF4292244, 0x432AFF97, 0xAB9423A7, 0xFC93A039, 0x655B59C3, 0x8F0CCC92,
+    0xFFEFF47D, 0x85845DD1, 0x6FA87E4F, 0xFE2CE6E0, 0xA3014314, 0x4E0811A1,
+    0xF7537E82, 0xBD3AF235, 0x2AD7D2BB, 0xEB86D391,
+};
+
+static const int MD5_S[4][4] = {
+    { 7, 12, 17, 22 },
+    { 5, 9, 14, 20 },
+    { 4, 11, 16, 23 },
+    { 6, 10, 15, 21 },
+};
+
+NX_TARGET("avx2")
+static inline __m256i rotl(__m256i x, int n)
+{
+    return _mm256_or_si256(_mm256_slli_epi32(x, n),
+                           _mm256_srli_epi32(x, 32 - n));
+}
+
+NX_TARGET("avx2")
+void md5_compress_x8_avx2(uint32_t state[4][8],
+                          const uint8_t* const data[8],
+                          size_t n_blocks)
+{
+    const __m256i ones = _mm256_set1_epi32(-1);
+    __m256i s[4];
+    for (int i = 0; i < 4; i++) {
+        s[i] = _mm256_loadu_si256((const __m256i*)state[i]);
+    }
+
+    for (size_t block = 0; block < n_blocks; block++) {
+        __m256i x[16];
+        nx::detail::load_transposed_x8(x, data, block * 64, false);
+        nx::detail::load_transposed_x8(x + 8, data, block * 64 + 32, false);
+
+        __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+
+        for (int i = 0; i < 64; i++) {
+            int round = i / 16;
+            __m256i f;
+            int k;
+            switch (round) {
+                case 0:
+                    f = _mm256_xor_si256(
+                        d, _mm256_and_si256(b, _mm256_xor_si256(c, d)));
+                    k = i;
+                    break;
+                case 1:
+                    f = _mm256_xor_si256(
+                        c, _mm256_and_si256(d, _mm256_xor_si256(b, c)));
+                    k = (5 * i + 1) & 15;
+                    break;
+                case 2:
+                    f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+                    k = (3 * i + 5) & 15;
+                    break;
+                default:
+                    f = _mm256_xor_si256(
+                        c, _mm256_or_si256(b, _mm256_xor_si256(d, ones)));
+                    k = (7 * i) & 15;
+                    break;
+            }
+
+            __m256i t = _mm256_add_epi32(
+                _mm256_add_epi32(a, f),
+                _mm256_add_epi32(x[k], _mm256_set1_epi32(MD5_T[i])));
+            t = _mm256_add_epi32(rotl(t, MD5_S[round][i & 3]), b);
+
+            a = d;
+            d = c;
+            c = b;
+            b = t;
+        }
+
+        s[0] = _mm256_add_epi32(s[0], a);
+        s[1] = _mm256_add_epi32(s[1], b);
+        s[2] = _mm256_add_epi32(s[2], c);
+        s[3] = _mm256_add_epi32(s[3], d);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        _mm256_storeu_si256((__m256i*)state[i], s[i]);
+    }
+}
+
+} // namespace nx::digest::detail
+
+#endif
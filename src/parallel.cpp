@@ -0,0 +1,45 @@
+#include "parallel.h"
+#include <atomic>
+#include <thread>
+
+namespace nx::detail {
+
+size_t resolve_thread_count(size_t threads)
+{
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    return std::max<size_t>(threads, 1);
+}
+
+void parallel_for(size_t n, size_t threads, const Function<void(size_t)>& task)
+{
+    threads = std::min(resolve_thread_count(threads), n);
+    if (threads <= 1) {
+        for (size_t i = 0; i < n; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next { 0 };
+    auto worker = [&next, n, &task]() {
+        size_t i;
+        while ((i = next.fetch_add(1)) < n) {
+            task(i);
+        }
+    };
+
+    Vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t i = 1; i < threads; i++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+
+    for (auto& t : workers) {
+        t.join();
+    }
+}
+
+} // namespace nx::detail
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <nx/type.h>
+
+namespace nx::detail {
+
+/**
+ * @brief      resolve a user supplied thread count, 0 means one thread per
+ *             hardware thread.
+ */
+size_t resolve_thread_count(size_t threads);
+
+/**
+ * @brief      run task(i) for every i in [0, n) on up to `threads` threads.
+ *             The calling thread takes part and the call returns when all
+ *             tasks are done.
+ */
+void parallel_for(size_t n, size_t threads, const Function<void(size_t)>& task);
+
+} // namespace nx::detail
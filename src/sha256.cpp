@@ -1,6 +1,6 @@
 #include <nx/digest.h>
+#include "sha256_impl.h"
 
-#define __CPROVER_assume(...)
 #if NX_PLATFORM == NX_PLATFORM_WINDOW
     #define FN_
 #else
@@ -12,7 +12,7 @@ namespace nx::digest {
 
 SHA256::SHA256() { reset(); }
 
-void SHA256::update(const uint8_t* input, uint32_t length)
+void SHA256::update(const uint8_t* input, size_t length)
 {
     sha256_hash(&context_, input, length);
 }
@@ -20,7 +20,16 @@ void SHA256::update(const uint8_t* input, uint32_t length)
 void SHA256::reset() { sha256_init(&context_); }
 void SHA256::finish(uint8_t digest[32]) { sha256_done(&context_, digest); }
 
-static const uint32_t K[64] = {
+Sha256Digest SHA256::finish()
+{
+    Sha256Digest digest;
+    sha256_done(&context_, digest.bytes);
+    return digest;
+}
+
+namespace detail {
+
+const uint32_t SHA256_K[64] = {
     0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
     0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
     0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
@@ -34,6 +43,8 @@ static const uint32_t K[64] = {
     0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
 };
 
+} // namespace detail
+
 // -----------------------------------------------------------------------------
 FN_ uint8_t _shb(uint32_t x, uint32_t n)
 {
@@ -89,74 +100,88 @@ FN_ uint32_t _G1(uint32_t x)
 } // _G1
 
 // -----------------------------------------------------------------------------
-FN_ uint32_t _word(uint8_t* c)
+FN_ uint32_t _word(const uint8_t* c)
 {
     return (_shw(c[0], 24) | _shw(c[1], 16) | _shw(c[2], 8) | (c[3]));
 } // _word
 
-// -----------------------------------------------------------------------------
-static void _addbits(SHA256::SHA256_Context* ctx, uint32_t n)
-{
-    __CPROVER_assume(__CPROVER_DYNAMIC_OBJECT(ctx));
-
-    if (ctx->bits[0] > (0xffffffff - n)) {
-        ctx->bits[1] = (ctx->bits[1] + 1) & 0xFFFFFFFF;
-    }
-    ctx->bits[0] = (ctx->bits[0] + n) & 0xFFFFFFFF;
-} // _addbits
+namespace detail {
 
 // -----------------------------------------------------------------------------
-static void _hash(SHA256::SHA256_Context* ctx)
+void sha256_compress_generic(uint32_t state[8],
+                             const uint8_t* blocks,
+                             size_t n_blocks)
 {
-    __CPROVER_assume(__CPROVER_DYNAMIC_OBJECT(ctx));
-
     uint32_t a, b, c, d, e, f, g, h;
     uint32_t t[2];
+    uint32_t W[64];
+
+    while (n_blocks--) {
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        f = state[5];
+        g = state[6];
+        h = state[7];
+
+        for (uint32_t i = 0; i < 64; i++) {
+            if (i < 16) {
+                W[i] = _word(&blocks[_shw(i, 2)]);
+            } else {
+                W[i] = _G1(W[i - 2]) + W[i - 7] + _G0(W[i - 15]) + W[i - 16];
+            }
 
-    a = ctx->hash[0];
-    b = ctx->hash[1];
-    c = ctx->hash[2];
-    d = ctx->hash[3];
-    e = ctx->hash[4];
-    f = ctx->hash[5];
-    g = ctx->hash[6];
-    h = ctx->hash[7];
-
-    for (uint32_t i = 0; i < 64; i++) {
-        if (i < 16) {
-            ctx->W[i] = _word(&ctx->buf[_shw(i, 2)]);
-        } else {
-            ctx->W[i] = _G1(ctx->W[i - 2]) + ctx->W[i - 7] + _G0(ctx->W[i - 15])
-                        + ctx->W[i - 16];
+            t[0] = h + _S1(e) + _Ch(e, f, g) + SHA256_K[i] + W[i];
+            t[1] = _S0(a) + _Ma(a, b, c);
+            h = g;
+            g = f;
+            f = e;
+            e = d + t[0];
+            d = c;
+            c = b;
+            b = a;
+            a = t[0] + t[1];
         }
 
-        t[0] = h + _S1(e) + _Ch(e, f, g) + K[i] + ctx->W[i];
-        t[1] = _S0(a) + _Ma(a, b, c);
-        h = g;
-        g = f;
-        f = e;
-        e = d + t[0];
-        d = c;
-        c = b;
-        b = a;
-        a = t[0] + t[1];
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+
+        blocks += 64;
+    }
+} // sha256_compress_generic
+
+static SHA256_Compress select_sha256_compress()
+{
+#if defined(NX_ARCH_X86_64)
+    const auto& f = cpu::features();
+    if (f.sha && f.ssse3 && f.sse41) {
+        return sha256_compress_shani;
     }
+#endif
+    return sha256_compress_generic;
+}
+
+SHA256_Compress sha256_compress()
+{
+    static const SHA256_Compress compress = select_sha256_compress();
+    return compress;
+}
 
-    ctx->hash[0] += a;
-    ctx->hash[1] += b;
-    ctx->hash[2] += c;
-    ctx->hash[3] += d;
-    ctx->hash[4] += e;
-    ctx->hash[5] += f;
-    ctx->hash[6] += g;
-    ctx->hash[7] += h;
-} // _hash
+} // namespace detail
 
 // -----------------------------------------------------------------------------
 void SHA256::sha256_init(SHA256::SHA256_Context* ctx)
 {
     if (ctx != NULL) {
-        ctx->bits[0] = ctx->bits[1] = ctx->len = 0;
+        ctx->total = 0;
         ctx->hash[0] = 0x6a09e667;
         ctx->hash[1] = 0xbb67ae85;
         ctx->hash[2] = 0x3c6ef372;
@@ -174,18 +199,34 @@ void SHA256::sha256_hash(SHA256::SHA256_Context* ctx,
                          size_t len)
 {
     const uint8_t* bytes = (const uint8_t*)data;
+    auto compress = detail::sha256_compress();
+
+    if (ctx == NULL || bytes == NULL || len == 0)
+        return;
+
+    size_t used = ctx->total % sizeof(ctx->buf);
+    ctx->total += len;
+
+    if (used) {
+        size_t fill = std::min(sizeof(ctx->buf) - used, len);
+        memcpy(ctx->buf + used, bytes, fill);
+        bytes += fill;
+        len -= fill;
+        if (used + fill < sizeof(ctx->buf))
+            return;
+        compress(ctx->hash, ctx->buf, 1);
+    }
 
-    if ((ctx != NULL) && (bytes != NULL) && (ctx->len < sizeof(ctx->buf))) {
-        __CPROVER_assume(__CPROVER_DYNAMIC_OBJECT(bytes));
-        __CPROVER_assume(__CPROVER_DYNAMIC_OBJECT(ctx));
-        for (size_t i = 0; i < len; i++) {
-            ctx->buf[ctx->len++] = bytes[i];
-            if (ctx->len == sizeof(ctx->buf)) {
-                _hash(ctx);
-                _addbits(ctx, sizeof(ctx->buf) * 8);
-                ctx->len = 0;
-            }
-        }
+    // whole blocks are hashed straight from the caller's buffer
+    if (len >= sizeof(ctx->buf)) {
+        size_t n_blocks = len / sizeof(ctx->buf);
+        compress(ctx->hash, bytes, n_blocks);
+        bytes += n_blocks * sizeof(ctx->buf);
+        len -= n_blocks * sizeof(ctx->buf);
+    }
+
+    if (len) {
+        memcpy(ctx->buf, bytes, len);
     }
 } // sha256_hash
 
@@ -193,31 +234,27 @@ void SHA256::sha256_hash(SHA256::SHA256_Context* ctx,
 void SHA256::sha256_done(SHA256::SHA256_Context* ctx, uint8_t* hash)
 {
     uint32_t i, j;
+    auto compress = detail::sha256_compress();
 
     if (ctx != NULL) {
-        j = ctx->len % sizeof(ctx->buf);
+        j = ctx->total % sizeof(ctx->buf);
         ctx->buf[j] = 0x80;
         for (i = j + 1; i < sizeof(ctx->buf); i++) {
             ctx->buf[i] = 0x00;
         }
 
-        if (ctx->len > 55) {
-            _hash(ctx);
+        if (j > 55) {
+            compress(ctx->hash, ctx->buf, 1);
             for (j = 0; j < sizeof(ctx->buf); j++) {
                 ctx->buf[j] = 0x00;
             }
         }
 
-        _addbits(ctx, ctx->len * 8);
-        ctx->buf[63] = _shb(ctx->bits[0], 0);
-        ctx->buf[62] = _shb(ctx->bits[0], 8);
-        ctx->buf[61] = _shb(ctx->bits[0], 16);
-        ctx->buf[60] = _shb(ctx->bits[0], 24);
-        ctx->buf[59] = _shb(ctx->bits[1], 0);
-        ctx->buf[58] = _shb(ctx->bits[1], 8);
-        ctx->buf[57] = _shb(ctx->bits[1], 16);
-        ctx->buf[56] = _shb(ctx->bits[1], 24);
-        _hash(ctx);
+        uint64_t bits = ctx->total << 3;
+        for (i = 0; i < 8; i++) {
+            ctx->buf[63 - i] = (uint8_t)(bits >> (8 * i));
+        }
+        compress(ctx->hash, ctx->buf, 1);
 
         if (hash != NULL) {
             for (i = 0, j = 24; i < 4; i++, j -= 8) {
@@ -234,4 +271,4 @@ void SHA256::sha256_done(SHA256::SHA256_Context* ctx, uint8_t* hash)
     }
 } // sha256_done
 
-} // namespace nx::digest
\ No newline at end of file
+} // namespace nx::digest
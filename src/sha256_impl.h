@@ -0,0 +1,47 @@
+#pragma once
+
+#include "cpu.h"
+
+namespace nx::digest::detail {
+
+extern const uint32_t SHA256_K[64];
+
+/**
+ * @brief      compress n_blocks consecutive 64 byte blocks into state
+ */
+using SHA256_Compress = void (*)(uint32_t state[8],
+                                 const uint8_t* blocks,
+                                 size_t n_blocks);
+
+/**
+ * @brief      the fastest single stream compress function for the cpu
+ */
+SHA256_Compress sha256_compress();
+
+void sha256_compress_generic(uint32_t state[8],
+                             const uint8_t* blocks,
+                             size_t n_blocks);
+
+#if defined(NX_ARCH_X86_64)
+/**
+ * @brief      compress with the Intel SHA extensions.
+ *
+ *             requires sha, ssse3 and sse4.1.
+ */
+void sha256_compress_shani(uint32_t state[8],
+                           const uint8_t* blocks,
+                           size_t n_blocks);
+
+/**
+ * @brief      compress 8 independent messages at once, one per avx2 lane.
+ *
+ *             state is word major: state[i][lane] is word i of the lane's
+ *             hash. Every lane consumes n_blocks blocks starting at
+ *             data[lane]. requires avx2.
+ */
+void sha256_compress_x8_avx2(uint32_t state[8][8],
+                             const uint8_t* const data[8],
+                             size_t n_blocks);
+#endif
+
+} // namespace nx::digest::detail
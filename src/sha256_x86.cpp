@@ -0,0 +1,166 @@
+#include "sha256_impl.h"
+#include "simd_avx2.h"
+
+#if defined(NX_ARCH_X86_64)
+
+    #include <immintrin.h>
+
+namespace nx::digest::detail {
+
+// two rounds with the low and two with the high half of msg_k
+NX_TARGET("sha,ssse3,sse4.1")
+static inline void sha_rounds4(__m128i& state0, __m128i& state1, __m128i msg_k)
+{
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg_k);
+    msg_k = _mm_shuffle_epi32(msg_k, 0x0E);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, msg_k);
+}
+
+NX_TARGET("sha,ssse3,sse4.1")
+void sha256_compress_shani(uint32_t state[8],
+                           const uint8_t* blocks,
+                           size_t n_blocks)
+{
+    const __m128i bswap_mask
+        = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // the sha instructions want the state as ABEF and CDGH
+    __m128i tmp = _mm_loadu_si128((const __m128i*)&state[0]);
+    __m128i state1 = _mm_loadu_si128((const __m128i*)&state[4]);
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);
+    state1 = _mm_shuffle_epi32(state1, 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    while (n_blocks--) {
+        __m128i abef = state0;
+        __m128i cdgh = state1;
+        __m128i m[4];
+
+        for (int i = 0; i < 4; i++) {
+            m[i] = _mm_loadu_si128((const __m128i*)(blocks + 16 * i));
+            m[i] = _mm_shuffle_epi8(m[i], bswap_mask);
+        }
+
+        // m[g % 4] holds the message words of rounds 4g .. 4g + 3, the
+        // words of later groups are computed in place.
+        for (int g = 0; g < 16; g++) {
+            __m128i cur = m[g & 3];
+            __m128i k = _mm_loadu_si128((const __m128i*)&SHA256_K[4 * g]);
+            sha_rounds4(state0, state1, _mm_add_epi32(cur, k));
+
+            if (g >= 3 && g <= 14) {
+                __m128i& next = m[(g + 1) & 3];
+                next = _mm_add_epi32(next,
+                                     _mm_alignr_epi8(cur, m[(g - 1) & 3], 4));
+                next = _mm_sha256msg2_epu32(next, cur);
+            }
+            if (g >= 1 && g <= 12) {
+                __m128i& prev = m[(g - 1) & 3];
+                prev = _mm_sha256msg1_epu32(prev, cur);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+        blocks += 64;
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+    _mm_storeu_si128((__m128i*)&state[0], state0);
+    _mm_storeu_si128((__m128i*)&state[4], state1);
+}
+
+NX_TARGET("avx2")
+static inline __m256i rotr(__m256i x, int n)
+{
+    return _mm256_or_si256(_mm256_srli_epi32(x, n),
+                           _mm256_slli_epi32(x, 32 - n));
+}
+
+NX_TARGET("avx2")
+void sha256_compress_x8_avx2(uint32_t state[8][8],
+                             const uint8_t* const data[8],
+                             size_t n_blocks)
+{
+    __m256i s[8];
+    for (int i = 0; i < 8; i++) {
+        s[i] = _mm256_loadu_si256((const __m256i*)state[i]);
+    }
+
+    for (size_t block = 0; block < n_blocks; block++) {
+        __m256i w[16];
+        nx::detail::load_transposed_x8(w, data, block * 64, true);
+        nx::detail::load_transposed_x8(w + 8, data, block * 64 + 32, true);
+
+        __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+        __m256i e = s[4], f = s[5], g = s[6], h = s[7];
+
+        for (int i = 0; i < 64; i++) {
+            __m256i wi;
+            if (i < 16) {
+                wi = w[i];
+            } else {
+                __m256i w15 = w[(i - 15) & 15];
+                __m256i w2 = w[(i - 2) & 15];
+                __m256i g0 = _mm256_xor_si256(
+                    _mm256_xor_si256(rotr(w15, 7), rotr(w15, 18)),
+                    _mm256_srli_epi32(w15, 3));
+                __m256i g1 = _mm256_xor_si256(
+                    _mm256_xor_si256(rotr(w2, 17), rotr(w2, 19)),
+                    _mm256_srli_epi32(w2, 10));
+                wi = _mm256_add_epi32(
+                    _mm256_add_epi32(w[i & 15], g0),
+                    _mm256_add_epi32(w[(i - 7) & 15], g1));
+                w[i & 15] = wi;
+            }
+
+            __m256i s1 = _mm256_xor_si256(
+                _mm256_xor_si256(rotr(e, 6), rotr(e, 11)), rotr(e, 25));
+            __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f),
+                                          _mm256_andnot_si256(e, g));
+            __m256i t0 = _mm256_add_epi32(
+                _mm256_add_epi32(h, s1),
+                _mm256_add_epi32(
+                    ch,
+                    _mm256_add_epi32(wi, _mm256_set1_epi32(SHA256_K[i]))));
+
+            __m256i s0 = _mm256_xor_si256(
+                _mm256_xor_si256(rotr(a, 2), rotr(a, 13)), rotr(a, 22));
+            __m256i maj = _mm256_or_si256(
+                _mm256_and_si256(a, b),
+                _mm256_and_si256(c, _mm256_or_si256(a, b)));
+            __m256i t1 = _mm256_add_epi32(s0, maj);
+
+            h = g;
+            g = f;
+            f = e;
+            e = _mm256_add_epi32(d, t0);
+            d = c;
+            c = b;
+            b = a;
+            a = _mm256_add_epi32(t0, t1);
+        }
+
+        s[0] = _mm256_add_epi32(s[0], a);
+        s[1] = _mm256_add_epi32(s[1], b);
+        s[2] = _mm256_add_epi32(s[2], c);
+        s[3] = _mm256_add_epi32(s[3], d);
+        s[4] = _mm256_add_epi32(s[4], e);
+        s[5] = _mm256_add_epi32(s[5], f);
+        s[6] = _mm256_add_epi32(s[6], g);
+        s[7] = _mm256_add_epi32(s[7], h);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        _mm256_storeu_si256((__m256i*)state[i], s[i]);
+    }
+}
+
+} // namespace nx::digest::detail
+
+#endif
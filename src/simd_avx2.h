@@ -0,0 +1,55 @@
+#pragma once
+
+#include "cpu.h"
+
+#if defined(NX_ARCH_X86_64)
+
+    #include <immintrin.h>
+
+namespace nx::detail {
+
+/**
+ * @brief      load 8 consecutive 32 bit words from each of 8 lanes,
+ *             transposed so that w[i] holds word i of every lane.
+ *
+ * @param      w           The output words
+ * @param[in]  data        The lane pointers
+ * @param[in]  offset      The byte offset added to every lane pointer
+ * @param[in]  big_endian  Whether the words are stored big endian
+ */
+NX_TARGET("avx2")
+inline void load_transposed_x8(__m256i w[8],
+                               const uint8_t* const data[8],
+                               size_t offset,
+                               bool big_endian)
+{
+    const __m256i bswap_mask = _mm256_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                                 0x0405060700010203ULL,
+                                                 0x0c0d0e0f08090a0bULL,
+                                                 0x0405060700010203ULL);
+    __m256i r[8], t[8], u[8];
+    for (int i = 0; i < 8; i++) {
+        r[i] = _mm256_loadu_si256((const __m256i*)(data[i] + offset));
+        if (big_endian) {
+            r[i] = _mm256_shuffle_epi8(r[i], bswap_mask);
+        }
+    }
+    for (int i = 0; i < 8; i += 2) {
+        t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+        t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+    }
+    for (int i = 0; i < 8; i += 4) {
+        u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+        u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+        u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+        u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+    for (int i = 0; i < 4; i++) {
+        w[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+        w[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+    }
+}
+
+} // namespace nx::detail
+
+#endif
@@ -10,12 +10,10 @@ bool Read::read_exact(void* buffer, size_t bytes)
     while (bytes) {
         auto result = read(ptr, bytes);
 
-        if (auto* r = std::get_if<IO_Success>(&result)) {
-            bytes -= r->bytes;
-            ptr += r->bytes;
-        } else {
+        if (!result.ok())
             return false;
-        }
+        bytes -= result.bytes();
+        ptr += result.bytes();
     }
     return true;
 }
@@ -26,21 +24,27 @@ ReadAllResult Read::read_all()
     size_t bytes = 0;
     size_t capacity = 1024;
 
+    // one spare byte, so that reaching the end of a reader that knows its
+    // size does not grow the buffer
+    auto hint = size_hint();
+    if (hint && *hint > 0) {
+        capacity = *hint + 1;
+    }
     data.resize(capacity);
 
     while (true) {
         auto result = read(data.data() + bytes, capacity - bytes);
-        if (std::holds_alternative<EndOfFile>(result)) {
+        if (result.eof()) {
             break;
-        } else if (auto* r = std::get_if<IO_Success>(&result)) {
-            bytes += r->bytes;
+        } else if (result.ok()) {
+            bytes += result.bytes();
             if (bytes == capacity) {
                 capacity <<= 1;
                 data.resize(capacity);
             }
 
         } else {
-            return std::get<IO_Error>(result);
+            return result.error();
         }
     }
 
@@ -53,81 +57,44 @@ Write::~Write() { }
 bool Write::write_all(const void* buffer, size_t bytes)
 {
     auto* ptr = (const uint8_t*)buffer;
-    WriteResult result;
     size_t offset = 0;
     while (bytes) {
-        result = write(ptr + offset, bytes);
-
-        bool io_fail = false;
-        size_t io_bytes = 0;
-
-        std::visit(
-            [&io_fail, &io_bytes](auto&& arg) {
-                using T = std::decay_t<decltype(arg)>;
-                if constexpr (std::is_same_v<T, IO_Error>) {
-                    io_fail = true;
-                } else if constexpr (std::is_same_v<T, IO_Success>) {
-                    io_bytes = arg.bytes;
-                } else {
-                    NX_PANIC("non-exhaustive visitor!");
-                }
-            },
-            result);
-
-        if (io_fail)
+        auto result = write(ptr + offset, bytes);
+        if (!result.ok())
             return false;
 
-        if (io_bytes > 0) {
-            offset += io_bytes;
-            bytes -= io_bytes;
-        }
+        offset += result.bytes();
+        bytes -= result.bytes();
     }
 
     return true;
 }
 
-bool pipe(Read* source, Write* sink) { return pipe(*source, *sink); }
-
-bool pipe(Read& source, Write& sink)
+bool pipe(Read* source, Write* sink, size_t buffer_size)
 {
-    const auto buf_nr = 8_kb;
-    uint8_t buffer[buf_nr];
-    ReadResult read_result;
-    while (true) {
-        read_result = source.read(buffer, buf_nr);
-
-        bool read_fail = false;
-        bool eof = false;
-        size_t bytes = 0;
-
-        std::visit(
-            [&read_fail, &eof, &bytes](auto&& arg) {
-                using T = std::decay_t<decltype(arg)>;
-                if constexpr (std::is_same_v<T, EndOfFile>) {
-                    eof = true;
-                } else if constexpr (std::is_same_v<T, IO_Error>) {
-                    read_fail = true;
-                } else if constexpr (std::is_same_v<T, IO_Success>) {
-                    bytes = arg.bytes;
-                } else {
-                    NX_PANIC("non-exhaustive visitor!");
-                }
-            },
-            read_result);
-
-        if (eof)
-            break;
+    return pipe(*source, *sink, buffer_size);
+}
 
-        if (read_fail)
-            return false;
+bool pipe(Read& source, Write& sink, size_t buffer_size)
+{
+    if (auto copied = source.copy_to(sink))
+        return *copied;
 
-        if (bytes > 0) {
-            if (!sink.write_all(buffer, bytes))
-                return false;
-        }
-    };
+    // a byte more than what is left sees the end in the first read
+    auto hint = source.size_hint();
+    if (hint) {
+        buffer_size = std::min(buffer_size, *hint + 1);
+    }
+    buffer_size = std::max<size_t>(buffer_size, 1);
+    UniquePtr<uint8_t[]> buffer(new uint8_t[buffer_size]);
 
-    return true;
+    while (true) {
+        auto result = source.read(buffer.get(), buffer_size);
+        if (!result.ok())
+            return result.eof();
+        if (result.bytes() > 0 && !sink.write_all(buffer.get(), result.bytes()))
+            return false;
+    }
 }
 
 MemoryFile::MemoryFile(const uint8_t* buffer, size_t buf_len)
@@ -152,4 +119,6 @@ ReadResult MemoryFile::read(void* output, size_t n)
     return IO_Success { n };
 }
 
+Optional<size_t> MemoryFile::size_hint() const { return buf_len_ - read_pos_; }
+
 } // namespace nx
\ No newline at end of file
@@ -0,0 +1,628 @@
+#include <nx/digest.h>
+#include "xxh3_impl.h"
+
+// XXH3 as specified by the reference xxHash library (v0.8), which this
+// matches bit for bit. Inputs up to 240 bytes are hashed by dedicated
+// short paths, longer inputs by 8 accumulators that the simd kernels in
+// xxh3_x86.cpp update a 64 byte stripe at a time.
+
+namespace nx::digest {
+
+namespace {
+
+constexpr uint32_t PRIME32_1 = 0x9E3779B1U;
+constexpr uint32_t PRIME32_2 = 0x85EBCA77U;
+constexpr uint32_t PRIME32_3 = 0xC2B2AE3DU;
+
+constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+constexpr uint64_t PRIME_MX1 = 0x165667919E3779F9ULL;
+constexpr uint64_t PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+constexpr size_t MIDSIZE_MAX = 240;
+constexpr size_t MIDSIZE_START_OFFSET = 3;
+constexpr size_t MIDSIZE_LAST_OFFSET = 17;
+constexpr size_t SECRET_SIZE_MIN = 136;
+constexpr size_t SECRET_CONSUME_RATE = 8;
+constexpr size_t SECRET_LASTACC_START = 7;
+constexpr size_t SECRET_MERGEACCS_START = 11;
+
+constexpr size_t STRIPE_LEN = detail::XXH3_STRIPE_LEN;
+constexpr size_t SECRET_SIZE = detail::XXH3_SECRET_SIZE;
+constexpr size_t SECRET_LIMIT = SECRET_SIZE - STRIPE_LEN;
+constexpr size_t STRIPES_PER_BLOCK = SECRET_LIMIT / SECRET_CONSUME_RATE;
+constexpr size_t BLOCK_LEN = STRIPE_LEN * STRIPES_PER_BLOCK;
+constexpr size_t BUFFER_SIZE = 256;
+constexpr size_t BUFFER_STRIPES = BUFFER_SIZE / STRIPE_LEN;
+
+// pseudorandom secret taken from FARSH
+alignas(64) constexpr uint8_t DEFAULT_SECRET[SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+    0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+    0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+    0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+    0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+    0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+    0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+    0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+    0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+constexpr uint64_t INIT_ACC[8] = {
+    PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
+    PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1,
+};
+
+inline uint32_t read32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t read64(const uint8_t* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void write64(uint8_t* p, uint64_t v) { memcpy(p, &v, sizeof(v)); }
+
+inline uint32_t swap32(uint32_t x)
+{
+    return (x << 24) | ((x << 8) & 0x00ff0000) | ((x >> 8) & 0x0000ff00)
+           | (x >> 24);
+}
+
+inline uint64_t swap64(uint64_t x)
+{
+    return ((uint64_t)swap32((uint32_t)x) << 32) | swap32((uint32_t)(x >> 32));
+}
+
+inline uint32_t rotl32(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline Hash128 mult64to128(uint64_t lhs, uint64_t rhs)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = (unsigned __int128)lhs * rhs;
+    return { (uint64_t)product, (uint64_t)(product >> 64) };
+#else
+    uint64_t lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+    uint64_t hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+    uint64_t lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+    uint64_t hi_hi = (lhs >> 32) * (rhs >> 32);
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+    return { lower, upper };
+#endif
+}
+
+inline uint64_t mul128_fold64(uint64_t lhs, uint64_t rhs)
+{
+    Hash128 product = mult64to128(lhs, rhs);
+    return product.low64 ^ product.high64;
+}
+
+inline uint64_t xorshift64(uint64_t v, int shift) { return v ^ (v >> shift); }
+
+uint64_t xxh64_avalanche(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t avalanche(uint64_t h)
+{
+    h = xorshift64(h, 37);
+    h *= PRIME_MX1;
+    return xorshift64(h, 32);
+}
+
+uint64_t rrmxmx(uint64_t h, uint64_t len)
+{
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= PRIME_MX2;
+    return xorshift64(h, 28);
+}
+
+inline uint64_t
+mix16(const uint8_t* input, const uint8_t* secret, uint64_t seed)
+{
+    return mul128_fold64(read64(input) ^ (read64(secret) + seed),
+                         read64(input + 8) ^ (read64(secret + 8) - seed));
+}
+
+// --- 64 bit, short inputs ----------------------------------------------------
+
+uint64_t
+hash64_0to16(const uint8_t* input, size_t len, const uint8_t* secret,
+             uint64_t seed)
+{
+    if (len > 8) {
+        uint64_t bitflip1 = (read64(secret + 24) ^ read64(secret + 32)) + seed;
+        uint64_t bitflip2 = (read64(secret + 40) ^ read64(secret + 48)) - seed;
+        uint64_t lo = read64(input) ^ bitflip1;
+        uint64_t hi = read64(input + len - 8) ^ bitflip2;
+        uint64_t acc = len + swap64(lo) + hi + mul128_fold64(lo, hi);
+        return avalanche(acc);
+    }
+    if (len >= 4) {
+        seed ^= (uint64_t)swap32((uint32_t)seed) << 32;
+        uint32_t input1 = read32(input);
+        uint32_t input2 = read32(input + len - 4);
+        uint64_t bitflip = (read64(secret + 8) ^ read64(secret + 16)) - seed;
+        uint64_t input64 = input2 + ((uint64_t)input1 << 32);
+        return rrmxmx(input64 ^ bitflip, len);
+    }
+    if (len) {
+        uint32_t combined = ((uint32_t)input[0] << 16)
+                            | ((uint32_t)input[len >> 1] << 24)
+                            | ((uint32_t)input[len - 1] << 0)
+                            | ((uint32_t)len << 8);
+        uint64_t bitflip = (read32(secret) ^ read32(secret + 4)) + seed;
+        return xxh64_avalanche((uint64_t)combined ^ bitflip);
+    }
+    return xxh64_avalanche(seed ^ (read64(secret + 56) ^ read64(secret + 64)));
+}
+
+uint64_t
+hash64_17to128(const uint8_t* input, size_t len, const uint8_t* secret,
+               uint64_t seed)
+{
+    uint64_t acc = len * PRIME64_1;
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) {
+                acc += mix16(input + 48, secret + 96, seed);
+                acc += mix16(input + len - 64, secret + 112, seed);
+            }
+            acc += mix16(input + 32, secret + 64, seed);
+            acc += mix16(input + len - 48, secret + 80, seed);
+        }
+        acc += mix16(input + 16, secret + 32, seed);
+        acc += mix16(input + len - 32, secret + 48, seed);
+    }
+    acc += mix16(input + 0, secret + 0, seed);
+    acc += mix16(input + len - 16, secret + 16, seed);
+    return avalanche(acc);
+}
+
+uint64_t
+hash64_129to240(const uint8_t* input, size_t len, const uint8_t* secret,
+                uint64_t seed)
+{
+    uint64_t acc = len * PRIME64_1;
+    size_t rounds = len / 16;
+    for (size_t i = 0; i < 8; i++) {
+        acc += mix16(input + 16 * i, secret + 16 * i, seed);
+    }
+    uint64_t acc_end = mix16(input + len - 16,
+                             secret + SECRET_SIZE_MIN - MIDSIZE_LAST_OFFSET,
+                             seed);
+    acc = avalanche(acc);
+    for (size_t i = 8; i < rounds; i++) {
+        acc_end += mix16(input + 16 * i,
+                         secret + 16 * (i - 8) + MIDSIZE_START_OFFSET,
+                         seed);
+    }
+    return avalanche(acc + acc_end);
+}
+
+// --- 128 bit, short inputs ---------------------------------------------------
+
+Hash128 hash128_0to16(const uint8_t* input, size_t len, const uint8_t* secret,
+                      uint64_t seed)
+{
+    if (len > 8) {
+        uint64_t bitflipl = (read64(secret + 32) ^ read64(secret + 40)) - seed;
+        uint64_t bitfliph = (read64(secret + 48) ^ read64(secret + 56)) + seed;
+        uint64_t input_lo = read64(input);
+        uint64_t input_hi = read64(input + len - 8);
+        Hash128 m = mult64to128(input_lo ^ input_hi ^ bitflipl, PRIME64_1);
+        m.low64 += (uint64_t)(len - 1) << 54;
+        input_hi ^= bitfliph;
+        m.high64 += input_hi
+                    + (uint64_t)(uint32_t)input_hi * (uint64_t)(PRIME32_2 - 1);
+        m.low64 ^= swap64(m.high64);
+
+        Hash128 h = mult64to128(m.low64, PRIME64_2);
+        h.high64 += m.high64 * PRIME64_2;
+        return { avalanche(h.low64), avalanche(h.high64) };
+    }
+    if (len >= 4) {
+        seed ^= (uint64_t)swap32((uint32_t)seed) << 32;
+        uint32_t input_lo = read32(input);
+        uint32_t input_hi = read32(input + len - 4);
+        uint64_t input64 = input_lo + ((uint64_t)input_hi << 32);
+        uint64_t bitflip = (read64(secret + 16) ^ read64(secret + 24)) + seed;
+        Hash128 m = mult64to128(input64 ^ bitflip, PRIME64_1 + (len << 2));
+
+        m.high64 += m.low64 << 1;
+        m.low64 ^= m.high64 >> 3;
+        m.low64 = xorshift64(m.low64, 35);
+        m.low64 *= PRIME_MX2;
+        m.low64 = xorshift64(m.low64, 28);
+        m.high64 = avalanche(m.high64);
+        return m;
+    }
+    if (len) {
+        uint32_t combinedl = ((uint32_t)input[0] << 16)
+                             | ((uint32_t)input[len >> 1] << 24)
+                             | ((uint32_t)input[len - 1] << 0)
+                             | ((uint32_t)len << 8);
+        uint32_t combinedh = rotl32(swap32(combinedl), 13);
+        uint64_t bitflipl = (read32(secret) ^ read32(secret + 4)) + seed;
+        uint64_t bitfliph = (read32(secret + 8) ^ read32(secret + 12)) - seed;
+        return { xxh64_avalanche((uint64_t)combinedl ^ bitflipl),
+                 xxh64_avalanche((uint64_t)combinedh ^ bitfliph) };
+    }
+    uint64_t bitflipl = read64(secret + 64) ^ read64(secret + 72);
+    uint64_t bitfliph = read64(secret + 80) ^ read64(secret + 88);
+    return { xxh64_avalanche(seed ^ bitflipl), xxh64_avalanche(seed ^ bitfliph) };
+}
+
+inline Hash128 mix32(Hash128 acc,
+                     const uint8_t* input_1,
+                     const uint8_t* input_2,
+                     const uint8_t* secret,
+                     uint64_t seed)
+{
+    acc.low64 += mix16(input_1, secret + 0, seed);
+    acc.low64 ^= read64(input_2) + read64(input_2 + 8);
+    acc.high64 += mix16(input_2, secret + 16, seed);
+    acc.high64 ^= read64(input_1) + read64(input_1 + 8);
+    return acc;
+}
+
+Hash128 finish_mid_128(Hash128 acc, size_t len, uint64_t seed)
+{
+    Hash128 h;
+    h.low64 = acc.low64 + acc.high64;
+    h.high64 = (acc.low64 * PRIME64_1) + (acc.high64 * PRIME64_4)
+               + ((len - seed) * PRIME64_2);
+    h.low64 = avalanche(h.low64);
+    h.high64 = (uint64_t)0 - avalanche(h.high64);
+    return h;
+}
+
+Hash128 hash128_17to128(const uint8_t* input, size_t len,
+                        const uint8_t* secret, uint64_t seed)
+{
+    Hash128 acc = { len * PRIME64_1, 0 };
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) {
+                acc = mix32(acc, input + 48, input + len - 64, secret + 96,
+                            seed);
+            }
+            acc = mix32(acc, input + 32, input + len - 48, secret + 64, seed);
+        }
+        acc = mix32(acc, input + 16, input + len - 32, secret + 32, seed);
+    }
+    acc = mix32(acc, input, input + len - 16, secret, seed);
+    return finish_mid_128(acc, len, seed);
+}
+
+Hash128 hash128_129to240(const uint8_t* input, size_t len,
+                         const uint8_t* secret, uint64_t seed)
+{
+    Hash128 acc = { len * PRIME64_1, 0 };
+    for (size_t i = 32; i < 160; i += 32) {
+        acc = mix32(acc, input + i - 32, input + i - 16, secret + i - 32, seed);
+    }
+    acc.low64 = avalanche(acc.low64);
+    acc.high64 = avalanche(acc.high64);
+    for (size_t i = 160; i <= len; i += 32) {
+        acc = mix32(acc,
+                    input + i - 32,
+                    input + i - 16,
+                    secret + MIDSIZE_START_OFFSET + i - 160,
+                    seed);
+    }
+    acc = mix32(acc,
+                input + len - 16,
+                input + len - 32,
+                secret + SECRET_SIZE_MIN - MIDSIZE_LAST_OFFSET - 16,
+                (uint64_t)0 - seed);
+    return finish_mid_128(acc, len, seed);
+}
+
+// --- long inputs -------------------------------------------------------------
+
+void init_secret(uint8_t secret[SECRET_SIZE], uint64_t seed)
+{
+    for (size_t i = 0; i < SECRET_SIZE; i += 16) {
+        write64(secret + i, read64(DEFAULT_SECRET + i) + seed);
+        write64(secret + i + 8, read64(DEFAULT_SECRET + i + 8) - seed);
+    }
+}
+
+uint64_t merge_accs(const uint64_t acc[8], const uint8_t* secret, uint64_t start)
+{
+    uint64_t result = start;
+    for (size_t i = 0; i < 4; i++) {
+        result += mul128_fold64(acc[2 * i] ^ read64(secret + 16 * i),
+                                acc[2 * i + 1] ^ read64(secret + 16 * i + 8));
+    }
+    return avalanche(result);
+}
+
+uint64_t merge_64(const uint64_t acc[8], const uint8_t* secret, uint64_t len)
+{
+    return merge_accs(acc, secret + SECRET_MERGEACCS_START, len * PRIME64_1);
+}
+
+Hash128 merge_128(const uint64_t acc[8], const uint8_t* secret, uint64_t len)
+{
+    return {
+        merge_accs(acc, secret + SECRET_MERGEACCS_START, len * PRIME64_1),
+        merge_accs(acc,
+                   secret + SECRET_SIZE - 64 - SECRET_MERGEACCS_START,
+                   ~(len * PRIME64_2)),
+    };
+}
+
+void hash_long(uint64_t acc[8],
+               const uint8_t* input,
+               size_t len,
+               const uint8_t* secret)
+{
+    const auto& kernels = detail::xxh3_kernels();
+    memcpy(acc, INIT_ACC, sizeof(INIT_ACC));
+
+    size_t n_blocks = (len - 1) / BLOCK_LEN;
+    for (size_t n = 0; n < n_blocks; n++) {
+        kernels.accumulate(acc, input + n * BLOCK_LEN, secret, STRIPES_PER_BLOCK);
+        kernels.scramble(acc, secret + SECRET_LIMIT);
+    }
+
+    size_t n_stripes = ((len - 1) - BLOCK_LEN * n_blocks) / STRIPE_LEN;
+    kernels.accumulate(acc, input + n_blocks * BLOCK_LEN, secret, n_stripes);
+
+    // the last stripe ends at the end of the input, it may overlap the
+    // previous one
+    kernels.accumulate(acc,
+                       input + len - STRIPE_LEN,
+                       secret + SECRET_LIMIT - SECRET_LASTACC_START,
+                       1);
+}
+
+// Accumulates stripes continuing a block that already has stripes_so_far
+// stripes, scrambling at every block end. Returns the end of the input.
+const uint8_t* consume_stripes(uint64_t acc[8],
+                               size_t* stripes_so_far,
+                               const uint8_t* input,
+                               size_t n_stripes,
+                               const uint8_t* secret)
+{
+    const auto& kernels = detail::xxh3_kernels();
+    const uint8_t* initial_secret = secret + *stripes_so_far * SECRET_CONSUME_RATE;
+
+    if (n_stripes >= STRIPES_PER_BLOCK - *stripes_so_far) {
+        size_t n = STRIPES_PER_BLOCK - *stripes_so_far;
+        do {
+            kernels.accumulate(acc, input, initial_secret, n);
+            kernels.scramble(acc, secret + SECRET_LIMIT);
+            input += n * STRIPE_LEN;
+            n_stripes -= n;
+            n = STRIPES_PER_BLOCK;
+            initial_secret = secret;
+        } while (n_stripes >= STRIPES_PER_BLOCK);
+        *stripes_so_far = 0;
+    }
+
+    if (n_stripes > 0) {
+        kernels.accumulate(acc, input, initial_secret, n_stripes);
+        input += n_stripes * STRIPE_LEN;
+        *stripes_so_far += n_stripes;
+    }
+    return input;
+}
+
+} // namespace
+
+namespace detail {
+
+#if !defined(NX_ARCH_X86_64)
+static void xxh3_accumulate_scalar(uint64_t acc[8],
+                                   const uint8_t* input,
+                                   const uint8_t* secret,
+                                   size_t n_stripes)
+{
+    for (size_t n = 0; n < n_stripes; n++) {
+        const uint8_t* in = input + n * STRIPE_LEN;
+        const uint8_t* key = secret + n * SECRET_CONSUME_RATE;
+        for (size_t i = 0; i < 8; i++) {
+            uint64_t data_val = read64(in + 8 * i);
+            uint64_t data_key = data_val ^ read64(key + 8 * i);
+            acc[i ^ 1] += data_val;
+            acc[i] += (data_key & 0xFFFFFFFF) * (data_key >> 32);
+        }
+    }
+}
+
+static void xxh3_scramble_scalar(uint64_t acc[8], const uint8_t* secret)
+{
+    for (size_t i = 0; i < 8; i++) {
+        uint64_t a = xorshift64(acc[i], 47);
+        a ^= read64(secret + 8 * i);
+        acc[i] = a * PRIME32_1;
+    }
+}
+#endif
+
+static XXH3_Kernels select_xxh3_kernels()
+{
+#if defined(NX_ARCH_X86_64)
+    if (cpu::features().avx2) {
+        return { xxh3_accumulate_avx2, xxh3_scramble_avx2 };
+    }
+    return { xxh3_accumulate_sse2, xxh3_scramble_sse2 };
+#else
+    return { xxh3_accumulate_scalar, xxh3_scramble_scalar };
+#endif
+}
+
+const XXH3_Kernels& xxh3_kernels()
+{
+    static const XXH3_Kernels kernels = select_xxh3_kernels();
+    return kernels;
+}
+
+} // namespace detail
+
+uint64_t xxh3_64(const uint8_t* data, size_t len, uint64_t seed)
+{
+    if (len <= 16)
+        return hash64_0to16(data, len, DEFAULT_SECRET, seed);
+    if (len <= 128)
+        return hash64_17to128(data, len, DEFAULT_SECRET, seed);
+    if (len <= MIDSIZE_MAX)
+        return hash64_129to240(data, len, DEFAULT_SECRET, seed);
+
+    alignas(64) uint8_t custom[SECRET_SIZE];
+    const uint8_t* secret = DEFAULT_SECRET;
+    if (seed) {
+        init_secret(custom, seed);
+        secret = custom;
+    }
+
+    alignas(64) uint64_t acc[8];
+    hash_long(acc, data, len, secret);
+    return merge_64(acc, secret, len);
+}
+
+Hash128 xxh3_128(const uint8_t* data, size_t len, uint64_t seed)
+{
+    if (len <= 16)
+        return hash128_0to16(data, len, DEFAULT_SECRET, seed);
+    if (len <= 128)
+        return hash128_17to128(data, len, DEFAULT_SECRET, seed);
+    if (len <= MIDSIZE_MAX)
+        return hash128_129to240(data, len, DEFAULT_SECRET, seed);
+
+    alignas(64) uint8_t custom[SECRET_SIZE];
+    const uint8_t* secret = DEFAULT_SECRET;
+    if (seed) {
+        init_secret(custom, seed);
+        secret = custom;
+    }
+
+    alignas(64) uint64_t acc[8];
+    hash_long(acc, data, len, secret);
+    return merge_128(acc, secret, len);
+}
+
+XXH3::XXH3(uint64_t seed)
+    : seed_(seed)
+{
+    init_secret(secret_, seed);
+    reset();
+}
+
+void XXH3::reset()
+{
+    memcpy(acc_, INIT_ACC, sizeof(INIT_ACC));
+    buffered_ = 0;
+    stripes_ = 0;
+    total_ = 0;
+}
+
+void XXH3::update(const uint8_t* input, size_t length)
+{
+    const uint8_t* end = input + length;
+    total_ += length;
+
+    if (length <= BUFFER_SIZE - buffered_) {
+        memcpy(buffer_ + buffered_, input, length);
+        buffered_ += length;
+        return;
+    }
+
+    // The buffer is only flushed once more input follows, so that the
+    // last stripe is always available at finish.
+    if (buffered_) {
+        size_t fill = BUFFER_SIZE - buffered_;
+        memcpy(buffer_ + buffered_, input, fill);
+        input += fill;
+        consume_stripes(acc_, &stripes_, buffer_, BUFFER_STRIPES, secret_);
+        buffered_ = 0;
+    }
+
+    // stripes are read in place, the one before the tail is kept as the
+    // end of the buffer in case the tail turns out to be short
+    if ((size_t)(end - input) > BUFFER_SIZE) {
+        size_t n_stripes = (size_t)(end - 1 - input) / STRIPE_LEN;
+        input = consume_stripes(acc_, &stripes_, input, n_stripes, secret_);
+        memcpy(buffer_ + BUFFER_SIZE - STRIPE_LEN,
+               input - STRIPE_LEN,
+               STRIPE_LEN);
+    }
+
+    memcpy(buffer_, input, (size_t)(end - input));
+    buffered_ = (size_t)(end - input);
+}
+
+void XXH3::digest_long(uint64_t acc[8]) const
+{
+    const auto& kernels = detail::xxh3_kernels();
+    uint8_t last_stripe[STRIPE_LEN];
+    const uint8_t* last;
+
+    memcpy(acc, acc_, sizeof(acc_));
+    if (buffered_ >= STRIPE_LEN) {
+        size_t n_stripes = (buffered_ - 1) / STRIPE_LEN;
+        size_t stripes = stripes_;
+        consume_stripes(acc, &stripes, buffer_, n_stripes, secret_);
+        last = buffer_ + buffered_ - STRIPE_LEN;
+    } else {
+        size_t catchup = STRIPE_LEN - buffered_;
+        memcpy(last_stripe, buffer_ + BUFFER_SIZE - catchup, catchup);
+        memcpy(last_stripe + catchup, buffer_, buffered_);
+        last = last_stripe;
+    }
+    kernels.accumulate(
+        acc, last, secret_ + SECRET_LIMIT - SECRET_LASTACC_START, 1);
+}
+
+uint64_t XXH3::finish() const
+{
+    if (total_ <= MIDSIZE_MAX)
+        return xxh3_64(buffer_, (size_t)total_, seed_);
+
+    alignas(64) uint64_t acc[8];
+    digest_long(acc);
+    return merge_64(acc, secret_, total_);
+}
+
+Hash128 XXH3::finish_128() const
+{
+    if (total_ <= MIDSIZE_MAX)
+        return xxh3_128(buffer_, (size_t)total_, seed_);
+
+    alignas(64) uint64_t acc[8];
+    digest_long(acc);
+    return merge_128(acc, secret_, total_);
+}
+
+} // namespace nx::digest
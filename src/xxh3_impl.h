@@ -0,0 +1,51 @@
+#pragma once
+
+#include "cpu.h"
+
+namespace nx::digest::detail {
+
+constexpr size_t XXH3_STRIPE_LEN = 64;
+constexpr size_t XXH3_SECRET_SIZE = 192;
+
+/**
+ * @brief      accumulate n_stripes consecutive 64 byte stripes into acc,
+ *             stripe i is keyed with secret + 8 * i.
+ */
+using XXH3_Accumulate = void (*)(uint64_t acc[8],
+                                 const uint8_t* input,
+                                 const uint8_t* secret,
+                                 size_t n_stripes);
+
+/**
+ * @brief      scramble acc at the end of a block
+ */
+using XXH3_Scramble = void (*)(uint64_t acc[8], const uint8_t* secret);
+
+struct XXH3_Kernels {
+    XXH3_Accumulate accumulate;
+    XXH3_Scramble scramble;
+};
+
+/**
+ * @brief      the fastest kernels for the cpu
+ */
+const XXH3_Kernels& xxh3_kernels();
+
+#if defined(NX_ARCH_X86_64)
+void xxh3_accumulate_sse2(uint64_t acc[8],
+                          const uint8_t* input,
+                          const uint8_t* secret,
+                          size_t n_stripes);
+void xxh3_scramble_sse2(uint64_t acc[8], const uint8_t* secret);
+
+/**
+ * @brief      requires avx2
+ */
+void xxh3_accumulate_avx2(uint64_t acc[8],
+                          const uint8_t* input,
+                          const uint8_t* secret,
+                          size_t n_stripes);
+void xxh3_scramble_avx2(uint64_t acc[8], const uint8_t* secret);
+#endif
+
+} // namespace nx::digest::detail
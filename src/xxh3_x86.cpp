@@ -0,0 +1,104 @@
+#include "xxh3_impl.h"
+
+#if defined(NX_ARCH_X86_64)
+
+    #include <immintrin.h>
+
+namespace nx::digest::detail {
+
+// Every 64 bit accumulator lane adds the product of the low and high halves
+// of (data ^ key), and the neighbouring lane adds the raw data. The
+// accumulators stay in registers for the whole run of stripes.
+
+void xxh3_accumulate_sse2(uint64_t acc[8],
+                          const uint8_t* input,
+                          const uint8_t* secret,
+                          size_t n_stripes)
+{
+    __m128i a[4];
+    for (int i = 0; i < 4; i++) {
+        a[i] = _mm_loadu_si128((const __m128i*)acc + i);
+    }
+
+    for (size_t n = 0; n < n_stripes; n++) {
+        const __m128i* in = (const __m128i*)(input + n * XXH3_STRIPE_LEN);
+        const __m128i* key = (const __m128i*)(secret + 8 * n);
+        for (int i = 0; i < 4; i++) {
+            __m128i data = _mm_loadu_si128(in + i);
+            __m128i data_key = _mm_xor_si128(data, _mm_loadu_si128(key + i));
+            __m128i product
+                = _mm_mul_epu32(data_key, _mm_srli_epi64(data_key, 32));
+            __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+            a[i] = _mm_add_epi64(a[i], _mm_add_epi64(product, swapped));
+        }
+    }
+
+    for (int i = 0; i < 4; i++) {
+        _mm_storeu_si128((__m128i*)acc + i, a[i]);
+    }
+}
+
+// acc = (acc ^ (acc >> 47) ^ key) * PRIME32_1, the 64x32 bit multiply done
+// as two 32x32 bit halves
+void xxh3_scramble_sse2(uint64_t acc[8], const uint8_t* secret)
+{
+    const __m128i prime = _mm_set1_epi32((int)0x9E3779B1U);
+    for (int i = 0; i < 4; i++) {
+        __m128i a = _mm_loadu_si128((const __m128i*)acc + i);
+        a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+        a = _mm_xor_si128(a, _mm_loadu_si128((const __m128i*)secret + i));
+        __m128i lo = _mm_mul_epu32(a, prime);
+        __m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+        a = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+        _mm_storeu_si128((__m128i*)acc + i, a);
+    }
+}
+
+NX_TARGET("avx2")
+void xxh3_accumulate_avx2(uint64_t acc[8],
+                          const uint8_t* input,
+                          const uint8_t* secret,
+                          size_t n_stripes)
+{
+    __m256i a0 = _mm256_loadu_si256((const __m256i*)acc);
+    __m256i a1 = _mm256_loadu_si256((const __m256i*)acc + 1);
+
+    for (size_t n = 0; n < n_stripes; n++) {
+        const __m256i* in = (const __m256i*)(input + n * XXH3_STRIPE_LEN);
+        const __m256i* key = (const __m256i*)(secret + 8 * n);
+
+        __m256i d0 = _mm256_loadu_si256(in);
+        __m256i d1 = _mm256_loadu_si256(in + 1);
+        __m256i k0 = _mm256_xor_si256(d0, _mm256_loadu_si256(key));
+        __m256i k1 = _mm256_xor_si256(d1, _mm256_loadu_si256(key + 1));
+        __m256i p0 = _mm256_mul_epu32(k0, _mm256_srli_epi64(k0, 32));
+        __m256i p1 = _mm256_mul_epu32(k1, _mm256_srli_epi64(k1, 32));
+        d0 = _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2));
+        d1 = _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2));
+        a0 = _mm256_add_epi64(a0, _mm256_add_epi64(p0, d0));
+        a1 = _mm256_add_epi64(a1, _mm256_add_epi64(p1, d1));
+    }
+
+    _mm256_storeu_si256((__m256i*)acc, a0);
+    _mm256_storeu_si256((__m256i*)acc + 1, a1);
+}
+
+NX_TARGET("avx2")
+void xxh3_scramble_avx2(uint64_t acc[8], const uint8_t* secret)
+{
+    const __m256i prime = _mm256_set1_epi32((int)0x9E3779B1U);
+    for (int i = 0; i < 2; i++) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)acc + i);
+        a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+        a = _mm256_xor_si256(a,
+                             _mm256_loadu_si256((const __m256i*)secret + i));
+        __m256i lo = _mm256_mul_epu32(a, prime);
+        __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+        a = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+        _mm256_storeu_si256((__m256i*)acc + i, a);
+    }
+}
+
+} // namespace nx::digest::detail
+
+#endif
@@ -1,6 +1,104 @@
 #include <gtest/gtest.h>
 #include <nx/alias.h>
 
+namespace {
+
+struct BufferWriter : nx::Write {
+    nx::ByteBuffer data;
+    nx::WriteResult write(const void* buffer, size_t bytes) override
+    {
+        data.insert(data.end(), (uint8_t*)buffer, (uint8_t*)buffer + bytes);
+        return nx::IO_Success { bytes };
+    }
+};
+
+// bytes that do not repeat within 256, the fixture of most tests
+nx::ByteBuffer pattern_bytes(size_t n)
+{
+    nx::ByteBuffer data(n);
+    for (size_t i = 0; i < n; i++) {
+        data[i] = (uint8_t)(i * 131 + 7);
+    }
+    return data;
+}
+
+nx::ByteBuffer compressible(size_t size)
+{
+    nx::ByteBuffer data(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = (uint8_t)("nx compress "[i % 12] + (i / 4096) % 3);
+    }
+    return data;
+}
+
+// read_all in reads of 1 to 16 bytes
+nx::ReadAllResult read_in_pieces(nx::Read& reader)
+{
+    nx::ByteBuffer data;
+    uint8_t buffer[16];
+    for (size_t i = 0;; i++) {
+        auto result = reader.read(buffer, i % 16 + 1);
+        if (result.failed())
+            return result.error();
+        if (result.eof())
+            return data;
+        data.insert(data.end(), buffer, buffer + result.bytes());
+    }
+}
+
+// store under another id and name, as a codec registered by a user
+class CustomCodec : public nx::compress::Codec {
+public:
+    explicit CustomCodec(const char* name)
+    : name_(name)
+    , store_(*nx::compress::find_codec(nx::compress::CodecId::STORE))
+    {
+    }
+
+    nx::compress::CodecId id() const override
+    {
+        return (nx::compress::CodecId)200;
+    }
+    const char* name() const override { return name_; }
+    int default_level() const override { return 0; }
+    int min_level() const override { return 0; }
+    int max_level() const override { return 0; }
+    size_t bound(size_t len) const override { return len; }
+
+    nx::Optional<size_t> compress(const uint8_t* data,
+                                  size_t len,
+                                  uint8_t* out,
+                                  int level) const override
+    {
+        return store_.compress(data, len, out, level);
+    }
+
+    bool decompress(const uint8_t* data,
+                    size_t len,
+                    uint8_t* out,
+                    size_t out_len) const override
+    {
+        return store_.decompress(data, len, out, out_len);
+    }
+
+    nx::UniquePtr<nx::compress::CodecWriter>
+    writer(nx::Write& sink, int level) const override
+    {
+        return store_.writer(sink, level);
+    }
+
+    nx::UniquePtr<nx::Read> reader(nx::Read& source) const override
+    {
+        return store_.reader(source);
+    }
+
+private:
+    const char* name_;
+    const nx::compress::Codec& store_;
+};
+
+} // namespace
+
 TEST(SampleTest, AssertionTrue) { EXPECT_TRUE(true); }
 
 TEST(file_system, read_file) {  
@@ -8,6 +106,334 @@ TEST(file_system, read_file) {
 	EXPECT_EQ(std::get<nx::IO_Error>(result), nx::IO_Error::NOT_OPEN);
 }
 
+TEST(file_system, mapped_file)
+{
+    nx::String path = testing::TempDir() + "nx_mapped_file";
+    auto data = pattern_bytes(100000);
+    {
+        nx::fs::File file(path);
+        ASSERT_TRUE(file.open_write());
+        ASSERT_TRUE(file.write_all(data.data(), data.size()));
+    }
+
+    auto mapped = nx::fs::map_file(path);
+    ASSERT_TRUE(mapped != nullptr);
+    ASSERT_EQ(mapped->size(), data.size());
+    EXPECT_EQ(memcmp(mapped->span().data, data.data(), data.size()), 0);
+    EXPECT_TRUE(mapped->advise(nx::fs::MapAdvice::SEQUENTIAL));
+    EXPECT_TRUE(mapped->advise(nx::fs::MapAdvice::WILL_NEED, 5000, 100));
+
+    auto all = mapped->read_all();
+    EXPECT_EQ(std::get<nx::ByteBuffer>(all), data);
+
+    mapped->close();
+    EXPECT_TRUE(std::holds_alternative<nx::IO_Error>(mapped->read_all()));
+    EXPECT_EQ(nx::fs::map_file("/no_such_file"), nullptr);
+    remove(path.c_str());
+}
+
+TEST(file_system, size_hint)
+{
+    nx::String path = testing::TempDir() + "nx_size_hint";
+    nx::ByteBuffer data(5000, 42);
+    {
+        nx::fs::File file(path);
+        ASSERT_TRUE(file.open_write());
+        EXPECT_FALSE(file.size_hint());
+        ASSERT_TRUE(file.write_all(data.data(), data.size()));
+    }
+
+    nx::fs::File file(path);
+    ASSERT_TRUE(file.open_read());
+    EXPECT_EQ(file.size_hint(), 5000u);
+    uint8_t head[100];
+    ASSERT_TRUE(file.read_exact(head, sizeof(head)));
+    EXPECT_EQ(file.size_hint(), 4900u);
+    EXPECT_EQ(std::get<nx::ByteBuffer>(file.read_all()).size(), 4900u);
+
+    EXPECT_EQ(std::get<nx::ByteBuffer>(nx::fs::read_file(path)), data);
+
+    nx::MemoryFile memory(data.data(), 300);
+    EXPECT_EQ(memory.size_hint(), 300u);
+    remove(path.c_str());
+}
+
+TEST(file_system, positional_io)
+{
+    nx::String path = testing::TempDir() + "nx_positional_io";
+    {
+        nx::fs::File file(path);
+        ASSERT_TRUE(file.open_write());
+        ASSERT_TRUE(file.write_all("0123456789", 10));
+        auto r = file.write_at(20, "xyz", 3);
+        EXPECT_EQ(r.bytes(), 3u);
+        nx::ByteSpan parts[] = { { (const uint8_t*)"ab", 2 },
+                                 { (const uint8_t*)"cde", 3 } };
+        r = file.writev(2, parts, 2);
+        EXPECT_EQ(r.bytes(), 5u);
+        EXPECT_EQ(file.size(), 23u);
+    }
+
+    nx::fs::File file(path);
+    ASSERT_TRUE(file.open_read());
+    EXPECT_EQ(file.size(), 23u);
+    EXPECT_TRUE(file.write_at(0, "", 0).failed());
+
+    char buf[8] = {};
+    auto r = file.read_at(1, buf, 6);
+    EXPECT_EQ(r.bytes(), 6u);
+    EXPECT_EQ(memcmp(buf, "1abcde", 6), 0);
+    r = file.read_at(20, buf, 8);
+    EXPECT_EQ(r.bytes(), 3u);
+    r = file.read_at(23, buf, 8);
+    EXPECT_TRUE(r.eof());
+
+    // the read position is not touched, the gap reads as zeros
+    uint8_t a[3], b[12];
+    nx::MutableByteSpan parts[] = { { a, sizeof(a) }, { b, sizeof(b) } };
+    r = file.readv(8, parts, 2);
+    EXPECT_EQ(r.bytes(), 15u);
+    EXPECT_EQ(memcmp(a, "89\0", 3), 0);
+    EXPECT_EQ(memcmp(b + 9, "xyz", 3), 0);
+    EXPECT_EQ(std::get<nx::ByteBuffer>(file.read_all()).size(), 23u);
+    remove(path.c_str());
+}
+
+TEST(file_system, async_reader)
+{
+    nx::String dir = testing::TempDir();
+    nx::Vector<nx::String> paths;
+    for (int i = 0; i < 20; i++) {
+        paths.push_back(dir + "nx_async_" + std::to_string(i));
+        nx::fs::File file(paths.back());
+        ASSERT_TRUE(file.open_write());
+        nx::String data(i * 1000, (char)('a' + i));
+        ASSERT_TRUE(file.write_all(data.data(), data.size()));
+    }
+    paths.push_back(dir + "nx_async_missing");
+
+    for (auto backend : { nx::fs::AsyncBackend::AUTO,
+                          nx::fs::AsyncBackend::THREADS }) {
+        nx::fs::AsyncReader reader(backend, 4);
+        if (backend == nx::fs::AsyncBackend::THREADS) {
+            EXPECT_EQ(reader.backend(), nx::fs::AsyncBackend::THREADS);
+        }
+
+        nx::Vector<nx::ReadAllResult> results(paths.size());
+        for (size_t i = 0; i < paths.size(); i++) {
+            reader.submit({ paths[i],
+                            -1,
+                            0,
+                            nx::fs::WHOLE_FILE,
+                            [&results, i](nx::ReadAllResult&& result) {
+                                results[i] = std::move(result);
+                            } });
+        }
+
+        // a range past the end is cut short, an fd is read in place
+        nx::ByteBuffer range, by_fd;
+        reader.submit({ paths[3], -1, 2990, 100,
+                        [&](nx::ReadAllResult&& result) {
+                            range = std::get<nx::ByteBuffer>(result);
+                        } });
+        FILE* fp = fopen(paths[5].c_str(), "rb");
+        ASSERT_NE(fp, nullptr);
+        reader.submit({ "", fileno(fp), 4000, nx::fs::WHOLE_FILE,
+                        [&](nx::ReadAllResult&& result) {
+                            by_fd = std::get<nx::ByteBuffer>(result);
+                        } });
+        reader.wait();
+        fclose(fp);
+
+        for (size_t i = 0; i < 20; i++) {
+            auto& data = std::get<nx::ByteBuffer>(results[i]);
+            EXPECT_EQ(data, nx::ByteBuffer(i * 1000, (uint8_t)('a' + i)));
+        }
+        EXPECT_EQ(std::get<nx::IO_Error>(results[20]),
+                  nx::IO_Error::NOT_OPEN);
+        EXPECT_EQ(range, nx::ByteBuffer(10, 'd'));
+        EXPECT_EQ(by_fd, nx::ByteBuffer(1000, 'f'));
+    }
+
+    auto results = nx::fs::read_files(paths);
+    EXPECT_EQ(std::get<nx::ByteBuffer>(results[7]).size(), 7000u);
+    for (auto& path : paths) {
+        remove(path.c_str());
+    }
+}
+
+TEST(file_system, copy_file)
+{
+    nx::String from = testing::TempDir() + "nx_copy_from";
+    nx::String to = testing::TempDir() + "nx_copy_to";
+    nx::ByteBuffer data(300 * 1024 + 7);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = (uint8_t)(i * 131 + (i >> 9));
+    }
+    {
+        nx::fs::File file(from);
+        ASSERT_TRUE(file.open_write());
+        ASSERT_TRUE(file.write_all(data.data(), data.size()));
+    }
+
+    ASSERT_TRUE(nx::fs::copy_file(from, to));
+    EXPECT_EQ(std::get<nx::ByteBuffer>(nx::fs::read_file(to)), data);
+    EXPECT_FALSE(nx::fs::copy_file(from + "_missing", to));
+
+    // copying continues from both stream positions, buffered data included
+    {
+        nx::fs::File source(from);
+        nx::fs::File sink(to);
+        ASSERT_TRUE(source.open_read() && sink.open_write());
+        char head[10];
+        ASSERT_TRUE(source.read_exact(head, sizeof(head)));
+        ASSERT_TRUE(sink.write_all("hello", 5));
+        ASSERT_TRUE(nx::pipe(source, sink));
+        EXPECT_EQ(source.size_hint(), 0u);
+        ASSERT_TRUE(sink.write_all("!", 1));
+    }
+    auto copied = std::get<nx::ByteBuffer>(nx::fs::read_file(to));
+    nx::ByteBuffer expected(data.begin() + 10, data.end());
+    expected.insert(expected.begin(), { 'h', 'e', 'l', 'l', 'o' });
+    expected.push_back('!');
+    EXPECT_EQ(copied, expected);
+
+    // a small buffer through readers without a file
+    nx::MemoryFile memory(data.data(), data.size());
+    nx::fs::File sink(to);
+    ASSERT_TRUE(sink.open_write());
+    ASSERT_TRUE(nx::pipe(memory, sink, 1000));
+    sink.close();
+    EXPECT_EQ(std::get<nx::ByteBuffer>(nx::fs::read_file(to)), data);
+    remove(from.c_str());
+    remove(to.c_str());
+}
+
+TEST(type, io_result)
+{
+    static_assert(std::is_trivially_copyable_v<nx::IoResult>);
+    static_assert(sizeof(nx::IoResult) == sizeof(int64_t));
+
+    nx::ReadResult bytes = nx::IO_Success { 42 };
+    EXPECT_TRUE(bytes.ok());
+    EXPECT_EQ(bytes.bytes(), 42u);
+
+    nx::ReadResult eof = nx::EndOfFile {};
+    EXPECT_TRUE(eof.eof() && !eof.ok() && !eof.failed());
+    EXPECT_EQ(eof.bytes(), 0u);
+
+    nx::WriteResult error = nx::IO_Error::IO_FAIL;
+    EXPECT_TRUE(error.failed());
+    EXPECT_EQ(error.error(), nx::IO_Error::IO_FAIL);
+    EXPECT_EQ(nx::IoResult(nx::IO_Error::NOT_OPEN).error(),
+              nx::IO_Error::NOT_OPEN);
+
+    // to and from the variants
+    nx::ReadVariant variant = bytes;
+    EXPECT_EQ(std::get<nx::IO_Success>(variant).bytes, 42u);
+    variant = eof;
+    EXPECT_TRUE(std::holds_alternative<nx::EndOfFile>(variant));
+    nx::WriteVariant write_variant = error;
+    EXPECT_EQ(std::get<nx::IO_Error>(write_variant), nx::IO_Error::IO_FAIL);
+    EXPECT_EQ(nx::IoResult(variant), eof);
+    EXPECT_EQ(nx::IoResult(write_variant), error);
+}
+
+TEST(type, buffered_reader)
+{
+    const char text[] = "first\r\nsecond\n\nlast";
+    nx::MemoryFile memory((const uint8_t*)text, sizeof(text) - 1);
+    nx::BufferedReader reader(memory, 4);
+
+    auto peek = std::get<nx::ByteSpan>(reader.peek(3));
+    EXPECT_EQ(nx::String((const char*)peek.data, peek.size), "fir");
+    EXPECT_EQ(reader.size_hint(), sizeof(text) - 1);
+
+    // lines longer than the buffer, reusing one string
+    nx::String line;
+    nx::Vector<nx::String> lines;
+    while (reader.read_line(line).ok()) {
+        lines.push_back(line);
+    }
+    nx::Vector<nx::String> expected = { "first", "second", "", "last" };
+    EXPECT_EQ(lines, expected);
+    EXPECT_EQ(std::get<nx::ByteSpan>(reader.peek(4)).size, 0u);
+
+    nx::MemoryFile again((const uint8_t*)text, sizeof(text) - 1);
+    nx::BufferedReader other(again, 8);
+    nx::ByteBuffer until;
+    auto result = other.read_until('d', until);
+    EXPECT_EQ(result.bytes(), 13u);
+    char rest[32];
+    EXPECT_TRUE(other.read_exact(rest, 6));
+    EXPECT_EQ(memcmp(rest, "\n\nlast", 6), 0);
+}
+
+TEST(type, buffered_writer)
+{
+    nx::String path = testing::TempDir() + "nx_buffered_writer";
+    {
+        nx::fs::File file(path);
+        ASSERT_TRUE(file.open_write());
+        nx::BufferedWriter writer(file, 16);
+        for (int i = 0; i < 100; i++) {
+            ASSERT_TRUE(writer.write_all("line\n", 5));
+        }
+        // larger than the buffer, written through
+        nx::String big(40, 'x');
+        ASSERT_TRUE(writer.write_all(big.data(), big.size()));
+        ASSERT_TRUE(writer.write_all("end", 3));
+        EXPECT_TRUE(writer.flush());
+    }
+
+    auto data = std::get<nx::ByteBuffer>(nx::fs::read_file(path));
+    EXPECT_EQ(data.size(), 543u);
+    EXPECT_EQ(nx::String(data.end() - 8, data.end()), "xxxxxend");
+    remove(path.c_str());
+}
+
+TEST(type, prefetch_reader)
+{
+    nx::ByteBuffer data(100 * 1000 + 3);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+
+    {
+        nx::MemoryFile memory(data.data(), data.size());
+        nx::PrefetchReader reader(memory, 3, 1000);
+        EXPECT_EQ(reader.size_hint(), data.size());
+        EXPECT_EQ(std::get<nx::ByteBuffer>(reader.read_all()), data);
+        EXPECT_EQ(reader.size_hint(), 0u);
+    }
+
+    // stopped early, with the ring full
+    {
+        nx::MemoryFile memory(data.data(), data.size());
+        nx::PrefetchReader reader(memory, 2, 64);
+        uint8_t head[100];
+        ASSERT_TRUE(reader.read_exact(head, sizeof(head)));
+        EXPECT_EQ(memcmp(head, data.data(), sizeof(head)), 0);
+    }
+
+    // errors reach the consumer after the data before them
+    struct Failing : nx::Read {
+        int calls = 0;
+        nx::ReadResult read(void* buffer, size_t bytes) override
+        {
+            if (calls++ == 2)
+                return nx::IO_Error::IO_FAIL;
+            memset(buffer, 'a', bytes);
+            return nx::IO_Success { bytes };
+        }
+    } failing;
+    nx::PrefetchReader reader(failing, 2, 10);
+    char buffer[25];
+    EXPECT_EQ(reader.read(buffer, 25).bytes(), 10u);
+    EXPECT_EQ(reader.read(buffer, 25).bytes(), 10u);
+    EXPECT_TRUE(reader.read(buffer, 25).failed());
+}
+
 TEST(math, ceil_pow2) {  
 	EXPECT_EQ(nx::ceil_pow2(0u), 0);
 	EXPECT_EQ(nx::ceil_pow2(1u), 1);
@@ -30,8 +456,532 @@ TEST(digest, sha256)
         "853ff93762a06ddbf722c4ebe9ddd66d8f63ddaea97f521c3ecc20da7c976020");
 }
 
+TEST(digest, sha256_long)
+{
+    auto data = pattern_bytes(1000);
+    EXPECT_EQ(
+        nx::sha256(data.data(), data.size()),
+        "533b698850849b7908b20a22658f639c0b2a476f1791f85f50188287c31a9aba");
+}
+
+TEST(digest, hash_stream)
+{
+    // larger than the stream buffer, not a whole number of blocks
+    auto data = pattern_bytes(3000017);
+    const char* sha256_hex
+        = "2e3ec7bf27e02e67285b67d795cc2512496166e2731ae6122b892c6371401cdd";
+    const char* md5_hex = "1586bf902796e09e261ed6bb0a5e34b4";
+
+    nx::MemoryFile file(data.data(), data.size());
+    EXPECT_EQ(nx::sha256_digest(file)->to_hex(), sha256_hex);
+    nx::MemoryFile file2(data.data(), data.size());
+    EXPECT_EQ(nx::md5_digest(file2)->to_hex(), md5_hex);
+
+    // short and empty streams get a buffer of their size
+    nx::MemoryFile short_file(data.data(), 1000);
+    EXPECT_EQ(nx::sha256_digest(short_file)->to_hex(),
+              nx::sha256(data.data(), 1000));
+    nx::MemoryFile empty_file(data.data(), 0);
+    EXPECT_EQ(nx::md5_digest(empty_file)->to_hex(),
+              "d41d8cd98f00b204e9800998ecf8427e");
+
+    // uneven updates straddling block boundaries
+    nx::SHA256 sha256;
+    nx::MD5 md5;
+    size_t pos = 0;
+    for (size_t step = 1; pos < data.size(); step = step * 3 + 1) {
+        size_t n = std::min(step % 100000, data.size() - pos);
+        sha256.update(data.data() + pos, n);
+        md5.update(data.data() + pos, n);
+        pos += n;
+    }
+    EXPECT_EQ(sha256.finish().to_hex(), sha256_hex);
+    EXPECT_EQ(md5.finish().to_hex(), md5_hex);
+}
+
+TEST(digest, hash_many)
+{
+    auto data = pattern_bytes(20000);
+
+    nx::Vector<nx::ByteSpan> inputs;
+    for (size_t len = 0; len < 300; len += 7) {
+        inputs.push_back({ data.data() + len, len });
+    }
+    inputs.push_back({ data.data(), data.size() });
+    inputs.push_back({ data.data() + 5, 4096 });
+
+    auto to_hex = [](const uint8_t* digest, size_t len) {
+        nx::String hex;
+        char buf[3];
+        for (size_t i = 0; i < len; i++) {
+            snprintf(buf, sizeof(buf), "%02x", digest[i]);
+            hex += buf;
+        }
+        return hex;
+    };
+
+    for (size_t threads : { 1, 3 }) {
+        nx::Vector<uint8_t> md5_digests(inputs.size() * 16);
+        nx::Vector<uint8_t> sha256_digests(inputs.size() * 32);
+        nx::md5_many(
+            inputs.data(), inputs.size(), md5_digests.data(), threads);
+        nx::sha256_many(
+            inputs.data(), inputs.size(), sha256_digests.data(), threads);
+
+        for (size_t i = 0; i < inputs.size(); i++) {
+            EXPECT_EQ(to_hex(&md5_digests[16 * i], 16),
+                      nx::md5(inputs[i].data, inputs[i].size));
+            EXPECT_EQ(to_hex(&sha256_digests[32 * i], 32),
+                      nx::sha256(inputs[i].data, inputs[i].size));
+        }
+    }
+}
+
+TEST(digest, digest_value)
+{
+    auto a = nx::sha256_digest("hello");
+    auto b = nx::sha256_digest((const uint8_t*)"hello", 5);
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a, nx::sha256_digest("hellp"));
+    EXPECT_EQ(
+        a.to_hex(),
+        "2cf24dba5fb0a30e26e83b2ac5b9e29e1b161e5c1fa7425e73043362938b9824");
+    EXPECT_EQ(nx::md5_digest("hello").to_hex(), nx::md5("hello"));
+
+    std::unordered_map<nx::Md5Digest, int> cache;
+    cache[nx::md5_digest("a")] = 1;
+    cache[nx::md5_digest("b")] = 2;
+    EXPECT_EQ(cache.at(nx::md5_digest("b")), 2);
+    EXPECT_EQ(cache.count(nx::md5_digest("c")), 0u);
+
+    nx::ByteSpan inputs[2] = { { (const uint8_t*)"a", 1 },
+                               { (const uint8_t*)"b", 1 } };
+    nx::Md5Digest digests[2];
+    nx::md5_many(inputs, 2, digests);
+    EXPECT_EQ(digests[1], nx::md5_digest("b"));
+}
+
 TEST(digest, crc32) { EXPECT_EQ(nx::crc32("hello, world"), 0xffab723a); }
 
+TEST(digest, crc32_long)
+{
+    EXPECT_EQ(nx::crc32("123456789"), 0xcbf43926);
+
+    auto data = pattern_bytes(4099);
+    EXPECT_EQ(nx::crc32(data.data(), data.size()), 0xdfade85a);
+
+    for (size_t split : { 0, 1, 15, 16, 63, 64, 65, 1000, 4099 }) {
+        nx::CRC32 crc;
+        crc.update(data.data(), split);
+        crc.update(data.data() + split, data.size() - split);
+        EXPECT_EQ(crc.get_value(), 0xdfade85a);
+    }
+}
+
+TEST(digest, crc32_combine)
+{
+    auto data = pattern_bytes(3 * 1024 * 1024 + 17);
+    uint32_t expected = nx::crc32(data.data(), data.size());
+
+    for (size_t split : { (size_t)0, (size_t)1, (size_t)100, data.size() }) {
+        uint32_t a = nx::crc32(data.data(), split);
+        uint32_t b = nx::crc32(data.data() + split, data.size() - split);
+        EXPECT_EQ(nx::crc32_combine(a, b, data.size() - split), expected);
+    }
+
+    EXPECT_EQ(nx::parallel_crc32(data.data(), data.size(), 3), expected);
+    EXPECT_EQ(nx::parallel_crc32(data.data(), data.size()), expected);
+}
+
+TEST(digest, crc32c)
+{
+    EXPECT_EQ(nx::crc32c("123456789"), 0xe3069283);
+
+    auto data = pattern_bytes(100003);
+    EXPECT_EQ(nx::crc32c(data.data(), data.size()), 0xf39d33b7);
+
+    for (size_t split : { 0, 3, 777, 30000 }) {
+        nx::CRC32C crc;
+        crc.update(data.data(), split);
+        crc.update(data.data() + split, data.size() - split);
+        EXPECT_EQ(crc.get_value(), 0xf39d33b7);
+    }
+}
+
+TEST(digest, xxh3)
+{
+    EXPECT_EQ(nx::xxh3_64((const uint8_t*)"hello, world", 12),
+              0x302cd5fba73d006cull);
+    auto h = nx::xxh3_128((const uint8_t*)"hello, world", 12);
+    EXPECT_EQ(h.high64, 0x11c83d9c1ee36816ull);
+    EXPECT_EQ(h.low64, 0x4c0abe17b55db69cull);
+
+    auto data = pattern_bytes(5000);
+    EXPECT_EQ(nx::xxh3_64(data.data(), data.size()), 0xe4007929540f095cull);
+    EXPECT_EQ(nx::xxh3_64(data.data(), 200, 42), 0x64b909d01384cf14ull);
+    EXPECT_EQ(nx::xxh3_64(data.data(), data.size(), 42),
+              0xa25f97afc34a44faull);
+    EXPECT_EQ(nx::xxh3_128(data.data(), data.size(), 42),
+              (nx::Hash128 { 0xa25f97afc34a44faull, 0x335d228333a96dc1ull }));
+
+    // streaming in uneven pieces gives the one-shot value at every length
+    for (size_t len : { 0, 100, 240, 241, 1024, 1025, 5000 }) {
+        nx::XXH3 xxh3(42);
+        for (size_t pos = 0, step = 1; pos < len; step = step * 5 % 311) {
+            size_t n = std::min(step, len - pos);
+            xxh3.update(data.data() + pos, n);
+            pos += n;
+        }
+        EXPECT_EQ(xxh3.finish(), nx::xxh3_64(data.data(), len, 42));
+        EXPECT_EQ(xxh3.finish_128(), nx::xxh3_128(data.data(), len, 42));
+    }
+}
+
+TEST(digest, blake3)
+{
+    EXPECT_EQ(nx::blake3(""),
+              "af1349b9f5f9a1a6a0404dea36dcc949"
+              "9bcb25c9adc112b7cc9a93cae41f3262");
+    EXPECT_EQ(nx::blake3("hello, world"),
+              "a1a55887535397bf461902491c877918"
+              "8a5dd1f8c3951b3d9cf6ecba194e87b0");
+
+    // large enough for every simd kernel and for splitting across threads
+    auto data = pattern_bytes(2097169);
+    const char* expect = "7dd3a052f8851487085ada25a25289d1"
+                         "99825578b772ffd1887572c7d94a8ca7";
+    EXPECT_EQ(nx::blake3(data.data(), data.size()), expect);
+    EXPECT_EQ(nx::parallel_blake3(data.data(), data.size(), 3).to_hex(),
+              expect);
+
+    nx::BLAKE3 blake3;
+    for (size_t pos = 0, step = 1; pos < data.size(); step = step * 7 % 9973) {
+        size_t n = std::min(step, data.size() - pos);
+        blake3.update(data.data() + pos, n);
+        pos += n;
+    }
+    EXPECT_EQ(blake3.finish().to_hex(), expect);
+
+    // extendable output, the digest is its first 32 bytes
+    nx::BLAKE3 xof;
+    xof.update(data.data(), 5000);
+    uint8_t out[40];
+    xof.finish(out, sizeof(out));
+    EXPECT_EQ(nx::hex_encode(out, sizeof(out)),
+              "95e02bdb5a4281ea7d08d8754ecbad60334a07abf371f44b"
+              "ef88e3b78bb1c6a8c48b89f6be31ae93");
+}
+
+TEST(hex, encode_decode)
+{
+    // long enough for the simd blocks and a scalar tail
+    auto data = pattern_bytes(1000);
+    for (size_t len : { 0, 1, 15, 16, 33, 100, 1000 }) {
+        nx::ByteBuffer input(data.begin(), data.begin() + len);
+        nx::String hex = nx::hex_encode(input);
+        ASSERT_EQ(hex.size(), 2 * len);
+        for (size_t i = 0; i < len; i++) {
+            char expect[3];
+            snprintf(expect, sizeof(expect), "%02x", input[i]);
+            ASSERT_EQ(hex.substr(2 * i, 2), expect);
+        }
+        auto decoded = nx::hex_decode(hex);
+        ASSERT_EQ(std::get<nx::ByteBuffer>(decoded), input);
+    }
+
+    auto mixed = nx::hex_decode("DEADbeef");
+    EXPECT_EQ(std::get<nx::ByteBuffer>(mixed),
+              (nx::ByteBuffer { 0xde, 0xad, 0xbe, 0xef }));
+
+    nx::String hex = nx::hex_encode(data);
+    for (size_t pos : { 0, 5, 63, 64, 130, 1999 }) {
+        nx::String bad = hex;
+        bad[pos] = 'g';
+        auto result = nx::hex_decode(bad);
+        EXPECT_EQ(std::get<nx::HexError>(result).position, pos);
+    }
+    EXPECT_EQ(std::get<nx::HexError>(nx::hex_decode("abc")).position, 3u);
+
+    auto digest = nx::sha256_digest("hello");
+    auto parsed = nx::Sha256Digest::from_hex(digest.to_hex().data(), 64);
+    EXPECT_EQ(parsed, digest);
+    EXPECT_FALSE(nx::Md5Digest::from_hex("abcd", 4));
+}
+
+#if defined(USE_ZLIB)
+
+TEST(compress, zlib)
+{
+    auto data = compressible(200 * 1000);
+    auto packed = nx::zlib_compress(data.data(), data.size());
+    ASSERT_FALSE(packed.empty());
+    EXPECT_LT(packed.size(), data.size() / 10);
+
+    EXPECT_EQ(nx::zlib_uncompress(packed.data(), packed.size()), data);
+    EXPECT_EQ(nx::zlib_uncompress(packed.data(), packed.size(), data.size()),
+              data);
+    EXPECT_EQ(nx::zlib_uncompress(packed.data(), packed.size(), 10), data);
+    EXPECT_TRUE(nx::zlib_uncompress(packed.data(), packed.size() - 5).empty());
+    EXPECT_TRUE(nx::zlib_uncompress(data.data(), 100).empty());
+
+    // levels out of range are clamped
+    packed = nx::zlib_compress(data.data(), data.size(), 12);
+    EXPECT_EQ(packed, nx::zlib_compress(data.data(), data.size(), 9));
+}
+
+TEST(compress, deflate_stream)
+{
+    auto data = compressible(300 * 1000 + 11);
+    for (auto format : { nx::DeflateFormat::ZLIB,
+                         nx::DeflateFormat::GZIP,
+                         nx::DeflateFormat::RAW }) {
+        BufferWriter packed;
+        {
+            nx::MemoryFile source(data.data(), data.size());
+            nx::DeflateWriter writer(packed, 6, format, 1000);
+            ASSERT_TRUE(nx::pipe(source, writer, 777));
+            // everything so far can be read before the end of the stream
+            ASSERT_TRUE(writer.flush());
+            ASSERT_TRUE(writer.write_all("tail", 4));
+        }
+
+        nx::MemoryFile source(packed.data.data(), packed.data.size());
+        nx::InflateReader reader(source, format, 500);
+        auto unpacked = std::get<nx::ByteBuffer>(reader.read_all());
+        ASSERT_EQ(unpacked.size(), data.size() + 4);
+        EXPECT_TRUE(std::equal(data.begin(), data.end(), unpacked.begin()));
+
+        if (format == nx::DeflateFormat::ZLIB) {
+            auto one_shot = nx::zlib_uncompress(packed.data.data(),
+                                                packed.data.size());
+            EXPECT_EQ(one_shot, unpacked);
+        }
+
+        // truncated data is an error, not an early end
+        nx::MemoryFile cut(packed.data.data(), packed.data.size() / 2);
+        nx::InflateReader broken(cut, format);
+        EXPECT_TRUE(std::holds_alternative<nx::IO_Error>(broken.read_all()));
+    }
+
+    // gzip members one after the other read as one stream
+    BufferWriter members;
+    for (int i = 0; i < 2; i++) {
+        nx::DeflateWriter writer(members, 1, nx::DeflateFormat::GZIP);
+        ASSERT_TRUE(writer.write_all(data.data(), 1000));
+    }
+    nx::MemoryFile source(members.data.data(), members.data.size());
+    nx::InflateReader reader(source, nx::DeflateFormat::GZIP);
+    EXPECT_EQ(std::get<nx::ByteBuffer>(reader.read_all()).size(), 2000u);
+
+    // levels out of range are clamped
+    BufferWriter clamped;
+    {
+        nx::DeflateWriter writer(clamped, 12);
+        ASSERT_TRUE(writer.write_all(data.data(), 1000));
+    }
+    EXPECT_EQ(nx::zlib_uncompress(clamped.data.data(), clamped.data.size()),
+              nx::ByteBuffer(data.begin(), data.begin() + 1000));
+}
+
+TEST(compress, parallel_compress)
+{
+    auto data = compressible(1000 * 1000 + 123);
+    nx::ParallelCompressOptions options;
+    options.threads = 3;
+    options.block_size = 64 * 1024;
+    // small enough for several batches
+    options.memory_limit = 3 * 384 * 1024 + 4 * 70 * 1024;
+
+    options.format = nx::DeflateFormat::ZLIB;
+    auto packed = nx::parallel_compress(data.data(), data.size(), options);
+    EXPECT_EQ(nx::zlib_uncompress(packed.data(), packed.size()), data);
+    // priming keeps the ratio close to one stream
+    auto single = nx::zlib_compress(data.data(), data.size());
+    EXPECT_LT(packed.size(), single.size() + single.size() / 10 + 200);
+
+    for (auto format : { nx::DeflateFormat::GZIP, nx::DeflateFormat::RAW }) {
+        options.format = format;
+        packed = nx::parallel_compress(data.data(), data.size(), options);
+        nx::MemoryFile source(packed.data(), packed.size());
+        nx::InflateReader reader(source, format);
+        EXPECT_EQ(std::get<nx::ByteBuffer>(reader.read_all()), data);
+    }
+
+    options.format = nx::DeflateFormat::ZLIB;
+    options.level = 0;
+    packed = nx::parallel_compress(data.data(), 1000, options);
+    EXPECT_EQ(nx::zlib_uncompress(packed.data(), packed.size()),
+              nx::ByteBuffer(data.begin(), data.begin() + 1000));
+    packed = nx::parallel_compress(nullptr, 0, options);
+    EXPECT_TRUE(nx::zlib_uncompress(packed.data(), packed.size()).empty());
+    EXPECT_FALSE(packed.empty());
+
+    options.level = 42;
+    packed = nx::parallel_compress(data.data(), data.size(), options);
+    EXPECT_EQ(nx::zlib_uncompress(packed.data(), packed.size()), data);
+
+    // the default gzip output reads back in one call too
+    packed = nx::parallel_compress(data.data(), data.size());
+    EXPECT_EQ(packed[0], 0x1f);
+    EXPECT_EQ(nx::zlib_uncompress(packed.data(), packed.size()), data);
+}
+
+#endif
+
+TEST(compress, codec)
+{
+    auto data = compressible(300 * 1000 + 7);
+    EXPECT_EQ(nx::compress::find_codec("none"), nullptr);
+    ASSERT_NE(nx::compress::find_codec("store"), nullptr);
+#if defined(USE_ZLIB)
+    EXPECT_NE(nx::compress::find_codec(nx::compress::CodecId::ZLIB), nullptr);
+#endif
+#if defined(USE_LZ4)
+    EXPECT_NE(nx::compress::find_codec(nx::compress::CodecId::LZ4), nullptr);
+#endif
+#if defined(USE_ZSTD)
+    EXPECT_NE(nx::compress::find_codec(nx::compress::CodecId::ZSTD), nullptr);
+#endif
+
+    for (auto* codec : nx::compress::codecs()) {
+        EXPECT_EQ(nx::compress::find_codec(codec->name()), codec);
+        for (int level : { -1, codec->min_level(), codec->max_level() }) {
+            auto frame = nx::compress::encode(
+                *codec, data.data(), data.size(), level);
+            ASSERT_GT(frame.size(), nx::compress::FRAME_HEADER_SIZE);
+            if (level == -1 && codec->id() != nx::compress::CodecId::STORE) {
+                EXPECT_LT(frame.size(), data.size() / 5);
+            }
+            auto decoded = nx::compress::decode(frame.data(), frame.size());
+            EXPECT_EQ(std::get<nx::ByteBuffer>(decoded), data);
+
+            frame.pop_back();
+            decoded = nx::compress::decode(frame.data(), frame.size());
+            EXPECT_TRUE(std::holds_alternative<nx::IO_Error>(decoded));
+        }
+
+        // a forged raw size is refused before the output is allocated
+        auto forged = nx::compress::encode(*codec, data.data(), 1000);
+        forged[8 + 5] = 0x10;
+        auto decoded = nx::compress::decode(forged.data(), forged.size());
+        EXPECT_TRUE(std::holds_alternative<nx::IO_Error>(decoded));
+
+        auto empty = nx::compress::encode(*codec, nullptr, 0);
+        decoded = nx::compress::decode(empty.data(), empty.size());
+        EXPECT_TRUE(std::get<nx::ByteBuffer>(decoded).empty());
+
+        BufferWriter packed;
+        {
+            nx::MemoryFile source(data.data(), data.size());
+            auto writer = nx::compress::frame_writer(packed, *codec);
+            ASSERT_TRUE(writer != nullptr);
+            ASSERT_TRUE(nx::pipe(source, *writer, 1000));
+            ASSERT_TRUE(writer->finish());
+        }
+        decoded = nx::compress::decode(packed.data.data(), packed.data.size());
+        EXPECT_EQ(std::get<nx::ByteBuffer>(decoded), data);
+
+        nx::MemoryFile source(packed.data.data(), packed.data.size());
+        auto reader = nx::compress::frame_reader(source);
+        ASSERT_TRUE(reader != nullptr);
+        EXPECT_EQ(std::get<nx::ByteBuffer>(reader->read_all()), data);
+    }
+
+    const uint8_t junk[nx::compress::FRAME_HEADER_SIZE] = { 'N', 'X' };
+    auto decoded = nx::compress::decode(junk, sizeof(junk));
+    EXPECT_TRUE(std::holds_alternative<nx::IO_Error>(decoded));
+    nx::MemoryFile source(junk, sizeof(junk));
+    EXPECT_EQ(nx::compress::frame_reader(source), nullptr);
+
+    // small reads drain what the decoder holds past the end of the input
+    auto large = compressible(4 * 1000 * 1000);
+    for (auto* codec : nx::compress::codecs()) {
+        BufferWriter packed;
+        {
+            auto writer = nx::compress::frame_writer(packed, *codec);
+            ASSERT_TRUE(writer->write_all(large.data(), large.size()));
+        }
+        nx::MemoryFile source(packed.data.data(), packed.data.size());
+        auto reader = nx::compress::frame_reader(source);
+        ASSERT_TRUE(reader != nullptr);
+        EXPECT_EQ(std::get<nx::ByteBuffer>(read_in_pieces(*reader)), large)
+            << codec->name();
+    }
+
+    // a replaced codec stays usable
+    nx::compress::register_codec(std::make_unique<CustomCodec>("first"));
+    auto* first = nx::compress::find_codec("first");
+    ASSERT_NE(first, nullptr);
+    nx::compress::register_codec(std::make_unique<CustomCodec>("second"));
+    EXPECT_EQ(nx::compress::find_codec("first"), nullptr);
+    EXPECT_NE(nx::compress::find_codec("second"), nullptr);
+    auto frame = nx::compress::encode(*first, data.data(), data.size());
+    decoded = nx::compress::decode(frame.data(), frame.size());
+    EXPECT_EQ(std::get<nx::ByteBuffer>(decoded), data);
+}
+
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+
+namespace {
+
+// one shot, streaming, truncated and back to back frames of one backend
+void codec_round_trip(nx::compress::CodecId id)
+{
+    auto* codec = nx::compress::find_codec(id);
+    ASSERT_NE(codec, nullptr);
+    auto data = compressible(1000 * 1000 + 3);
+
+    for (int level : { codec->min_level(), -1, codec->max_level() }) {
+        auto frame
+            = nx::compress::encode(*codec, data.data(), data.size(), level);
+        EXPECT_LT(frame.size(), data.size() / 5);
+        auto decoded = nx::compress::decode(frame.data(), frame.size());
+        EXPECT_EQ(std::get<nx::ByteBuffer>(decoded), data);
+    }
+
+    // two streams written one after the other read as one
+    BufferWriter packed;
+    for (int i = 0; i < 2; i++) {
+        auto writer = codec->writer(packed, codec->default_level());
+        ASSERT_TRUE(writer->write_all(data.data(), data.size()));
+        ASSERT_TRUE(writer->finish());
+    }
+    nx::MemoryFile source(packed.data.data(), packed.data.size());
+    auto reader = codec->reader(source);
+    auto both = std::get<nx::ByteBuffer>(reader->read_all());
+    ASSERT_EQ(both.size(), 2 * data.size());
+    EXPECT_TRUE(std::equal(data.begin(), data.end(), both.begin()));
+    EXPECT_TRUE(
+        std::equal(data.begin(), data.end(), both.begin() + data.size()));
+
+    // a stream cut short is an error, not an early end
+    for (size_t cut : { packed.data.size() / 4, packed.data.size() / 2 - 1 }) {
+        nx::MemoryFile truncated(packed.data.data(), cut);
+        auto broken = codec->reader(truncated);
+        EXPECT_TRUE(std::holds_alternative<nx::IO_Error>(broken->read_all()));
+        nx::MemoryFile again(packed.data.data(), cut);
+        broken = codec->reader(again);
+        EXPECT_TRUE(
+            std::holds_alternative<nx::IO_Error>(read_in_pieces(*broken)));
+    }
+}
+
+} // namespace
+
+#endif
+
+#if defined(USE_LZ4)
+
+TEST(compress, lz4) { codec_round_trip(nx::compress::CodecId::LZ4); }
+
+#endif
+
+#if defined(USE_ZSTD)
+
+TEST(compress, zstd) { codec_round_trip(nx::compress::CodecId::ZSTD); }
+
+#endif
+
 TEST(file_system, archive)
 {
     {
@@ -46,4 +996,283 @@ TEST(file_system, archive)
         EXPECT_TRUE(archive->list_dir("/").size() > 0);
         EXPECT_TRUE(archive->open("/dev/null") != nullptr);
     }
-}
\ No newline at end of file
+}
+
+namespace {
+
+// a zip in memory with the bare minimum in its headers
+struct ZipBuilder {
+    nx::ByteBuffer data;
+    nx::ByteBuffer directory;
+    uint16_t count = 0;
+    // sizes and offsets in zip64 extra fields and end records
+    bool zip64 = false;
+
+    static void put(nx::ByteBuffer& out, uint64_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++) {
+            out.push_back((uint8_t)(value >> (i * 8)));
+        }
+    }
+
+    void add(const nx::String& name,
+             const nx::ByteBuffer& content,
+             bool deflate = false)
+    {
+        nx::ByteBuffer packed = content;
+#if defined(USE_ZLIB)
+        if (deflate) {
+            BufferWriter writer;
+            {
+                nx::DeflateWriter deflater(
+                    writer, 9, nx::DeflateFormat::RAW);
+                deflater.write_all(content.data(), content.size());
+            }
+            packed = writer.data;
+        }
+#endif
+        uint16_t method = deflate ? 8 : 0;
+        uint32_t crc = nx::crc32(content.data(), content.size());
+        size_t offset = data.size();
+
+        put(data, 0x04034b50, 4);
+        put(data, 20, 2);
+        put(data, 0, 2);
+        put(data, method, 2);
+        put(data, 0, 4);
+        put(data, crc, 4);
+        put(data, packed.size(), 4);
+        put(data, content.size(), 4);
+        put(data, name.size(), 2);
+        // a local extra field the central directory does not have
+        put(data, 4, 2);
+        data.insert(data.end(), name.begin(), name.end());
+        put(data, 0xcafe, 2);
+        put(data, 0, 2);
+        data.insert(data.end(), packed.begin(), packed.end());
+
+        put(directory, 0x02014b50, 4);
+        put(directory, 20, 2);
+        put(directory, 20, 2);
+        put(directory, 0, 2);
+        put(directory, method, 2);
+        put(directory, 0, 4);
+        put(directory, crc, 4);
+        put(directory, zip64 ? 0xffffffff : packed.size(), 4);
+        put(directory, zip64 ? 0xffffffff : content.size(), 4);
+        put(directory, name.size(), 2);
+        put(directory, zip64 ? 28 : 0, 2);
+        put(directory, 0, 2);
+        put(directory, 0, 2);
+        put(directory, 0, 2);
+        put(directory, 0, 4);
+        put(directory, zip64 ? 0xffffffff : offset, 4);
+        directory.insert(directory.end(), name.begin(), name.end());
+        if (zip64) {
+            put(directory, 1, 2);
+            put(directory, 24, 2);
+            put(directory, content.size(), 8);
+            put(directory, packed.size(), 8);
+            put(directory, offset, 8);
+        }
+        count++;
+    }
+
+    nx::ByteBuffer finish()
+    {
+        nx::ByteBuffer zip = data;
+        zip.insert(zip.end(), directory.begin(), directory.end());
+        if (zip64) {
+            size_t end64 = zip.size();
+            put(zip, 0x06064b50, 4);
+            put(zip, 44, 8);
+            put(zip, 45, 2);
+            put(zip, 45, 2);
+            put(zip, 0, 4);
+            put(zip, 0, 4);
+            put(zip, count, 8);
+            put(zip, count, 8);
+            put(zip, directory.size(), 8);
+            put(zip, data.size(), 8);
+
+            put(zip, 0x07064b50, 4);
+            put(zip, 0, 4);
+            put(zip, end64, 8);
+            put(zip, 1, 4);
+        }
+        put(zip, 0x06054b50, 4);
+        put(zip, 0, 4);
+        put(zip, zip64 ? 0xffff : count, 2);
+        put(zip, zip64 ? 0xffff : count, 2);
+        put(zip, zip64 ? 0xffffffff : directory.size(), 4);
+        put(zip, zip64 ? 0xffffffff : data.size(), 4);
+        put(zip, 0, 2);
+        return zip;
+    }
+};
+
+} // namespace
+
+TEST(file_system, mapped_zip_archive)
+{
+    auto text = compressible(100 * 1000);
+    nx::ByteBuffer empty;
+    ZipBuilder builder;
+    builder.add("assets/", empty);
+    builder.add("assets/stored.bin", text);
+    builder.add("assets/empty", empty);
+    builder.add("readme.txt", nx::ByteBuffer(text.begin(), text.begin() + 10));
+#if defined(USE_ZLIB)
+    builder.add("assets/deflated.bin", text, true);
+#endif
+    auto zip = builder.finish();
+
+    auto archive = nx::fs::create_zip_archive_from_memory(zip.data(),
+                                                          zip.size());
+    ASSERT_TRUE(archive != nullptr);
+    auto root = archive->list_dir("/");
+    std::sort(root.begin(), root.end());
+    EXPECT_EQ(root, (nx::Vector<nx::String> { "assets", "readme.txt" }));
+    EXPECT_EQ(archive->open("/missing"), nullptr);
+    EXPECT_EQ(archive->open("/assets"), nullptr);
+
+    // stored files are views of the archive
+    auto view = archive->view("/assets/stored.bin");
+    ASSERT_TRUE(view.has_value());
+    EXPECT_GE(view->data, zip.data());
+    EXPECT_LT(view->data, zip.data() + zip.size());
+    ASSERT_EQ(view->size, text.size());
+    EXPECT_EQ(memcmp(view->data, text.data(), text.size()), 0);
+    EXPECT_EQ(archive->view("/assets/empty")->size, 0u);
+
+    auto stored = archive->open("/assets/stored.bin");
+    ASSERT_TRUE(stored != nullptr);
+    EXPECT_EQ(stored->size_hint(), text.size());
+    EXPECT_EQ(std::get<nx::ByteBuffer>(stored->read_all()), text);
+
+    // a stored file is checked against its crc, its view is not
+    auto flipped = zip;
+    flipped[view->data - zip.data() + 1234] ^= 1;
+    auto bad_stored = nx::fs::create_zip_archive_from_memory(flipped.data(),
+                                                             flipped.size());
+    ASSERT_TRUE(bad_stored != nullptr);
+    stored = bad_stored->open("/assets/stored.bin");
+    ASSERT_TRUE(stored != nullptr);
+    EXPECT_TRUE(std::holds_alternative<nx::IO_Error>(stored->read_all()));
+    EXPECT_TRUE(bad_stored->view("/assets/stored.bin").has_value());
+
+#if defined(USE_ZLIB)
+    EXPECT_FALSE(archive->view("/assets/deflated.bin").has_value());
+    auto deflated = archive->open("/assets/deflated.bin");
+    ASSERT_TRUE(deflated != nullptr);
+    EXPECT_EQ(deflated->size_hint(), text.size());
+    EXPECT_EQ(std::get<nx::ByteBuffer>(deflated->read_all()), text);
+
+    // a bad crc shows once the size is read
+    auto broken = zip;
+    size_t record = broken.size() - 22 - (46 + 19);
+    broken[record + 16] ^= 1;
+    auto bad = nx::fs::create_zip_archive_from_memory(broken.data(),
+                                                      broken.size());
+    ASSERT_TRUE(bad != nullptr);
+    auto entry = bad->open("/assets/deflated.bin");
+    ASSERT_TRUE(entry != nullptr);
+    EXPECT_TRUE(std::holds_alternative<nx::IO_Error>(entry->read_all()));
+    entry = bad->open("/assets/deflated.bin");
+    nx::ByteBuffer exact(text.size());
+    EXPECT_FALSE(entry->read_exact(exact.data(), exact.size()));
+
+    // a size deflate cannot reach from the data is not allocated
+    broken = zip;
+    broken[record + 27] = 0xf0;
+    bad = nx::fs::create_zip_archive_from_memory(broken.data(),
+                                                 broken.size());
+    ASSERT_TRUE(bad != nullptr);
+    entry = bad->open("/assets/deflated.bin");
+    ASSERT_TRUE(entry != nullptr);
+    EXPECT_FALSE(entry->size_hint().has_value());
+    EXPECT_TRUE(std::holds_alternative<nx::IO_Error>(entry->read_all()));
+#endif
+
+    nx::String path = testing::TempDir() + "nx_mapped_zip.zip";
+    {
+        nx::fs::File file(path);
+        ASSERT_TRUE(file.open_write());
+        ASSERT_TRUE(file.write_all(zip.data(), zip.size()));
+    }
+    auto mapped = nx::fs::create_archive("zip://" + path);
+    ASSERT_TRUE(mapped != nullptr);
+    auto readme = mapped->open("/readme.txt");
+    ASSERT_TRUE(readme != nullptr);
+    EXPECT_EQ(std::get<nx::ByteBuffer>(readme->read_all()).size(), 10u);
+    readme.reset();
+    mapped.reset();
+    EXPECT_EQ(std::remove(path.c_str()), 0);
+
+    EXPECT_EQ(nx::fs::create_zip_archive_from_memory(zip.data(), 100),
+              nullptr);
+
+    ZipBuilder builder64;
+    builder64.zip64 = true;
+    builder64.add("stored.bin", text);
+#if defined(USE_ZLIB)
+    builder64.add("deflated.bin", text, true);
+#endif
+    auto zip64 = builder64.finish();
+    archive = nx::fs::create_zip_archive_from_memory(zip64.data(),
+                                                     zip64.size());
+    ASSERT_TRUE(archive != nullptr);
+    stored = archive->open("/stored.bin");
+    ASSERT_TRUE(stored != nullptr);
+    EXPECT_EQ(std::get<nx::ByteBuffer>(stored->read_all()), text);
+#if defined(USE_ZLIB)
+    deflated = archive->open("/deflated.bin");
+    ASSERT_TRUE(deflated != nullptr);
+    EXPECT_EQ(std::get<nx::ByteBuffer>(deflated->read_all()), text);
+#endif
+}
+
+TEST(file_system, corrupt_zip_archive)
+{
+    auto text = compressible(1000);
+    ZipBuilder builder;
+    builder.add("first.bin", text);
+    builder.add("second.bin", text);
+    auto zip = builder.finish();
+    size_t end = zip.size() - 22;
+    size_t record = end - (46 + 10);
+
+    auto parse = [](const nx::ByteBuffer& data) {
+        return nx::fs::create_zip_archive_from_memory(data.data(),
+                                                      data.size());
+    };
+    ASSERT_TRUE(parse(zip) != nullptr);
+
+    // more entries than the directory holds
+    for (uint8_t count : { 3, 0xff }) {
+        auto broken = zip;
+        broken[end + 8] = broken[end + 10] = count;
+        EXPECT_EQ(parse(broken), nullptr);
+    }
+
+    // a name or an extra field running past the directory
+    for (size_t field : { 28, 30 }) {
+        auto broken = zip;
+        broken[record + field] = 0xff;
+        EXPECT_EQ(parse(broken), nullptr);
+    }
+
+    // a local header out of the file is found but does not open
+    auto broken = zip;
+    broken[record + 45] = 0xff;
+    auto archive = parse(broken);
+    ASSERT_TRUE(archive != nullptr);
+    EXPECT_EQ(archive->open("/second.bin"), nullptr);
+    EXPECT_FALSE(archive->view("/second.bin").has_value());
+    EXPECT_TRUE(archive->open("/first.bin") != nullptr);
+
+    // a directory out of the file
+    broken = zip;
+    broken[end + 19] = 0x7f;
+    EXPECT_EQ(parse(broken), nullptr);
+}